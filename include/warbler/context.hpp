@@ -3,6 +3,7 @@
 
 #include <warbler/type.hpp>
 #include <warbler/state.hpp>
+#include <warbler/type_interner.hpp>
 #include <warbler/util/string.hpp>
 #include <warbler/util/primitive.hpp>
 #include <warbler/util/result.hpp>
@@ -79,28 +80,25 @@ namespace warbler
 		const auto& type() const { return _type; }
 	};
 
+	// Annotations only hold the id their type was interned as, so two annotations are of the
+	// same type if their ids are equal.
 	class TypeAnnotationContext
 	{
-		Array<bool> _ptr_mutability;
-		usize _index;
-		AnnotationType _type;
+		u32 _id;
 
 	public:
 
-		TypeAnnotationContext(usize index):
-		_index(index),
-		_type(AnnotationType::Primitive)
+		TypeAnnotationContext(u32 id):
+		_id(id)
 		{}
 
-		TypeAnnotationContext(Array<bool>&& ptr_info, AnnotationType type, usize index) :
-		_ptr_mutability(std::move(ptr_info)),
-		_index(index),
-		_type(type)
-		{}
+		const auto& id() const { return _id; }
+		usize index() const { return TypeInterner::get(_id).index; }
+		AnnotationType type() const { return TypeInterner::get(_id).type; }
+		u32 ptr_depth() const { return TypeInterner::get(_id).ptr_depth; }
 
-		const auto& ptr_mutability() const { return _ptr_mutability; }
-		const auto& index() const { return _index; }
-		const auto& type() const { return _type; }
+		bool operator==(const TypeAnnotationContext& other) const { return _id == other._id; }
+		bool operator!=(const TypeAnnotationContext& other) const { return _id != other._id; }
 	};
 
 	class ExpressionContext
@@ -184,39 +182,74 @@ namespace warbler
 		usize index() const;
 	};
 
-	struct MemberContext
+	struct TypeLayout
 	{
-		String _name;
+		u32 size;
+		u32 alignment;
+	};
+
+	class MemberContext
+	{
+		u32 _name;
 		TypeAnnotationContext _type;
+		TypeLayout _layout;
+		u32 _offset;
 		bool _is_public;
 
 	public:
 
-		MemberContext(String&& name, TypeAnnotationContext&& type, bool is_public) :
-		_name(std::move(name)),
-		_type(std::move(type)),
+		MemberContext(u32 name, TypeAnnotationContext type, TypeLayout layout, bool is_public) :
+		_name(name),
+		_type(type),
+		_layout(layout),
+		_offset(0),
 		_is_public(is_public)
 		{}
 
 		const auto& name() const { return _name; }
 		const auto& type() const { return _type; }
+		const auto& size() const { return _layout.size; }
+		const auto& alignment() const { return _layout.alignment; }
+		const auto& offset() const { return _offset; }
 		const auto& is_public() const { return _is_public; }
+
+		friend class StructContext;
+	};
+
+	enum class MemberAddition
+	{
+		Added,
+		AlreadyDeclared,
+		TooLarge
 	};
 
+	// Members are kept in declaration order and laid out as they are added, each at the first
+	// offset after the previous member that suits its alignment, as a C compiler would lay
+	// them out. Small structs are searched by name member by member, larger ones get an index.
 	class StructContext
 	{
-		String _symbol;
-		Table<MemberContext> _members;
+		static constexpr usize max_unindexed_member_count = 8;
+
+		u32 _symbol;
+		Array<MemberContext> _members;
+		AtomTable<u32> _member_indices;
+		u32 _end;
+		TypeLayout _layout;
 
 	public:
 
-		StructContext(String&& symbol, Table<MemberContext>&& members) :
-		_symbol(std::move(symbol)),
-		_members(std::move(members))
-		{}
+		StructContext(u32 symbol, usize member_count = 0);
+
+		// the member is not added if a member with its name already was or the struct would
+		// not fit in 4 GiB with it
+		MemberAddition add_member(MemberContext&& member);
+		const MemberContext *find_member(u32 name) const;
 
 		const auto& symbol() const { return _symbol; }
 		const auto& members() const { return _members; }
+		const auto& layout() const { return _layout; }
+		const auto& size() const { return _layout.size; }
+		const auto& alignment() const { return _layout.alignment; }
 	};
 
 	class PrimitiveContext
@@ -239,19 +272,19 @@ namespace warbler
 
 	class VariableContext
 	{
-		String _name;
+		u32 _name;
 		Optional<TypeAnnotationContext> _type;
 		bool _is_mutable;
 
 	public:
 
-		VariableContext(const String& name, bool is_mutable):
+		VariableContext(u32 name, bool is_mutable):
 		_name(name),
 		_type(),
 		_is_mutable(is_mutable)
 		{}
 
-		VariableContext(const String& name, TypeAnnotationContext&& type, bool is_mutable) :
+		VariableContext(u32 name, TypeAnnotationContext&& type, bool is_mutable) :
 		_name(name),
 		_type(std::move(type)),
 		_is_mutable(is_mutable)
@@ -348,15 +381,15 @@ namespace warbler
 
 	class ParameterContext
 	{
-		String _name;
+		u32 _name;
 		TypeAnnotationContext _type;
 		bool _is_mutable;
 
 
 	public:
 	
-		ParameterContext(String&& name, TypeAnnotationContext&& type, bool is_mutable) :
-		_name(std::move(name)),
+		ParameterContext(u32 name, TypeAnnotationContext&& type, bool is_mutable) :
+		_name(name),
 		_type(std::move(type)),
 		_is_mutable(is_mutable)
 		{}
@@ -369,7 +402,7 @@ namespace warbler
 	class FunctionContext
 	{
 
-		String _symbol;
+		u32 _symbol;
 		FunctionSignatureContext _signature;
 		BlockStatementContext _body;
 		Array<VariableContext> _variables;
@@ -377,8 +410,8 @@ namespace warbler
 
 	public:
 
-		FunctionContext(String&& symbol, FunctionSignatureContext&& signature, BlockStatementContext&& body) :
-		_symbol(std::move(symbol)),
+		FunctionContext(u32 symbol, FunctionSignatureContext&& signature, BlockStatementContext&& body) :
+		_symbol(symbol),
 		_signature(std::move(signature)),
 		_body(std::move(body))
 		{}
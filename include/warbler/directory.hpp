@@ -5,6 +5,13 @@
 
 namespace warbler
 {
+    struct DirectoryReadTimes
+    {
+        f64 discovery_seconds = 0.0;
+        f64 load_seconds = 0.0;
+        usize file_count = 0;
+    };
+
     class Directory
     {
     private:
@@ -18,7 +25,8 @@ namespace warbler
         Directory(const String& path);
         static Directory from(const char *path, File&& file);
 
-        static Result<Array<Directory>> read(const String& path);
+        // files are read on up to worker_count threads, or one per core if it is 0
+        static Result<Array<Directory>> read(const String& path, usize worker_count = 0, DirectoryReadTimes *times = nullptr);
 
         void add_file(File&& file)
         {
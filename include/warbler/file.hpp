@@ -5,6 +5,7 @@
 #include <warbler/util/result.hpp>
 #include <warbler/util/primitive.hpp>
 #include <warbler/util/string.hpp>
+#include <warbler/util/file.hpp>
 
 #include <cassert>
 
@@ -15,13 +16,28 @@ namespace warbler
 	private:
 
 		String _filename;
-		String _src;
-		Array<usize> _line_lengths;
+		// text is owned by either the mapping or the buffer and is always followed by a null character
+		MappedFile _mapping;
+		String _buffer;
+		StringView _src;
+		// offset of the first character of each line
+		Array<usize> _line_starts;
+		u32 _base;
+		bool _is_registered;
 
-		File(String&& filename, String&& src, Array<usize>&& line_lengths);
+		File(String&& filename, MappedFile&& mapping, String&& buffer);
+
+		StringView get_owned_text() const;
 
 	public:
 
+		File(File&& other);
+		File(const File&) = delete;
+		~File();
+
+		File& operator=(File&&) = delete;
+		File& operator=(const File&) = delete;
+
 		static Result<File> read(const String& filepath);
 		static File from(const char *name, const char *text);
 
@@ -29,10 +45,14 @@ namespace warbler
 		usize get_col(usize pos) const;
 
 		String get_text(usize pos, usize length) const;
-		char operator[](usize i) const { assert(i <= _src.size()); return _src[i]; }
+		StringView get_view(usize pos, usize length) const { assert(pos + length <= _src.size()); return _src.substr(pos, length); }
+		char operator[](usize i) const { assert(i <= _src.size()); return _src.data()[i]; }
 
 		const String& filename() const { return _filename; }
-		const String& src() const { return _src; }
+		StringView src() const { return _src; }
+		u32 base() const { return _base; }
+		u32 get_location(usize pos) const { assert(pos <= _src.size()); return _base + static_cast<u32>(pos); }
+		usize get_pos(u32 location) const { assert(location >= _base && location - _base <= _src.size()); return location - _base; }
 	};
 }
 
@@ -0,0 +1,50 @@
+#ifndef WARBLER_INTERNER_HPP
+#define WARBLER_INTERNER_HPP
+
+#include <warbler/util/array.hpp>
+#include <warbler/util/primitive.hpp>
+#include <warbler/util/string.hpp>
+
+namespace warbler
+{
+	// Every distinct identifier is given a dense u32 atom the first time it is interned, so
+	// identifiers can be compared and hashed as integers. Atom 0 is always the empty string.
+	// Interned text is never freed or moved, so views of it stay valid for the whole program.
+	class Interner
+	{
+	public:
+
+		static u32 intern(StringView text);
+		// gives 0 if the text has not been interned
+		static u32 find(StringView text);
+		static StringView get(u32 atom);
+		static usize size();
+	};
+
+	// slots hold their own copy of the text's location so probing never has to
+	// touch the shared atom table
+	struct InternSlot
+	{
+		const char *data;
+		u32 length;
+		u32 hash;
+		u32 atom;
+	};
+
+	// Remembers the atoms of the identifiers interned through it, so a lexer only takes a lock
+	// the first time it sees each distinct identifier. It grows with the number of distinct
+	// identifiers and is only used by one thread at a time.
+	class InternCache
+	{
+	private:
+
+		Array<InternSlot> _slots;
+		usize _count = 0;
+
+	public:
+
+		u32 intern(StringView text);
+	};
+}
+
+#endif
@@ -6,49 +6,78 @@
 
 namespace warbler
 {
+	class SyntaxCache;
+
+	// bump whenever the parser gives different syntax for the same text, so that syntax cached
+	// by an earlier parser is parsed again
+	constexpr u32 parser_version = 1;
+
+	// replacement of length characters at pos with text
+	struct TextEdit
+	{
+		usize pos;
+		usize length;
+		String text;
+	};
+
 	// Expression
-	Result<ExpressionSyntax> parse_additive_expression(Token& token);
-	Result<ExpressionSyntax> parse_bitwise_and_expression(Token& token);
-	Result<ExpressionSyntax> parse_bitwise_or_expression(Token& token);
-	Result<ExpressionSyntax> parse_bitwise_xor_expression(Token& token);
-	Result<ExpressionSyntax> parse_boolean_and_expression(Token& token);
-	Result<ExpressionSyntax> parse_boolean_or_expression(Token& token);
-	Result<ExpressionSyntax> parse_conditional_expression(Token& token);
-	Result<ExpressionSyntax> parse_equality_expression(Token& token);
-	Result<ExpressionSyntax> parse_multiplicative_expression(Token& token);
-	Result<ExpressionSyntax> parse_postfix_expression(Token& token);
-	Result<ExpressionSyntax> parse_prefix_expression(Token& token);
-	Result<ExpressionSyntax> parse_primary_expression(Token& token);
-	Result<ExpressionSyntax> parse_relational_expression(Token& token);
-	Result<ExpressionSyntax> parse_bit_shift_expression(Token& token);
-	Result<ExpressionSyntax> parse_symbol(Token& token);
-	Result<ExpressionSyntax> parse_constant(Token& token);
-	Result<ExpressionSyntax> parse_assignment(Token& token);
-	inline Result<ExpressionSyntax> parse_expression(Token& token) { return parse_assignment(token); }
+	Result<ExpressionSyntax> parse_additive_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_bitwise_and_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_bitwise_or_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_bitwise_xor_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_boolean_and_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_boolean_or_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_conditional_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_equality_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_multiplicative_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_postfix_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_prefix_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_primary_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_relational_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_bit_shift_expression(TokenIterator& token);
+	Result<ExpressionSyntax> parse_symbol(TokenIterator& token);
+	Result<ExpressionSyntax> parse_constant(TokenIterator& token);
+	Result<ExpressionSyntax> parse_assignment(TokenIterator& token);
+	inline Result<ExpressionSyntax> parse_expression(TokenIterator& token) { return parse_assignment(token); }
 
 	// Function
-	Result<FunctionSyntax> parse_function(Token& token);
-	Result<Array<ExpressionSyntax>> parse_arguments(Token& token);
-	Result<ParameterSyntax> parse_parameter(Token& token);
-	Result<Array<ParameterSyntax>> parse_parameter_list(Token& token);
-	Result<FunctionSignatureSyntax> parse_function_signature(Token& token);
+	// a skipped body is only matched by its braces and can be parsed later with parse_function_body
+	Result<FunctionSyntax> parse_function(TokenIterator& token, bool skip_body = false);
+	Result<SyntaxList<ExpressionSyntax>> parse_arguments(TokenIterator& token);
+	Result<ParameterSyntax> parse_parameter(TokenIterator& token);
+	Result<SyntaxList<ParameterSyntax>> parse_parameter_list(TokenIterator& token);
+	Result<FunctionSignatureSyntax> parse_function_signature(TokenIterator& token);
 
 	// Statement
-	Result<BlockStatementSyntax> parse_block_statement(Token& token);
-	Result<DeclarationSyntax> parse_declaration(Token& token);
-	Result<ExpressionStatementSyntax> parse_expression_statement(Token& token);
-	Result<IfStatementSyntax> parse_if_statement(Token& token);
-	Result<StatementSyntax> parse_statement(Token& token);
+	Result<BlockStatementSyntax> parse_block_statement(TokenIterator& token);
+	Result<DeclarationSyntax> parse_declaration(TokenIterator& token);
+	Result<ExpressionStatementSyntax> parse_expression_statement(TokenIterator& token);
+	Result<IfStatementSyntax> parse_if_statement(TokenIterator& token);
+	Result<StatementSyntax> parse_statement(TokenIterator& token);
 
 	// Type
-	Result<TypeSyntax> parse_type(Token& token);
-	Result<MemberSyntax> parse_member(Token& token);
-	Result<StructSyntax> parse_struct(Token& token);
-	Result<LabelSyntax> parse_label(Token& token);
-	Result<TypeAnnotationSyntax> parse_type_annotation(Token& token);
-	Result<VariableSyntax> parse_variable(Token& token);
-	Result<PackageSyntax> parse_module(Token& token);
-	Result<ProgramSyntax> parse(const Array<Directory>& directories);
+	Result<TypeSyntax> parse_type(TokenIterator& token);
+	Result<MemberSyntax> parse_member(TokenIterator& token);
+	Result<StructSyntax> parse_struct(TokenIterator& token);
+	Result<LabelSyntax> parse_label(TokenIterator& token);
+	Result<TypeAnnotationSyntax> parse_type_annotation(TokenIterator& token);
+	Result<VariableSyntax> parse_variable(TokenIterator& token);
+	Result<ModuleSyntax> parse_module(const File& file, bool skip_bodies = false);
+	// Parses a module again after its file was edited, where file is the text after the edit.
+	// Declarations the edit does not touch are reused from the previous syntax, which is
+	// consumed either way.
+	Result<ModuleSyntax> reparse_module(ModuleSyntax&& previous, const File& file, const TextEdit& edit);
+	// files are parsed on up to worker_count threads, or one per core if it is 0. files that
+	// are unchanged since they were stored in the cache are loaded from it instead. skipping
+	// bodies leaves only struct definitions and function signatures, which is all that is
+	// needed of packages that are depended on
+	Result<PackageSyntax> parse_package(const Directory& directory, usize worker_count = 0, SyntaxCache *cache = nullptr, bool skip_bodies = false);
+	Result<ProgramSyntax> parse(const Array<Directory>& directories, usize worker_count = 0, SyntaxCache *cache = nullptr, bool skip_bodies = false);
+	// Parses bodies that were skipped into the pool of their function. Bodies in the same pool
+	// may not be parsed at the same time.
+	bool parse_function_body(FunctionSyntax& function, SyntaxPool& pool);
+	bool parse_function_bodies(ModuleSyntax& module);
+	bool parse_function_bodies(PackageSyntax& package);
 }
 
 #endif
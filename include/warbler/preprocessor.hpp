@@ -3,6 +3,8 @@
 
 namespace warbler
 {
+	// Removes comments from src in place. The lexer skips comments itself, so this is only
+	// needed when comment free text is wanted for something other than lexing.
 	void preprocess(char *src);
 }
 
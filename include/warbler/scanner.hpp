@@ -0,0 +1,48 @@
+#ifndef WARBLER_SCANNER_HPP
+#define WARBLER_SCANNER_HPP
+
+#include <warbler/util/primitive.hpp>
+#include <warbler/util/array.hpp>
+
+namespace warbler
+{
+	// The scanners find the end of runs of characters in source text. Each takes the position to
+	// start at and the end of the text and returns the first position that is not part of the run,
+	// never going past the end. Scanning always stops at a null character.
+
+	enum class ScanLevel
+	{
+		Scalar,
+		Sse2,
+		Avx2
+	};
+
+	struct BlockCommentEnd
+	{
+		const char *pos;
+		usize new_line_count;
+	};
+
+	// whitespace is any character at or below ' ', including non-ascii bytes
+	const char *skip_whitespace(const char *pos, const char *end);
+	// [A-Za-z0-9_]
+	const char *skip_identifier(const char *pos, const char *end);
+	// [0-9]
+	const char *skip_digits(const char *pos, const char *end);
+	// finds the next '\n'
+	const char *find_line_end(const char *pos, const char *end);
+	// finds the next "*/", returning the position of the '*'
+	BlockCommentEnd find_block_comment_end(const char *pos, const char *end);
+	// finds the next terminal character that is not preceded by a '\'. pos must not be the start of the text
+	const char *find_quote_end(const char *pos, const char *end, char terminal);
+	// appends the offset from pos of every '\n' before end. Unlike the other scanners this does not stop at a null character
+	void find_new_lines(const char *pos, const char *end, Array<usize>& offsets);
+
+	ScanLevel get_max_scan_level();
+	ScanLevel get_scan_level();
+	// Selects which implementation is used. It is meant for testing and benchmarking and should not
+	// be called while anything is being scanned. Levels above the maximum supported are clamped.
+	void set_scan_level(ScanLevel level);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef WARBLER_SOURCE_MANAGER_HPP
+#define WARBLER_SOURCE_MANAGER_HPP
+
+#include <warbler/util/primitive.hpp>
+
+namespace warbler
+{
+	class File;
+
+	// Every loaded file is given a range of global source locations starting at its base, so a
+	// location in any file fits in a single u32. The range includes one extra location for the
+	// end-of-file position. The range of a removed file is given to files added after it, so
+	// only the files loaded at once have to fit in the 4 GiB of locations. Looking up a file
+	// never takes a lock.
+	class SourceManager
+	{
+	public:
+
+		static u32 add_file(const File& file, usize size);
+		static void move_file(u32 base, const File& file);
+		static void remove_file(u32 base);
+
+		static const File& get_file(u32 location);
+	};
+}
+
+#endif
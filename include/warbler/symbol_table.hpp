@@ -10,6 +10,7 @@
 #include <warbler/type.hpp>
 #include <warbler/syntax.hpp>
 #include <warbler/context.hpp>
+#include <warbler/interner.hpp>
 #include <cassert>
 
 namespace warbler
@@ -31,7 +32,7 @@ namespace warbler
 			const ParameterSyntax *_parameter_syntax;
 		};
 
-		String _symbol;
+		u32 _symbol;
 		usize _index = 0;
 		SymbolType _type;
 		ValidationStatus _validation = ValidationStatus::NotYetValidated;
@@ -39,7 +40,7 @@ namespace warbler
 
 	private:
 
-		SymbolData(const String& symbol):
+		SymbolData(u32 symbol):
 		_symbol(symbol),
 		_type(SymbolType::Package),
 		_validation(ValidationStatus::Valid)
@@ -47,18 +48,18 @@ namespace warbler
 
 	public:
 
-		static SymbolData package(const String& symbol)
+		static SymbolData package(u32 symbol)
 		{
 			return SymbolData(symbol);
 		}
 
-		SymbolData(const String& symbol, const StructSyntax& syntax):
+		SymbolData(u32 symbol, const StructSyntax& syntax):
 		_struct_syntax(&syntax),
 		_symbol(symbol),
 		_type(SymbolType::Struct)
 		{}
 
-		SymbolData(const String& symbol, const FunctionSyntax& syntax):
+		SymbolData(u32 symbol, const FunctionSyntax& syntax):
 		_function_syntax(&syntax),
 		_symbol(symbol),
 		_type(SymbolType::Function)
@@ -66,17 +67,17 @@ namespace warbler
 
 		SymbolData(const VariableSyntax& syntax):
 		_variable_syntax(&syntax),
-		_symbol(syntax.name().text()),
+		_symbol(syntax.name().atom()),
 		_type(SymbolType::Variable)
 		{}
 
 		SymbolData(const ParameterSyntax& syntax):
 		_parameter_syntax(&syntax),
-		_symbol(syntax.name().text()),
+		_symbol(syntax.name().atom()),
 		_type(SymbolType::Parameter)
 		{}
 
-		SymbolData(const char *symbol, usize index, SymbolType type):
+		SymbolData(u32 symbol, usize index, SymbolType type):
 		_symbol(symbol),
 		_index(index),
 		_type(type),
@@ -100,6 +101,7 @@ namespace warbler
 
 		const auto& type() { return _type; }
 		const auto& symbol() const { return _symbol; }
+		StringView symbol_text() const { return Interner::get(_symbol); }
 		const auto& index() const {assert(_validation == ValidationStatus::Valid); return _index; }
 		const auto& type() const { return _type; }
 		const auto& validation_status() const { return _validation; }
@@ -121,35 +123,48 @@ namespace warbler
 		SymbolData& data;
 	};
 
+	// A package and the globals declared directly in it. Packages form a tree rooted at the
+	// scope holding the primitives, so a name is resolved by walking up the parent indices.
+	struct PackageScope
+	{
+		AtomTable<SymbolData> symbols;
+		AtomTable<u32> children;
+		u32 name;
+		u32 parent;
+	};
+
 	class GlobalSymbolTable
 	{
-		Table<SymbolData> _symbols;
+		Array<PackageScope> _scopes;
 		Array<StructContext> _structs;
 		Array<FunctionContext> _functions; 
-		Array<String> _current_package;
+		u32 _current_scope = 0;
 	
-		GlobalSymbolTable() = default;
+		GlobalSymbolTable();
 
-		bool add_symbol(SymbolData&& data);
+		bool add_symbol(u32 scope, u32 identifier, SymbolData&& data);
+		u32 get_child_scope(u32 scope, u32 name);
 
 	public:
 
 		static Result<GlobalSymbolTable> generate(const ProgramSyntax& syntax);
 
-		void push_package(const String& package) { _current_package.push_back(package); }
-		void pop_package() { _current_package.pop_back(); }
-		void set_scope_from_symbol(const String& symbol);
+		void push_package(const String& package) { _current_scope = get_child_scope(_current_scope, Interner::intern(package)); }
+		void pop_package() { assert(_current_scope != 0); _current_scope = _scopes[_current_scope].parent; }
+		void set_scope(u32 scope) { assert(scope < _scopes.size()); _current_scope = scope; }
 
-		String get_symbol(const String& identifier);
 		usize add_validated_struct(StructContext&& struct_def);
 		usize add_validated_function(FunctionContext&& function);
 
-		SymbolData *resolve(const String& symbol);
-		SymbolData& get(const String& symbol) { return _symbols.at(symbol); }
-		SymbolData *find(const String& symbol)
+		// only reads the table, so it can be called from several threads at once
+		SymbolData *resolve(u32 scope, u32 identifier);
+		SymbolData *resolve(u32 identifier) { return resolve(_current_scope, identifier); }
+		SymbolData& get(u32 identifier) { return _scopes[_current_scope].symbols.at(identifier); }
+		SymbolData *find(u32 scope, u32 identifier)
 		{
-			auto iter = _symbols.find(symbol);
-			auto *ptr = iter != _symbols.end()
+			auto& symbols = _scopes[scope].symbols;
+			auto iter = symbols.find(identifier);
+			auto *ptr = iter != symbols.end()
 				? &iter->second
 				: nullptr;
 
@@ -168,60 +183,57 @@ namespace warbler
 			return primitives[index];
 		}
 
-		auto begin() { return _symbols.begin(); }
-		auto end() { return _symbols.end(); }
+		const auto& current_scope() const { return _current_scope; }
+		u32 scope_count() const { return static_cast<u32>(_scopes.size()); }
+		auto& symbols(u32 scope) { return _scopes[scope].symbols; }
 
 		auto&& take_structs() { return std::move(_structs); }
 		auto&& take_functions() { return std::move(_functions); }
 	};
 
-	class BlockSymbolTable
-	{		
-	private:
-
-		Table<SymbolData> _symbols;
-
-	public:
-
-		BlockSymbolTable() = default;
-		BlockSymbolTable(BlockSymbolTable&& other) = default;
-		BlockSymbolTable(const BlockSymbolTable&) = delete;
-
-		SymbolData *at(const String& name)
-		{
-			auto iter = _symbols.find(name);
-
-			return iter != _symbols.end()
-				? &iter->second
-				: nullptr;
-		}
-
-		AddSymbolResult add_variable(const VariableSyntax& variable);
-
-		BlockSymbolTable& operator=(const BlockSymbolTable&) = delete;
-		BlockSymbolTable& operator=(BlockSymbolTable&&) = default;
+	struct ScopedVariable
+	{
+		SymbolData data;
+		// 1 + the index of the variable this one shadows, or 0 if it shadows none
+		u32 shadowed;
 	};
 
+	// Variables of every open block are kept on a single stack, and each identifier is bound to
+	// the innermost variable with that name. A variable remembers the binding it replaced, so
+	// leaving a block pops its variables and restores those bindings. Looking a variable up is a
+	// single hash lookup whatever the nesting depth, and blocks allocate nothing. References to
+	// variables are valid until the next variable is added.
 	class FunctionSymbolTable
 	{
-		Table<SymbolData> _symbols;
-		Array<BlockSymbolTable> _blocks;
+		AtomTable<SymbolData> _symbols;
+		// 1 + the index in _variable_stack of the variable each identifier refers to, or 0
+		AtomTable<u32> _bindings;
+		Array<ScopedVariable> _variable_stack;
+		// size of the variable stack when each open block was entered
+		Array<usize> _block_starts;
 		Array<VariableContext> _variables;
 		Array<ParameterContext> _parameters;
 		GlobalSymbolTable *_globals;
+		// package the function is declared in
+		u32 _scope;
 
 	public:
 
 		FunctionSymbolTable(GlobalSymbolTable& globals):
-		_globals(&globals)
+		FunctionSymbolTable(globals, globals.current_scope())
 		{}
 
-		AddSymbolResult add_parameter(const ParameterSyntax& parameter);
-		AddSymbolResult add_variable(const VariableSyntax& syntax)
+		FunctionSymbolTable(GlobalSymbolTable& globals, u32 scope):
+		_globals(&globals),
+		_scope(scope)
 		{
-			assert(!_blocks.empty());
-			return _blocks.back().add_variable(syntax);
-		};
+			// enough for most functions, so the stacks are not regrown as a body is validated
+			_variable_stack.reserve(16);
+			_block_starts.reserve(8);
+		}
+
+		AddSymbolResult add_parameter(const ParameterSyntax& parameter);
+		AddSymbolResult add_variable(const VariableSyntax& syntax);
 
 		usize add_validated_variable(VariableContext&& variable)
 		{
@@ -241,8 +253,8 @@ namespace warbler
 			return index;
 		}
 
-		SymbolData *find_variable(const String& name);
-		SymbolData *find_parameter(const String& name)
+		SymbolData *find_variable(u32 name);
+		SymbolData *find_parameter(u32 name)
 		{
 			auto iter = _symbols.find(name);
 
@@ -251,12 +263,12 @@ namespace warbler
 				: nullptr;
 		}
 
-		SymbolData *resolve(const String& identifier);
+		SymbolData *resolve(u32 identifier);
 
-		void push_block() { _blocks.push_back({}); }
-		void pop_block() { _blocks.pop_back(); }
+		void push_block() { _block_starts.push_back(_variable_stack.size()); }
+		void pop_block();
 
-		SymbolData& get(const String& symbol) { return _symbols.at(symbol); }
+		SymbolData& get(u32 symbol) { return _symbols.at(symbol); }
 
 		auto begin() { return _symbols.begin(); }
 		auto end() { return _symbols.end(); }
@@ -265,6 +277,7 @@ namespace warbler
 		auto&& take_variables() { return std::move(_variables); }
 
 		GlobalSymbolTable& globals() const { return *_globals; }
+		const auto& scope() const { return _scope; }
 	};
 
 	String get_symbol_type_name(SymbolType type);
@@ -7,6 +7,11 @@
 #include <warbler/util/box.hpp>
 #include <warbler/util/table.hpp>
 
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
 namespace warbler
 {
 	class ConditionalExpressionSyntax;
@@ -30,6 +35,61 @@ namespace warbler
 	class BlockStatementSyntax;
 	class DeclarationSyntax;
 	class IfStatementSyntax;
+	class SyntaxPool;
+	class SyntaxRelocator;
+
+	// Contiguous run of nodes in the pool of the module they were parsed in. Lists only hold
+	// indices, so they can be copied freely and stay valid for as long as the pool does.
+	template <typename T>
+	class SyntaxList
+	{
+		u32 _first;
+		u32 _count;
+		u16 _pool;
+
+		friend SyntaxRelocator;
+
+	public:
+
+		SyntaxList(u16 pool, u32 first, u32 count) :
+		_first(first),
+		_count(count),
+		_pool(pool)
+		{}
+
+		const T *begin() const;
+		const T *end() const { return begin() + _count; }
+		const T& operator[](usize i) const { assert(i < _count); return begin()[i]; }
+		usize size() const { return _count; }
+		bool empty() const { return _count == 0; }
+		u16 pool() const { return _pool; }
+	};
+
+	// Collects the elements of a list on the pool's scratch stack while they are parsed. Lists
+	// nest strictly, so an inner list is always finished or abandoned before the outer one
+	// continues, and finishing copies the elements to the end of the pool in one run.
+	template <typename T>
+	class SyntaxListBuilder
+	{
+		SyntaxPool *_pool;
+		usize _start;
+		bool _is_finished;
+
+	public:
+
+		SyntaxListBuilder();
+		SyntaxListBuilder(const SyntaxListBuilder&) = delete;
+		~SyntaxListBuilder();
+
+		void push_back(T&& value);
+		template <typename... Args>
+		void emplace_back(Args&&... args) { push_back(T { std::forward<Args>(args)... }); }
+
+		usize size() const;
+		bool empty() const { return size() == 0; }
+
+		SyntaxList<T> finish();
+	};
 
 	class SymbolSyntax
 	{
@@ -42,6 +102,12 @@ namespace warbler
 		{}
 
 		const auto& token() const { return _token; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_token);
+		}
 	};
 
 	class LabelSyntax
@@ -55,30 +121,21 @@ namespace warbler
 		{}
 	};
 
+	// Expressions are handles to nodes in the pool of the module they were parsed in. The
+	// concrete node is found by its index into the pool for its type.
 	class ExpressionSyntax
 	{
-		union
-		{
-			AssignmentSyntax *_assignment;
-			ConditionalExpressionSyntax *_conditional;
-			BooleanOrExpressionSyntax *_boolean_or;
-			BooleanAndExpressionSyntax *_boolean_and;
-			BitwiseOrExpressionSyntax *_bitwise_or;
-			BitwiseXorExpressionSyntax *_bitwise_xor;
-			BitwiseAndExpressionSyntax *_bitwise_and;
-			EqualityExpressionSyntax *_equality;
-			RelationalExpressionSyntax *_relational;
-			BitShiftExpressionSyntax *_shift;
-			AdditiveExpressionSyntax *_additive;
-			MultiplicativeExpressionSyntax *_multiplicative;
-			PrefixExpressionSyntax *_prefix;
-			PostfixExpressionSyntax *_postfix;
-			PrimaryExpressionSyntax *_primary;
-			ConstantSyntax *_constant;
-			SymbolSyntax *_symbol;
-		};
-
+		u32 _index;
+		u16 _pool;
 		ExpressionType _type;
+
+		friend SyntaxRelocator;
+
+		template <typename T>
+		ExpressionSyntax(T&& node, ExpressionType type);
+
+		template <typename T>
+		const T& get(ExpressionType type) const;
 	
 	public:
 
@@ -99,30 +156,26 @@ namespace warbler
 		ExpressionSyntax(PrimaryExpressionSyntax&&);
 		ExpressionSyntax(ConstantSyntax&&);
 		ExpressionSyntax(SymbolSyntax&&);
-		ExpressionSyntax(ExpressionSyntax&&);
-		ExpressionSyntax& operator=(ExpressionSyntax&&) = default;
-		ExpressionSyntax(const ExpressionSyntax&) = delete;
-		ExpressionSyntax& operator=(const ExpressionSyntax&) = delete;
-		~ExpressionSyntax();
 
 		ExpressionType type() const { return _type; }
-		const auto& assignment() const { assert(_type == ExpressionType::Assignment); return *_assignment; }
-		const auto& conditional() const { assert(_type == ExpressionType::Conditional); return *_conditional; }
-		const auto& boolean_or() const { assert(_type == ExpressionType::BooleanOr); return *_boolean_or; }
-		const auto& boolean_and() const { assert(_type == ExpressionType::BooleanAnd); return *_boolean_and; }
-		const auto& bitwise_or() const { assert(_type == ExpressionType::BitwiseOr); return *_bitwise_or; }
-		const auto& bitwise_xor() const { assert(_type == ExpressionType::BitwiseXor); return *_bitwise_xor; }
-		const auto& bitwise_and() const { assert(_type == ExpressionType::BitwiseAnd); return *_bitwise_and; }
-		const auto& equality() const { assert(_type == ExpressionType::Equality); return *_equality; }
-		const auto& relational() const { assert(_type == ExpressionType::Relational); return *_relational; }
-		const auto& bit_shift() const { assert(_type == ExpressionType::Shift); return *_shift; }
-		const auto& additive() const { assert(_type == ExpressionType::Additive); return *_additive; }
-		const auto& multiplicative() const { assert(_type == ExpressionType::Multiplicative); return *_multiplicative; }
-		const auto& prefix() const { assert(_type == ExpressionType::Prefix); return *_prefix; }
-		const auto& postfix() const { assert(_type == ExpressionType::Postfix); return *_postfix; }
-		const auto& primary() const { assert(_type == ExpressionType::Primary); return *_primary; }
-		const auto& constant() const { assert(_type == ExpressionType::Constant); return *_constant; }
-		const auto& symbol() const { assert(_type == ExpressionType::Symbol); return *_symbol; }
+		u32 index() const { return _index; }
+		const auto& assignment() const { return get<AssignmentSyntax>(ExpressionType::Assignment); }
+		const auto& conditional() const { return get<ConditionalExpressionSyntax>(ExpressionType::Conditional); }
+		const auto& boolean_or() const { return get<BooleanOrExpressionSyntax>(ExpressionType::BooleanOr); }
+		const auto& boolean_and() const { return get<BooleanAndExpressionSyntax>(ExpressionType::BooleanAnd); }
+		const auto& bitwise_or() const { return get<BitwiseOrExpressionSyntax>(ExpressionType::BitwiseOr); }
+		const auto& bitwise_xor() const { return get<BitwiseXorExpressionSyntax>(ExpressionType::BitwiseXor); }
+		const auto& bitwise_and() const { return get<BitwiseAndExpressionSyntax>(ExpressionType::BitwiseAnd); }
+		const auto& equality() const { return get<EqualityExpressionSyntax>(ExpressionType::Equality); }
+		const auto& relational() const { return get<RelationalExpressionSyntax>(ExpressionType::Relational); }
+		const auto& bit_shift() const { return get<BitShiftExpressionSyntax>(ExpressionType::Shift); }
+		const auto& additive() const { return get<AdditiveExpressionSyntax>(ExpressionType::Additive); }
+		const auto& multiplicative() const { return get<MultiplicativeExpressionSyntax>(ExpressionType::Multiplicative); }
+		const auto& prefix() const { return get<PrefixExpressionSyntax>(ExpressionType::Prefix); }
+		const auto& postfix() const { return get<PostfixExpressionSyntax>(ExpressionType::Postfix); }
+		const auto& primary() const { return get<PrimaryExpressionSyntax>(ExpressionType::Primary); }
+		const auto& constant() const { return get<ConstantSyntax>(ExpressionType::Constant); }
+		const auto& symbol() const { return get<SymbolSyntax>(ExpressionType::Symbol); }
 	};
 
 	class ConstantSyntax
@@ -131,10 +184,10 @@ namespace warbler
 
 		Token _token;
 
+		// string literals are read from the token when needed
 		union
 		{
 			char _character;
-			String _string;
 			i64 _integer;
 			u64 _uinteger;
 			double _floating;
@@ -145,31 +198,35 @@ namespace warbler
 
 	public:
 
-		ConstantSyntax(const Token& token, String&& string);
+		ConstantSyntax(const Token& token);
 		ConstantSyntax(const Token& token, char character);
 		ConstantSyntax(const Token& token, i64 integer);
 		ConstantSyntax(const Token& token, u64 uinteger);
 		ConstantSyntax(const Token& token, double floating);
 		ConstantSyntax(const Token& token, bool boolean);
-		ConstantSyntax(ConstantSyntax&&);
-		ConstantSyntax(const ConstantSyntax&) = delete;
-		~ConstantSyntax();
 
 		const Token& token() const { return _token; }
 		const auto& character() const { return _character; }
-		const auto& string() const { return _string; }
+		String string() const { assert(_type == ConstantType::StringLiteral); return _token.file().get_text(_token.pos() + 1, _token.length() - 2); }
 		const auto& integer() const { return _integer; }
 		const auto& uinteger() const { return _uinteger; }
 		const auto& floating() const { return _floating; }
 		const auto& boolean() const { return _boolean; }
 		const auto& type() const { return _type; }
 
-		ConstantSyntax& operator=(ConstantSyntax&& other);
-		ConstantSyntax& operator=(const ConstantSyntax& other) = delete;
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_token);
+		}
 	};
 
 	class PrimaryExpressionSyntax
 	{
+	public:
+
+		template <typename Visitor>
+		void visit(Visitor&) {}
 	};
 
 	class PostfixExpressionSyntax
@@ -181,7 +238,7 @@ namespace warbler
 		union
 		{
 			ExpressionSyntax _index;
-			Array<ExpressionSyntax> _arguments;
+			SyntaxList<ExpressionSyntax> _arguments;
 			Token _member;
 		};
 
@@ -190,11 +247,38 @@ namespace warbler
 	public:
 
 		PostfixExpressionSyntax(ExpressionSyntax&& expression, ExpressionSyntax&& index);
-		PostfixExpressionSyntax(ExpressionSyntax&& expression, Array<ExpressionSyntax>&& arguments);
+		PostfixExpressionSyntax(ExpressionSyntax&& expression, SyntaxList<ExpressionSyntax> arguments);
 		PostfixExpressionSyntax(ExpressionSyntax&& expression, const Token& member);
-		PostfixExpressionSyntax(PostfixExpressionSyntax&& other);
-		PostfixExpressionSyntax(const PostfixExpressionSyntax& other) = delete;
-		~PostfixExpressionSyntax();
+
+		const auto& expression() const { return _expression; }
+		const auto& index() const { assert(_type == PostfixType::Index); return _index; }
+		const auto& arguments() const { assert(_type == PostfixType::FunctionCall); return _arguments; }
+		const auto& member() const { assert(_type == PostfixType::Member); return _member; }
+		const auto& type() const { return _type; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_expression);
+
+			switch (_type)
+			{
+				case PostfixType::Index:
+					visitor(_index);
+					break;
+
+				case PostfixType::FunctionCall:
+					visitor(_arguments);
+					break;
+
+				case PostfixType::Member:
+					visitor(_member);
+					break;
+
+				default:
+					break;
+			}
+		}
 	};
 
 	class PrefixExpressionSyntax
@@ -212,12 +296,29 @@ namespace warbler
 		_expression(std::move(expression)),
 		_type(type)
 		{}
+
+		const auto& token() const { return _token; }
+		const auto& expression() const { return _expression; }
+		const auto& type() const { return _type; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_token);
+			visitor(_expression);
+		}
 	};
 
 	struct MultiplicativeRhsSyntax
 	{
 		ExpressionSyntax expr;
 		MultiplicativeType type;
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(expr);
+		}
 	};
 
 	class MultiplicativeExpressionSyntax
@@ -225,20 +326,36 @@ namespace warbler
 	private:
 
 		ExpressionSyntax _lhs;
-		Array<MultiplicativeRhsSyntax> _RhsSyntax;
+		SyntaxList<MultiplicativeRhsSyntax> _RhsSyntax;
 	
 	public:
 
-		MultiplicativeExpressionSyntax(ExpressionSyntax&& lhs, Array<MultiplicativeRhsSyntax>&& RhsSyntax) :
+		MultiplicativeExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<MultiplicativeRhsSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	struct AdditiveRhsSyntax
 	{
 		ExpressionSyntax expr;
 		AdditiveType type;
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(expr);
+		}
 	};
 
 	class AdditiveExpressionSyntax
@@ -246,39 +363,71 @@ namespace warbler
 	private:
 
 		ExpressionSyntax _lhs;
-		Array<AdditiveRhsSyntax> _RhsSyntax;
+		SyntaxList<AdditiveRhsSyntax> _RhsSyntax;
 	
 	public:
 
-		AdditiveExpressionSyntax(ExpressionSyntax&& lhs, Array<AdditiveRhsSyntax>&& RhsSyntax) :
+		AdditiveExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<AdditiveRhsSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	struct BitShiftRhsSyntax
 	{
 		ExpressionSyntax expr;
 		BitShiftType type;
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(expr);
+		}
 	};
 
 	class BitShiftExpressionSyntax
 	{
 		ExpressionSyntax _lhs;
-		Array<BitShiftRhsSyntax> _RhsSyntax;
+		SyntaxList<BitShiftRhsSyntax> _RhsSyntax;
 
 	public:
 
-		BitShiftExpressionSyntax(ExpressionSyntax&& lhs, Array<BitShiftRhsSyntax>&& RhsSyntax) :
+		BitShiftExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<BitShiftRhsSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	struct RelationalRhsSyntax
 	{
 		ExpressionSyntax expr;
 		RelationalType type;
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(expr);
+		}
 	};
 
 	class RelationalExpressionSyntax
@@ -286,20 +435,36 @@ namespace warbler
 	private:
 
 		ExpressionSyntax _lhs;
-		Array<RelationalRhsSyntax> _RhsSyntax;
+		SyntaxList<RelationalRhsSyntax> _RhsSyntax;
 
 	public:
 
-		RelationalExpressionSyntax(ExpressionSyntax&& lhs, Array<RelationalRhsSyntax>&& RhsSyntax) :
+		RelationalExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<RelationalRhsSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	struct EqualityRhsSyntax
 	{
 		ExpressionSyntax expr;
 		EqualityType type;
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(expr);
+		}
 	};
 
 	class EqualityExpressionSyntax
@@ -307,14 +472,24 @@ namespace warbler
 	private:
 
 		ExpressionSyntax _lhs;
-		Array<EqualityRhsSyntax> _RhsSyntax;
+		SyntaxList<EqualityRhsSyntax> _RhsSyntax;
 
 	public:
 
-		EqualityExpressionSyntax(ExpressionSyntax&& lhs, Array<EqualityRhsSyntax>&& RhsSyntax) :
+		EqualityExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<EqualityRhsSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	class BitwiseAndExpressionSyntax
@@ -322,14 +497,24 @@ namespace warbler
 	private:
 
 		ExpressionSyntax _lhs;
-		Array<ExpressionSyntax> _RhsSyntax;
+		SyntaxList<ExpressionSyntax> _RhsSyntax;
 
 	public:
 
-		BitwiseAndExpressionSyntax(ExpressionSyntax&& lhs, Array<ExpressionSyntax>&& RhsSyntax) :
+		BitwiseAndExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<ExpressionSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	class BitwiseXorExpressionSyntax
@@ -337,14 +522,24 @@ namespace warbler
 	private:
 
 		ExpressionSyntax _lhs;
-		Array<ExpressionSyntax> _RhsSyntax;
+		SyntaxList<ExpressionSyntax> _RhsSyntax;
 
 	public:
 
-		BitwiseXorExpressionSyntax(ExpressionSyntax&& lhs, Array<ExpressionSyntax>&& RhsSyntax) :
+		BitwiseXorExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<ExpressionSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	class BitwiseOrExpressionSyntax
@@ -352,14 +547,24 @@ namespace warbler
 	private:
 
 		ExpressionSyntax _lhs;
-		Array<ExpressionSyntax> _RhsSyntax;	
+		SyntaxList<ExpressionSyntax> _RhsSyntax;	
 
 	public:
 
-		BitwiseOrExpressionSyntax(ExpressionSyntax&& lhs, Array<ExpressionSyntax>&& RhsSyntax) :
+		BitwiseOrExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<ExpressionSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	class BooleanAndExpressionSyntax
@@ -367,14 +572,24 @@ namespace warbler
 	private:
 
 		ExpressionSyntax _lhs;
-		Array<ExpressionSyntax> _RhsSyntax;
+		SyntaxList<ExpressionSyntax> _RhsSyntax;
 
 	public:
 
-		BooleanAndExpressionSyntax(ExpressionSyntax&& lhs, Array<ExpressionSyntax>&& RhsSyntax) :
+		BooleanAndExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<ExpressionSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	class BooleanOrExpressionSyntax
@@ -382,25 +597,24 @@ namespace warbler
 	private:
 
 		ExpressionSyntax _lhs;
-		Array<ExpressionSyntax> _RhsSyntax;
+		SyntaxList<ExpressionSyntax> _RhsSyntax;
 
 	public:
 
-		BooleanOrExpressionSyntax(ExpressionSyntax&& lhs, Array<ExpressionSyntax>&& RhsSyntax) :
+		BooleanOrExpressionSyntax(ExpressionSyntax&& lhs, SyntaxList<ExpressionSyntax> RhsSyntax) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(std::move(RhsSyntax))
+		_RhsSyntax(RhsSyntax)
 		{}
-	};
 
-	struct ConditionalRhsSyntax
-	{
-		ExpressionSyntax _true_case;
-		ExpressionSyntax _false_case;
+		const auto& lhs() const { return _lhs; }
+		const auto& rhs() const { return _RhsSyntax; }
 
-		ConditionalRhsSyntax(ExpressionSyntax&& true_case, ExpressionSyntax&& false_case) :
-		_true_case(std::move(true_case)),
-		_false_case(std::move(false_case))
-		{}
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_RhsSyntax);
+		}
 	};
 
 	class ConditionalExpressionSyntax
@@ -408,41 +622,63 @@ namespace warbler
 	private: // members
 
 		ExpressionSyntax _lhs;
-		Optional<ConditionalRhsSyntax> _RhsSyntax;
+		ExpressionSyntax _true_case;
+		ExpressionSyntax _false_case;
 
 	public: // methods
 
-		ConditionalExpressionSyntax(ExpressionSyntax&& lhs) :
-		_lhs(std::move(lhs)),
-		_RhsSyntax()
-		{}
-
 		ConditionalExpressionSyntax(ExpressionSyntax&& lhs, ExpressionSyntax&& true_case, ExpressionSyntax&& false_case) :
 		_lhs(std::move(lhs)),
-		_RhsSyntax(Optional<ConditionalRhsSyntax>(ConditionalRhsSyntax { std::move(true_case), std::move(false_case) }))
+		_true_case(std::move(true_case)),
+		_false_case(std::move(false_case))
 		{}
+
+		const auto& lhs() const { return _lhs; }
+		const auto& true_case() const { return _true_case; }
+		const auto& false_case() const { return _false_case; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_true_case);
+			visitor(_false_case);
+		}
 	};
 
 	struct PtrSyntax
 	{
 		Token token;
 		bool is_mutable;
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(token);
+		}
 	};
 
 	class TypeAnnotationSyntax
 	{
 		Token _name;
-		Array<PtrSyntax> _ptrs;
+		SyntaxList<PtrSyntax> _ptrs;
 
 	public:
 
-		TypeAnnotationSyntax(const Token& name, Array<PtrSyntax>&& ptrs) :
+		TypeAnnotationSyntax(const Token& name, SyntaxList<PtrSyntax> ptrs) :
 		_name(name),
-		_ptrs(std::move(ptrs))
+		_ptrs(ptrs)
 		{}
 
 		const auto& name() const { return _name; }
 		const auto& ptrs() const { return _ptrs; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_name);
+			visitor(_ptrs);
+		}
 	};
 
 	class MemberSyntax
@@ -462,33 +698,47 @@ namespace warbler
 		const auto& name() const { return _name; }
 		const auto& type() const { return _type; }
 		const auto& is_public() const { return _is_public; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_name);
+			visitor(_type);
+		}
 	};
 
 	class EnumSyntax
 	{
-		Array<MemberSyntax> _values;
+		SyntaxList<MemberSyntax> _values;
 
 	public:
 
-		EnumSyntax(Array<MemberSyntax>&& values) :
-		_values(std::move(values))
+		EnumSyntax(SyntaxList<MemberSyntax> values) :
+		_values(values)
 		{}
 	};
 
 	class StructSyntax
 	{
 		Token _name;
-		Array<MemberSyntax> _members;
+		SyntaxList<MemberSyntax> _members;
 
 	public:
 
-		StructSyntax(const Token& name, Array<MemberSyntax>& members) :
+		StructSyntax(const Token& name, SyntaxList<MemberSyntax> members) :
 		_name(name),
-		_members(std::move(members))
+		_members(members)
 		{}
 
 		const auto& name() const { return _name; }
 		const auto& members() const { return _members; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_name);
+			visitor(_members);
+		}
 	};
 
 	class TypeSyntax
@@ -520,67 +770,85 @@ namespace warbler
 	private:
 
 		Token _name;
-		Optional<TypeAnnotationSyntax> _type;
+		// only meaningful when the type is not automatic
+		TypeAnnotationSyntax _type;
+		bool _is_auto_type;
 		bool _is_mutable;
 
 	public:
 
 		VariableSyntax(const Token& name, bool is_mutable):
 		_name(name),
-		_type(),
+		_type(name, SyntaxList<PtrSyntax>(0, 0, 0)),
+		_is_auto_type(true),
 		_is_mutable(is_mutable)
 		{}
 
 		VariableSyntax(const Token& name, TypeAnnotationSyntax&& type, bool is_mutable) :
 		_name(name),
 		_type(std::move(type)),
+		_is_auto_type(false),
 		_is_mutable(is_mutable)
 		{}
 
 		bool is_mutable() const { return _is_mutable; }
-		bool is_auto_type() const { return !_type.has_value(); }
+		bool is_auto_type() const { return _is_auto_type; }
 
 		const auto& name() const { return _name; }
-		const auto& type() const { assert(_type.has_value()); return *_type; }
+		const auto& type() const { assert(!_is_auto_type); return _type; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_name);
+			visitor(_type);
+		}
 	};
 
+	// like expressions, statements are handles to nodes in the pool
 	class StatementSyntax
 	{
-		union
-		{
-			Box<ExpressionStatementSyntax> _expression;
-			Box<BlockStatementSyntax> _block;
-			Box<DeclarationSyntax> _declaration;
-		};
-
+		u32 _index;
+		u16 _pool;
 		StatementType _type;
 
+		friend SyntaxRelocator;
+
+		template <typename T>
+		StatementSyntax(T&& node, StatementType type);
+
+		template <typename T>
+		const T& get(StatementType type) const;
+
 	public:
 
 		StatementSyntax(ExpressionStatementSyntax&&);
 		StatementSyntax(BlockStatementSyntax&&);
 		StatementSyntax(DeclarationSyntax&&);
-		StatementSyntax(StatementSyntax&&);
-		StatementSyntax(const StatementSyntax&) = delete;
-		~StatementSyntax();
 		
 		const auto& type() const { return _type; }
-		const auto& expression() const { assert(_type == StatementType::Expression); return *_expression; }
-		const auto& declaration() const { assert(_type == StatementType::Declaration); return *_declaration; }
-		const auto& block() const { assert(_type == StatementType::Block); return *_block; }
+		const auto& expression() const { return get<ExpressionStatementSyntax>(StatementType::Expression); }
+		const auto& declaration() const { return get<DeclarationSyntax>(StatementType::Declaration); }
+		const auto& block() const { return get<BlockStatementSyntax>(StatementType::Block); }
 	};
 
 	class BlockStatementSyntax
 	{
-		Array<StatementSyntax> _statements;
+		SyntaxList<StatementSyntax> _statements;
 
 	public:
 
-		BlockStatementSyntax(Array<StatementSyntax>&& statements) :
-		_statements(std::move(statements))
+		BlockStatementSyntax(SyntaxList<StatementSyntax> statements) :
+		_statements(statements)
 		{}
 
 		const auto& statements() const { return _statements; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_statements);
+		}
 	};
 
 	class JumpStatementSyntax
@@ -603,19 +871,29 @@ namespace warbler
 		union
 		{
 			BlockStatementSyntax _else_body;
-			IfStatementSyntax *_else_if;
+			// index of the else if in the pool
+			u32 _else_if;
 		};
 
 		IfType _type;
 
+		friend SyntaxRelocator;
+
 	public:
 
 		IfStatementSyntax(ExpressionSyntax&& condition, BlockStatementSyntax&& then_body);
 		IfStatementSyntax(ExpressionSyntax&& condition, BlockStatementSyntax&& then_body, BlockStatementSyntax&& else_body);
-		IfStatementSyntax(ExpressionSyntax&& condition, BlockStatementSyntax&& then_body, IfStatementSyntax *else_if);
-		IfStatementSyntax(IfStatementSyntax&& other);
-		IfStatementSyntax(const IfStatementSyntax& other) = delete;
-		~IfStatementSyntax();
+		IfStatementSyntax(ExpressionSyntax&& condition, BlockStatementSyntax&& then_body, IfStatementSyntax&& else_if);
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_condition);
+			visitor(_then_body);
+
+			if (_type == IfType::ThenElse)
+				visitor(_else_body);
+		}
 	};
 
 	class ExpressionStatementSyntax
@@ -631,6 +909,12 @@ namespace warbler
 		{}
 
 		const auto& expression() const { return _expression; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_expression);
+		}
 	};
 
 	class DeclarationSyntax
@@ -647,6 +931,13 @@ namespace warbler
 
 		const auto& variable() const { return _variable; }
 		const auto& value() const { return _value; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_variable);
+			visitor(_value);
+		}
 	};
 
 	class AssignmentSyntax
@@ -666,17 +957,24 @@ namespace warbler
 		const auto& lhs() const { return _lhs; }
 		const auto& rhs() const { return _rhs; }
 		const auto& type() const { return _type; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_lhs);
+			visitor(_rhs);
+		}
 	};
 
 	class LoopStatementSyntax
 	{
-		Array<StatementSyntax> _body;
+		SyntaxList<StatementSyntax> _body;
 		//LoopCondition _condition;
 		LoopType _type;
 
 	public:
 
-		LoopStatementSyntax(Array<StatementSyntax>&& body, LoopType type);
+		LoopStatementSyntax(SyntaxList<StatementSyntax> body, LoopType type);
 	};
 
 	class ParameterSyntax
@@ -696,72 +994,158 @@ namespace warbler
 		const auto& name() const { return _name; }
 		const auto& type() const { return _type; }
 		const auto& is_mutable() const { return _is_mutable; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_name);
+			visitor(_type);
+		}
 	};
 
 	class FunctionSignatureSyntax
 	{
-		Array<ParameterSyntax> _parameters;
+		SyntaxList<ParameterSyntax> _parameters;
 		Optional<TypeAnnotationSyntax> _return_type;
 	
 	public:
 
-		FunctionSignatureSyntax(Array<ParameterSyntax>&& parameters):
-		_parameters(std::move(parameters)),
+		FunctionSignatureSyntax(SyntaxList<ParameterSyntax> parameters):
+		_parameters(parameters),
 		_return_type()
 		{}
 
-		FunctionSignatureSyntax(Array<ParameterSyntax>&& parameters, TypeAnnotationSyntax&& return_type) :
-		_parameters(std::move(parameters)),
+		FunctionSignatureSyntax(SyntaxList<ParameterSyntax> parameters, TypeAnnotationSyntax&& return_type) :
+		_parameters(parameters),
 		_return_type(std::move(return_type))
 		{}
 
 		const auto& parameters() const { return _parameters; }
 		const auto& return_type() const { return _return_type; }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_parameters);
+
+			if (_return_type)
+				visitor(*_return_type);
+		}
+	};
+
+	// text between two source locations
+	struct SourceRange
+	{
+		u32 location;
+		u32 length;
 	};
 
 	class FunctionSyntax
 	{
 		Token _name;		
 		FunctionSignatureSyntax _signature;
+		// empty until a skipped body is parsed, but always in the pool of the function
 		BlockStatementSyntax _body;
+		// braces of a body that was skipped
+		SourceRange _body_range;
+		bool _is_body_parsed;
 
 	public:
 
 		FunctionSyntax(const Token& name, FunctionSignatureSyntax&& signature, BlockStatementSyntax&& body) :
 		_name(name),
 		_signature(std::move(signature)),
-		_body(std::move(body))
+		_body(std::move(body)),
+		_body_range({ 0, 0 }),
+		_is_body_parsed(true)
 		{}
 
+		FunctionSyntax(const Token& name, FunctionSignatureSyntax&& signature, const SourceRange& body_range, u16 pool) :
+		_name(name),
+		_signature(std::move(signature)),
+		_body(SyntaxList<StatementSyntax>(pool, 0, 0)),
+		_body_range(body_range),
+		_is_body_parsed(false)
+		{}
+
+		void set_body(BlockStatementSyntax&& body)
+		{
+			_body = std::move(body);
+			_is_body_parsed = true;
+		}
+
 		const auto& name() const { return _name; }
 		const auto& signature() const { return _signature; }
-		const auto& body() const { return _body; }
+		const auto& body() const { assert(_is_body_parsed); return _body; }
+		const auto& body_range() const { assert(!_is_body_parsed); return _body_range; }
+		const auto& is_body_parsed() const { return _is_body_parsed; }
+		u16 pool() const { return _body.statements().pool(); }
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(_name);
+			visitor(_signature);
+			visitor(_body);
+
+			if (!_is_body_parsed)
+				visitor(_body_range);
+		}
+	};
+
+	// where a top-level declaration is in the text of its module
+	struct DeclarationSpan
+	{
+		u32 pos;
+		u32 end;
+		// index into the functions or structs of the module
+		u32 index;
+		// nodes added to the pool while the declaration was parsed
+		u32 node_count;
+		bool is_function;
 	};
 	
 	struct ModuleSyntax
 	{
+		// declared first so that it outlives the syntax that refers to it
+		Box<SyntaxPool> pool;
 		Array<FunctionSyntax> functions;
 		Array<StructSyntax> structs;
+		// every function and struct in the order they are in the file, so that an edit of the
+		// file can be reparsed one declaration at a time
+		Array<DeclarationSpan> declarations;
+		// base of the file the tokens are in
+		u32 base;
+		// whether function bodies were skipped, which edits are then reparsed with as well
+		bool skip_bodies;
+		// nodes of declarations replaced by reparsing edits that are still in the pool
+		usize dead_node_count;
 	};
 
 	class PackageSyntax
 	{
 		String _name;
+		// the pools of the modules that make up the package
+		Array<Box<SyntaxPool>> _pools;
 		Array<FunctionSyntax> _functions;
 		Array<StructSyntax> _structs;
 		// TODO: add globals
 
 	public:
 
-		PackageSyntax(const String& name, Array<FunctionSyntax>&& functions, Array<StructSyntax>&& structs) :
+		PackageSyntax(const String& name, Array<Box<SyntaxPool>>&& pools, Array<FunctionSyntax>&& functions, Array<StructSyntax>&& structs) :
 		_name(name),
+		_pools(std::move(pools)),
 		_functions(std::move(functions)),
 		_structs(std::move(structs))
 		{}
 		
 		const auto& name() const { return _name; }
 		const auto& functions() const { return _functions; }
+		auto& functions() { return _functions; }
 		const auto& structs() const { return _structs; }
+
+		SyntaxPool *find_pool(u16 id);
 	};
 
 	class ProgramSyntax
@@ -775,7 +1159,215 @@ namespace warbler
 		{}
 
 		const auto& packages() const { return _packages; }
+		auto& packages() { return _packages; }
+	};
+
+	// Typed storage for every node parsed from a module. Nodes refer to each other by index, so
+	// each type is kept contiguously and the nodes can be copied as plain memory. Pools are
+	// registered under a u16 id that handles use to find them again.
+	class SyntaxPool
+	{
+	private:
+
+		template <typename... Types>
+		struct Storage
+		{
+			static_assert((std::is_trivially_copyable_v<Types> && ...), "pooled syntax must be trivially copyable");
+
+			std::tuple<Array<Types>...> arrays;
+		};
+
+		using Nodes = Storage<
+			AssignmentSyntax,
+			ConditionalExpressionSyntax,
+			BooleanOrExpressionSyntax,
+			BooleanAndExpressionSyntax,
+			BitwiseOrExpressionSyntax,
+			BitwiseXorExpressionSyntax,
+			BitwiseAndExpressionSyntax,
+			EqualityExpressionSyntax,
+			RelationalExpressionSyntax,
+			BitShiftExpressionSyntax,
+			AdditiveExpressionSyntax,
+			MultiplicativeExpressionSyntax,
+			PrefixExpressionSyntax,
+			PostfixExpressionSyntax,
+			PrimaryExpressionSyntax,
+			ConstantSyntax,
+			SymbolSyntax,
+			ExpressionSyntax,
+			MultiplicativeRhsSyntax,
+			AdditiveRhsSyntax,
+			BitShiftRhsSyntax,
+			RelationalRhsSyntax,
+			EqualityRhsSyntax,
+			StatementSyntax,
+			ExpressionStatementSyntax,
+			BlockStatementSyntax,
+			DeclarationSyntax,
+			IfStatementSyntax,
+			PtrSyntax,
+			MemberSyntax,
+			ParameterSyntax>;
+
+		Nodes _nodes;
+		Nodes _scratch;
+		u16 _id;
+
+		template <typename Function, usize... Indices>
+		void for_each_array(Function& function, std::index_sequence<Indices...>)
+		{
+			(function(std::get<Indices>(_nodes.arrays)), ...);
+		}
+
+		template <typename Function, usize... Indices>
+		void for_each_array(Function& function, std::index_sequence<Indices...>) const
+		{
+			(function(std::get<Indices>(_nodes.arrays)), ...);
+		}
+
+	public:
+
+		SyntaxPool();
+		SyntaxPool(const SyntaxPool&) = delete;
+		SyntaxPool(SyntaxPool&&) = delete;
+		~SyntaxPool();
+
+		// the pool that nodes are currently being added to. this is the one set by the
+		// innermost SyntaxPoolScope on this thread, or one that lives as long as the thread
+		static SyntaxPool& current();
+		static const SyntaxPool& get(u16 id);
+
+		template <typename T>
+		u32 add(T&& node)
+		{
+			auto& nodes = std::get<Array<T>>(_nodes.arrays);
+
+			if (nodes.size() >= UINT32_MAX)
+				throw std::runtime_error("Number of syntax nodes in module exceeds the maximum of 4294967295.");
+
+			nodes.push_back(std::move(node));
+
+			return static_cast<u32>(nodes.size() - 1);
+		}
+
+		template <typename T>
+		const Array<T>& nodes() const { return std::get<Array<T>>(_nodes.arrays); }
+
+		// calls function with the node array of every pooled type, always in the same order
+		template <typename Function>
+		void for_each_array(Function&& function)
+		{
+			for_each_array(function, std::make_index_sequence<std::tuple_size_v<decltype(_nodes.arrays)>>());
+		}
+
+		template <typename Function>
+		void for_each_array(Function&& function) const
+		{
+			for_each_array(function, std::make_index_sequence<std::tuple_size_v<decltype(_nodes.arrays)>>());
+		}
+
+		template <typename T>
+		Array<T>& scratch() { return std::get<Array<T>>(_scratch.arrays); }
+
+		template <typename T>
+		SyntaxList<T> add_list(usize start)
+		{
+			auto& scratch = std::get<Array<T>>(_scratch.arrays);
+			auto& nodes = std::get<Array<T>>(_nodes.arrays);
+			auto first = nodes.size();
+
+			if (first + (scratch.size() - start) > UINT32_MAX)
+				throw std::runtime_error("Number of syntax nodes in module exceeds the maximum of 4294967295.");
+
+			nodes.insert(nodes.end(), scratch.begin() + start, scratch.end());
+			scratch.erase(scratch.begin() + start, scratch.end());
+
+			return SyntaxList<T>(_id, static_cast<u32>(first), static_cast<u32>(nodes.size() - first));
+		}
+
+		usize node_count() const
+		{
+			usize count = 0;
+
+			for_each_array([&](const auto& nodes) { count += nodes.size(); });
+
+			return count;
+		}
+
+		u16 id() const { return _id; }
+	};
+
+	// makes a pool the current one for the thread until the scope ends
+	class SyntaxPoolScope
+	{
+	private:
+
+		SyntaxPool *_previous;
+
+	public:
+
+		SyntaxPoolScope(SyntaxPool& pool);
+		SyntaxPoolScope(const SyntaxPoolScope&) = delete;
+		~SyntaxPoolScope();
 	};
+
+	template <typename T>
+	const T *SyntaxList<T>::begin() const { return SyntaxPool::get(_pool).nodes<T>().data() + _first; }
+
+	template <typename T>
+	SyntaxListBuilder<T>::SyntaxListBuilder() :
+	_pool(&SyntaxPool::current()),
+	_start(_pool->scratch<T>().size()),
+	_is_finished(false)
+	{}
+
+	template <typename T>
+	SyntaxListBuilder<T>::~SyntaxListBuilder()
+	{
+		if (_is_finished)
+			return;
+
+		auto& scratch = _pool->scratch<T>();
+
+		scratch.erase(scratch.begin() + _start, scratch.end());
+	}
+
+	template <typename T>
+	void SyntaxListBuilder<T>::push_back(T&& value)
+	{
+		assert(!_is_finished);
+		_pool->scratch<T>().push_back(std::move(value));
+	}
+
+	template <typename T>
+	usize SyntaxListBuilder<T>::size() const
+	{
+		return _pool->scratch<T>().size() - _start;
+	}
+
+	template <typename T>
+	SyntaxList<T> SyntaxListBuilder<T>::finish()
+	{
+		assert(!_is_finished);
+		_is_finished = true;
+
+		return _pool->add_list<T>(_start);
+	}
+
+	template <typename T>
+	const T& ExpressionSyntax::get(ExpressionType type) const
+	{
+		assert(_type == type);
+		return SyntaxPool::get(_pool).nodes<T>()[_index];
+	}
+
+	template <typename T>
+	const T& StatementSyntax::get(StatementType type) const
+	{
+		assert(_type == type);
+		return SyntaxPool::get(_pool).nodes<T>()[_index];
+	}
 }
 
 /*
@@ -0,0 +1,37 @@
+#ifndef WARBLER_SYNTAX_CACHE_HPP
+#define WARBLER_SYNTAX_CACHE_HPP
+
+#include <warbler/syntax.hpp>
+
+#include <atomic>
+
+namespace warbler
+{
+	// Stores parsed modules on disk, keyed by a hash of the file's text and the compiler and
+	// parser versions. A file that has not changed since it was last parsed is loaded from its
+	// entry instead of being lexed and parsed again. Entries are the pool's node arrays as they
+	// are in memory, so loading copies each array in one go and then makes a single pass to point
+	// the tokens, handles and lists at the new file and pool. Entries that fail their checksum or
+	// hold anything out of range are treated as misses.
+	class SyntaxCache
+	{
+		String _directory;
+		u64 _version_hash;
+		std::atomic<usize> _hits;
+		std::atomic<usize> _misses;
+
+	public:
+
+		SyntaxCache(const String& directory);
+		SyntaxCache(const SyntaxCache&) = delete;
+
+		// safe to call from several threads at once
+		Result<ModuleSyntax> parse_module(const File& file, bool skip_bodies = false);
+
+		const auto& directory() const { return _directory; }
+		usize hits() const { return _hits; }
+		usize misses() const { return _misses; }
+	};
+}
+
+#endif
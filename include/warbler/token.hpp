@@ -3,11 +3,13 @@
 
 // local includes
 #include <warbler/file.hpp>
+#include <warbler/source_manager.hpp>
+#include <warbler/interner.hpp>
 #include <warbler/util/primitive.hpp>
 
 namespace warbler
 {
-	enum class TokenType
+	enum class TokenType : u8
 	{
 		EndOfFile,
 		Identifier,
@@ -95,33 +97,130 @@ namespace warbler
 		KeywordWhile,
 	};
 
+	// Tokens are stored by value throughout the syntax tree, so they only hold a global source
+	// location and decode it through the SourceManager when the file or text is needed.
+	// Identifiers also carry the atom their text was interned as while lexing.
 	class Token
 	{
 	private:
 
-		const File& _file;
-		usize _pos;
-		usize _length;
+		u32 _location;
+		u16 _length;
 		TokenType _type;
+		u32 _atom;
 
 	public:
 
-		Token(const File& file, usize pos, usize length, TokenType type);
+		Token(u32 location, usize length, TokenType type, u32 atom = 0);
 
 		static Token get_initial(const File& file);
 
 		void increment();
 
-		const File& file() const { return _file; }
-		usize pos() const { return _pos; }
+		const File& file() const { return SourceManager::get_file(_location); }
+		u32 location() const { return _location; }
+		usize pos() const { return file().get_pos(_location); }
 		usize length() const { return _length; }
 		TokenType type() const { return _type; }
-		String text() const { return _file.get_text(_pos, _length); }
+		u32 atom() const { assert(_type == TokenType::Identifier); return _atom; }
+		String text() const;
+		StringView view() const;
 		operator String() const;
 		const char *category() const;
-		char operator[](usize i) const { assert(i < _length); return _file[_pos + i]; }
+		char operator[](usize i) const;
 		bool operator==(const String& text) const;
 	};
+
+	static_assert(sizeof(Token) == 12);
+
+	class TokenBuffer
+	{
+	private:
+
+		const File *_file;
+		Array<TokenType> _types;
+		Array<u32> _locations;
+		Array<u16> _lengths;
+		Array<u32> _atoms;
+
+		TokenBuffer(const File& file);
+
+		void reserve(usize count);
+		void push(const Token& token);
+		void append(const TokenBuffer& other, usize first);
+		void lex_chunk(usize pos, usize end, InternCache& cache);
+
+	public:
+
+		static TokenBuffer lex(const File& file);
+		// Lexes a single file on several threads by splitting it into chunks at line breaks. A chunk
+		// may start inside a string or block comment, so its tokens are only used once the serial
+		// position is found among them. The tokens are always the same as those given by lex().
+		// A chunk_count of 0 picks one chunk per hardware thread, as long as chunks are big enough.
+		static TokenBuffer lex_parallel(const File& file, usize chunk_count = 0);
+		// Lexes from pos, which has to be in between tokens, until the lexer lands exactly on one of
+		// the sorted boundaries. Boundaries that are passed inside of a token or comment are skipped.
+		// The tokens end with an end of file token at the boundary, or at the end of the file if the
+		// lexer never lands on one.
+		static TokenBuffer lex_until(const File& file, usize pos, const Array<usize>& boundaries);
+		// lexes the tokens that start in between pos and end, followed by an end of file token at end
+		static TokenBuffer lex_range(const File& file, usize pos, usize end);
+
+		Token at(usize i) const { assert(i < size()); return Token(_locations[i], _lengths[i], _types[i], _atoms[i]); }
+		TokenType type(usize i) const { assert(i < size()); return _types[i]; }
+		u32 location(usize i) const { assert(i < size()); return _locations[i]; }
+		usize pos(usize i) const { assert(i < size()); return _locations[i] - _file->base(); }
+		usize length(usize i) const { assert(i < size()); return _lengths[i]; }
+		u32 atom(usize i) const { assert(i < size() && _types[i] == TokenType::Identifier); return _atoms[i]; }
+		usize size() const { return _types.size(); }
+		const File& file() const { return *_file; }
+	};
+
+	class TokenIterator
+	{
+	private:
+
+		const TokenBuffer *_tokens;
+		usize _index;
+
+	public:
+
+		TokenIterator(const TokenBuffer& tokens, usize index = 0) :
+		_tokens(&tokens),
+		_index(index)
+		{
+			assert(index < tokens.size());
+		}
+
+		void increment()
+		{
+			// the last token is always end of file, so the cursor stays on it
+			if (_index + 1 < _tokens->size())
+				_index += 1;
+		}
+
+		TokenType peek(usize offset = 1) const
+		{
+			auto index = _index + offset;
+
+			return index < _tokens->size()
+				? _tokens->type(index)
+				: TokenType::EndOfFile;
+		}
+
+		void seek(usize index) { assert(index < _tokens->size()); _index = index; }
+
+		usize index() const { return _index; }
+		TokenType type() const { return _tokens->type(_index); }
+		usize pos() const { return _tokens->pos(_index); }
+		usize length() const { return _tokens->length(_index); }
+		u32 atom() const { return _tokens->atom(_index); }
+		const File& file() const { return _tokens->file(); }
+		String text() const { return file().get_text(pos(), length()); }
+		StringView view() const { return file().get_view(pos(), length()); }
+		char operator[](usize i) const { assert(i < length()); return file()[pos() + i]; }
+		Token operator*() const { return _tokens->at(_index); }
+	};
 }
 
 #endif
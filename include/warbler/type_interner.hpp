@@ -0,0 +1,37 @@
+#ifndef WARBLER_TYPE_INTERNER_HPP
+#define WARBLER_TYPE_INTERNER_HPP
+
+#include <warbler/type.hpp>
+#include <warbler/util/primitive.hpp>
+
+namespace warbler
+{
+	struct TypeData
+	{
+		// primitive or struct index of the type at the end of the pointer chain
+		u32 index;
+		// id of the type pointed to if ptr_depth is not 0
+		u32 pointee;
+		u32 ptr_depth;
+		AnnotationType type;
+		// whether the outermost pointer is mutable
+		bool is_mutable;
+	};
+
+	// Every distinct type, a primitive or struct with the chain of pointers to it, is given a
+	// dense u32 id the first time it is interned, so types can be stored and compared as
+	// integers. A pointer is interned as the id of the type it points to and its mutability,
+	// so every type in a chain is interned only once. The primitives are interned before any
+	// other type, so the id of a primitive is its index.
+	class TypeInterner
+	{
+	public:
+
+		static u32 intern(AnnotationType type, usize index);
+		static u32 intern_pointer(u32 pointee, bool is_mutable);
+		static TypeData get(u32 id);
+		static usize size();
+	};
+}
+
+#endif
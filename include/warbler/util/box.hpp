@@ -55,8 +55,19 @@ namespace warbler
 		T& operator*() { return *_value; }
 		const T& operator*() const { return *_value; }
 
-		Box& operator=(Box&& other) { new (this) auto(std::move(other)); return *this; }
-		Box& operator=(T* ptr) { new (this) auto(ptr); return *this; }
+		Box& operator=(Box&& other)
+		{
+			if (this != &other)
+			{
+				delete _value;
+				_value = other._value;
+				other._value = nullptr;
+			}
+
+			return *this;
+		}
+
+		Box& operator=(T* ptr) { fill(ptr); return *this; }
 
 		T* raw_ptr() { return _value; }
 		const T* raw_ptr() const { return _value; }
@@ -3,9 +3,39 @@
 
 #include <warbler/util/string.hpp>
 #include <warbler/util/result.hpp>
+#include <warbler/util/primitive.hpp>
 
 namespace warbler
 {
+	// read-only memory mapping of a file that is followed by at least one
+	// zeroed byte so the text can be treated as null terminated
+	class MappedFile
+	{
+	private:
+
+		char *_data;
+		usize _size;
+		usize _mapping_size;
+
+		MappedFile(char *data, usize size, usize mapping_size);
+
+	public:
+
+		MappedFile();
+		MappedFile(MappedFile&& other);
+		MappedFile(const MappedFile&) = delete;
+		~MappedFile();
+
+		MappedFile& operator=(MappedFile&&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		static Result<MappedFile> map(const String& filepath);
+
+		const char *data() const { return _data; }
+		usize size() const { return _size; }
+		bool is_mapped() const { return _data != nullptr; }
+	};
+
 	Result<String> read_file(const String& filepath);
 	bool write_file(const String& filepath, const String& content);
 }
@@ -0,0 +1,359 @@
+#ifndef WARBLER_UTIL_FLAT_MAP_HPP
+#define WARBLER_UTIL_FLAT_MAP_HPP
+
+#include <warbler/util/array.hpp>
+#include <warbler/util/primitive.hpp>
+
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WARBLER_FLAT_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace warbler
+{
+	// Open addressing hash map laid out like a Swiss table. Every slot has a control byte that is
+	// either empty or holds 7 bits of the hash of the key in it, and the 16 control bytes of a
+	// group are compared against a hash at once, so keys are only compared when those bits
+	// match. Slots only hold the index of their entry. Entries are kept in insertion order in
+	// segments that are never moved, so references to them stay valid while the map grows and
+	// iterating it gives the same order every run. Entries cannot be erased.
+	template <typename Key, typename T, typename Hash>
+	class FlatMap
+	{
+	public:
+
+		using key_type = Key;
+		using mapped_type = T;
+		using value_type = std::pair<const Key, T>;
+
+		template <bool IsConst>
+		class Iterator
+		{
+			using Map = std::conditional_t<IsConst, const FlatMap, FlatMap>;
+
+			Map *_map;
+			usize _index;
+
+		public:
+
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = FlatMap::value_type;
+			using difference_type = std::ptrdiff_t;
+			using pointer = std::conditional_t<IsConst, const value_type *, value_type *>;
+			using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+
+			Iterator(Map *map, usize index) :
+			_map(map),
+			_index(index)
+			{}
+
+			template <bool OtherIsConst, typename = std::enable_if_t<IsConst && !OtherIsConst>>
+			Iterator(const Iterator<OtherIsConst>& other) :
+			_map(other._map),
+			_index(other._index)
+			{}
+
+			reference operator*() const { return _map->get_entry(_index); }
+			pointer operator->() const { return &_map->get_entry(_index); }
+
+			Iterator& operator++() { _index += 1; return *this; }
+			Iterator operator++(int) { auto previous = *this; _index += 1; return previous; }
+
+			bool operator==(const Iterator& other) const { return _index == other._index; }
+			bool operator!=(const Iterator& other) const { return _index != other._index; }
+
+			friend class Iterator<!IsConst>;
+		};
+
+		using iterator = Iterator<false>;
+		using const_iterator = Iterator<true>;
+
+	private:
+
+		static constexpr usize group_width = 16;
+		static constexpr usize first_segment_size = 8;
+		static constexpr u8 empty_control = 0x80;
+
+		Array<u8> _controls;
+		Array<u32> _slots;
+		Array<value_type *> _segments;
+		usize _size = 0;
+		usize _group_mask = 0;
+
+		static u32 count_trailing_zeros(u32 mask)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return index;
+#else
+			return __builtin_ctz(mask);
+#endif
+		}
+
+		static usize get_floor_log2(usize value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return index;
+#else
+			return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(value);
+#endif
+		}
+
+		// bit i of the result is set if control byte i of the group equals the given byte
+		static u32 match_group(const u8 *group, u8 control)
+		{
+#ifdef WARBLER_FLAT_MAP_SSE2
+			auto controls = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+			auto matches = _mm_cmpeq_epi8(controls, _mm_set1_epi8(static_cast<char>(control)));
+
+			return static_cast<u32>(_mm_movemask_epi8(matches));
+#else
+			u32 mask = 0;
+
+			for (usize i = 0; i < group_width; ++i)
+				mask |= static_cast<u32>(group[i] == control) << i;
+
+			return mask;
+#endif
+		}
+
+		static u8 get_control(u64 hash) { return static_cast<u8>(hash >> 57); }
+
+		// segment i holds first_segment_size << i entries
+		static usize get_segment(usize index) { return get_floor_log2(index / first_segment_size + 1); }
+		static usize get_segment_start(usize segment) { return first_segment_size * ((usize(1) << segment) - 1); }
+
+		value_type& get_entry(usize index)
+		{
+			auto segment = get_segment(index);
+
+			return _segments[segment][index - get_segment_start(segment)];
+		}
+
+		const value_type& get_entry(usize index) const
+		{
+			auto segment = get_segment(index);
+
+			return _segments[segment][index - get_segment_start(segment)];
+		}
+
+		template <typename K>
+		usize find_index(const K& key, u64 hash) const
+		{
+			if (_controls.empty())
+				return _size;
+
+			auto control = get_control(hash);
+			auto group = static_cast<usize>(hash) & _group_mask;
+
+			// stepping by 1, 2, 3, ... groups visits every group as the group count is a power of 2
+			for (usize step = 1;; ++step)
+			{
+				const auto *controls = _controls.data() + group * group_width;
+
+				for (auto matches = match_group(controls, control); matches != 0; matches &= matches - 1)
+				{
+					auto index = _slots[group * group_width + count_trailing_zeros(matches)];
+
+					if (get_entry(index).first == key)
+						return index;
+				}
+
+				// the key would have been put in the empty slot if it were in the map
+				if (match_group(controls, empty_control) != 0)
+					return _size;
+
+				group = (group + step) & _group_mask;
+			}
+		}
+
+		void insert_slot(u32 index, u64 hash)
+		{
+			auto group = static_cast<usize>(hash) & _group_mask;
+
+			for (usize step = 1;; ++step)
+			{
+				auto empties = match_group(_controls.data() + group * group_width, empty_control);
+
+				if (empties != 0)
+				{
+					auto slot = group * group_width + count_trailing_zeros(empties);
+
+					_controls[slot] = get_control(hash);
+					_slots[slot] = index;
+
+					return;
+				}
+
+				group = (group + step) & _group_mask;
+			}
+		}
+
+		void rehash(usize group_count)
+		{
+			_controls.assign(group_count * group_width, empty_control);
+			_slots.resize(group_count * group_width);
+			_group_mask = group_count - 1;
+
+			for (usize i = 0; i < _size; ++i)
+				insert_slot(static_cast<u32>(i), Hash()(get_entry(i).first));
+		}
+
+		template <typename K, typename... Args>
+		void push_entry(const K& key, Args&&... args)
+		{
+			if (_size == get_segment_start(_segments.size()))
+			{
+				auto count = first_segment_size << _segments.size();
+
+				_segments.push_back(static_cast<value_type *>(::operator new(count * sizeof(value_type))));
+			}
+
+			auto *entry = &get_entry(_size);
+
+			new (entry) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+			_size += 1;
+		}
+
+		void clear_entries()
+		{
+			for (usize i = 0; i < _size; ++i)
+				get_entry(i).~value_type();
+
+			for (auto *segment : _segments)
+				::operator delete(segment);
+
+			_segments.clear();
+			_size = 0;
+		}
+
+	public:
+
+		FlatMap() = default;
+
+		FlatMap(const FlatMap& other) :
+		_controls(other._controls),
+		_slots(other._slots),
+		_group_mask(other._group_mask)
+		{
+			for (const auto& entry : other)
+				push_entry(entry.first, entry.second);
+		}
+
+		FlatMap(FlatMap&& other) noexcept :
+		_controls(std::move(other._controls)),
+		_slots(std::move(other._slots)),
+		_segments(std::move(other._segments)),
+		_size(other._size),
+		_group_mask(other._group_mask)
+		{
+			other._controls.clear();
+			other._segments.clear();
+			other._size = 0;
+		}
+
+		~FlatMap() { clear_entries(); }
+
+		FlatMap& operator=(const FlatMap& other)
+		{
+			if (this != &other)
+				*this = FlatMap(other);
+
+			return *this;
+		}
+
+		FlatMap& operator=(FlatMap&& other) noexcept
+		{
+			if (this == &other)
+				return *this;
+
+			clear_entries();
+
+			_controls = std::move(other._controls);
+			_slots = std::move(other._slots);
+			_segments = std::move(other._segments);
+			_size = other._size;
+			_group_mask = other._group_mask;
+
+			other._controls.clear();
+			other._segments.clear();
+			other._size = 0;
+
+			return *this;
+		}
+
+		template <typename K>
+		iterator find(const K& key) { return iterator(this, find_index(key, Hash()(key))); }
+
+		template <typename K>
+		const_iterator find(const K& key) const { return const_iterator(this, find_index(key, Hash()(key))); }
+
+		template <typename K>
+		T& at(const K& key)
+		{
+			auto index = find_index(key, Hash()(key));
+
+			if (index == _size)
+				throw std::out_of_range("key was not found in table");
+
+			return get_entry(index).second;
+		}
+
+		template <typename K>
+		const T& at(const K& key) const
+		{
+			auto index = find_index(key, Hash()(key));
+
+			if (index == _size)
+				throw std::out_of_range("key was not found in table");
+
+			return get_entry(index).second;
+		}
+
+		template <typename K>
+		bool contains(const K& key) const { return find_index(key, Hash()(key)) != _size; }
+
+		// the value is only constructed if the key is not already in the map
+		template <typename K, typename... Args>
+		std::pair<iterator, bool> emplace(const K& key, Args&&... args)
+		{
+			auto hash = Hash()(key);
+			auto index = find_index(key, hash);
+
+			if (index != _size)
+				return { iterator(this, index), false };
+
+			// kept at most 7/8 full so that every probe sequence reaches an empty slot
+			if ((_size + 1) * 8 > _controls.size() * 7)
+				rehash(_controls.empty() ? 1 : (_group_mask + 1) * 2);
+
+			push_entry(key, std::forward<Args>(args)...);
+			insert_slot(static_cast<u32>(index), hash);
+
+			return { iterator(this, index), true };
+		}
+
+		usize size() const { return _size; }
+		bool empty() const { return _size == 0; }
+
+		iterator begin() { return iterator(this, 0); }
+		iterator end() { return iterator(this, _size); }
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, _size); }
+	};
+}
+
+#endif
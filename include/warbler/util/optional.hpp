@@ -2,6 +2,7 @@
 #define WARBLER_UTIL_OPTIONAL_HPP
 
 #include <cassert>
+#include <new>
 
 namespace warbler
 {
@@ -53,7 +54,12 @@ namespace warbler
 
 		Optional& operator=(T&& other)
 		{
-			new(this) auto(std::move(other));
+			if (_has_value)
+				_value.~T();
+
+			new (&_value) T(std::move(other));
+			_has_value = true;
+
 			return *this;
 		}
 
@@ -0,0 +1,86 @@
+#ifndef WARBLER_UTIL_PARALLEL_HPP
+#define WARBLER_UTIL_PARALLEL_HPP
+
+#include <warbler/util/array.hpp>
+#include <warbler/util/primitive.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace warbler
+{
+	inline usize get_worker_count(usize task_count)
+	{
+		usize hardware_count = std::thread::hardware_concurrency();
+
+		if (hardware_count == 0)
+			hardware_count = 1;
+
+		return std::min(hardware_count, task_count);
+	}
+
+	// Calls task(i) for every i below task_count on a pool of worker threads that take the next
+	// index as soon as they finish one, so uneven tasks still keep every worker busy. The
+	// calling thread is one of the workers. The first exception thrown by a task is rethrown
+	// once every worker has stopped.
+	template <typename Task>
+	void parallel_for(usize task_count, Task&& task, usize worker_count = 0)
+	{
+		if (worker_count == 0)
+			worker_count = get_worker_count(task_count);
+
+		// workers beyond one per task would only be started and joined
+		worker_count = std::min(worker_count, task_count);
+
+		if (worker_count <= 1)
+		{
+			for (usize i = 0; i < task_count; ++i)
+				task(i);
+
+			return;
+		}
+
+		std::atomic<usize> next_index = 0;
+		std::exception_ptr exception;
+		std::mutex exception_mutex;
+
+		auto work = [&]()
+		{
+			try
+			{
+				for (auto i = next_index++; i < task_count; i = next_index++)
+					task(i);
+			}
+			catch (...)
+			{
+				std::lock_guard lock(exception_mutex);
+
+				if (!exception)
+					exception = std::current_exception();
+
+				// skipping the remaining tasks
+				next_index = task_count;
+			}
+		};
+
+		Array<std::thread> workers;
+
+		workers.reserve(worker_count - 1);
+
+		for (usize i = 1; i < worker_count; ++i)
+			workers.emplace_back(work);
+
+		work();
+
+		for (auto& worker : workers)
+			worker.join();
+
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+}
+
+#endif
@@ -29,6 +29,25 @@ namespace warbler
 	void print_error(const String& msg);
 
 	void print_parse_error(const Token& token, const String& expected, const String& msg = "");
+
+	// While alive, diagnostics printed on the constructing thread are collected instead of
+	// written out, so work done on several threads can be reported in a fixed order.
+	class DiagnosticCapture
+	{
+		String _text;
+		String *_previous;
+
+	public:
+
+		DiagnosticCapture();
+		DiagnosticCapture(const DiagnosticCapture&) = delete;
+		~DiagnosticCapture();
+
+		const String& text() const { return _text; }
+	};
+
+	// writes diagnostics collected by a DiagnosticCapture
+	void print_captured(const String& text);
 }
 
 #endif
@@ -7,6 +7,7 @@
 namespace warbler
 {
 	using String = std::string;
+	using StringView = std::string_view;
 }
 
 #endif
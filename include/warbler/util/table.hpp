@@ -1,13 +1,34 @@
 #ifndef WARBLER_UTIL_TABLE_HPP
 #define WARBLER_UTIL_TABLE_HPP
 
-#include <string>
-#include <unordered_map>
+#include <warbler/util/flat_map.hpp>
+#include <warbler/util/string.hpp>
+#include <warbler/util/primitive.hpp>
+
+#include <functional>
 
 namespace warbler
 {
+	struct StringHash
+	{
+		u64 operator()(StringView text) const { return std::hash<StringView>()(text); }
+	};
+
+	struct AtomHash
+	{
+		// atoms are handed out in order, so they are spread over the whole word before the
+		// low bits pick a group and the high bits the control byte
+		u64 operator()(u32 atom) const { return atom * 0x9e3779b97f4a7c15ull; }
+	};
+
+	// string keyed hash table that can be searched with a StringView or a C string without
+	// allocating a key for every lookup
+	template <typename T>
+	using Table = FlatMap<String, T, StringHash>;
+
+	// table keyed by interned identifier atoms
 	template <typename T>
-	using Table = std::unordered_map<std::string, T>;
+	using AtomTable = FlatMap<u32, T, AtomHash>;
 }
 
 #endif
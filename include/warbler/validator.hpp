@@ -10,9 +10,11 @@ namespace warbler
 	Result<StatementContext> validate_statement(const StatementSyntax& statement, FunctionSymbolTable& symbols);
 	Result<ParameterContext> validate_parameter(const ParameterSyntax& syntax, FunctionSymbolTable& symbols);
 	SymbolData& validate_variable(const VariableSyntax& syntax, FunctionSymbolTable& symbols);
-	bool validate_struct(const StructSyntax& syntax, GlobalSymbolTable& symbols, Array<String>& containing_types);
+	// structs holds the struct validated for each index, which has to include every struct the
+	// validated struct is made of
+	Result<StructContext> validate_struct(const SymbolData& data, GlobalSymbolTable& globals, u32 scope, const Array<const StructContext *>& structs);
 	Result<PackageContext> validate_module(const ModuleSyntax& syntax);
-	Result<ProgramContext> validate(const ProgramSyntax& syntax);
+	Result<ProgramContext> validate(const ProgramSyntax& syntax, usize worker_count = 0);
 }
 
 #endif
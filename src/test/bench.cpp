@@ -0,0 +1,921 @@
+// local headers
+#include <warbler/token.hpp>
+#include <warbler/scanner.hpp>
+#include <warbler/parser.hpp>
+#include <warbler/syntax_cache.hpp>
+#include <warbler/validator.hpp>
+#include <warbler/symbol_table.hpp>
+#include <warbler/preprocessor.hpp>
+
+// standard headers
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+using namespace warbler;
+
+static std::atomic<usize> allocation_count = 0;
+
+// GCC cannot tell that the global operator new is replaced as well and takes every free of its
+// memory that gets inlined for a mismatched deallocation
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(std::size_t size)
+{
+	allocation_count += 1;
+
+	if (auto *ptr = std::malloc(size ? size : 1))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+static const char *keywords[] =
+{
+	"break", "case", "continue", "else", "enum", "export", "false", "for",
+	"function", "if", "import", "loop", "match", "mut", "private", "public",
+	"return", "struct", "then", "true", "type", "union", "var", "while"
+};
+
+template <typename Function>
+static f64 time_best_of(usize runs, Function function)
+{
+	f64 best = 0.0;
+
+	for (usize i = 0; i < runs; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		function();
+
+		auto end = std::chrono::steady_clock::now();
+		auto seconds = std::chrono::duration<f64>(end - start).count();
+
+		if (i == 0 || seconds < best)
+			best = seconds;
+	}
+
+	return best;
+}
+
+static String generate_identifiers(usize count)
+{
+	static const char identifier_chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+	const usize keyword_count = sizeof(keywords) / sizeof(*keywords);
+
+	std::mt19937 rng(12345);
+	String src;
+
+	src.reserve(count * 10);
+
+	for (usize i = 0; i < count; ++i)
+	{
+		if (rng() % 5 == 0)
+		{
+			src += keywords[rng() % keyword_count];
+		}
+		else
+		{
+			usize length = 1 + rng() % 16;
+
+			// first character may not be a digit
+			src += identifier_chars[rng() % 53];
+
+			for (usize j = 1; j < length; ++j)
+				src += identifier_chars[rng() % (sizeof(identifier_chars) - 1)];
+		}
+
+		src += (i % 8 == 7) ? '\n' : ' ';
+	}
+
+	return src;
+}
+
+// real programs reuse a small vocabulary of names, unlike the fully random identifiers
+static String generate_vocabulary_identifiers(usize count, usize vocabulary_size)
+{
+	std::mt19937 rng(54321);
+	Array<String> vocabulary;
+	String src;
+
+	for (usize i = 0; i < vocabulary_size; ++i)
+		vocabulary.push_back("name_" + std::to_string(rng() % 100'000'000));
+
+	src.reserve(count * 14);
+
+	for (usize i = 0; i < count; ++i)
+	{
+		src += vocabulary[rng() % vocabulary_size];
+		src += (i % 8 == 7) ? '\n' : ' ';
+	}
+
+	return src;
+}
+
+static void bench_identifiers(const char *name, const String& src)
+{
+	auto file = File::from("identifiers.wbl", src.c_str());
+	usize token_count = 0;
+
+	auto seconds = time_best_of(5, [&]()
+	{
+		auto tokens = TokenBuffer::lex(file);
+
+		token_count = tokens.size() - 1;
+	});
+
+	printf("%s: %zu tokens in %.3f ms, %.1f M identifiers/sec\n", name, token_count, seconds * 1000.0, token_count / seconds / 1e6);
+}
+
+static String generate_generated_code(usize line_count)
+{
+	String src;
+
+	src.reserve(line_count * 100);
+
+	for (usize i = 0; i < line_count; ++i)
+	{
+		auto index = std::to_string(i);
+
+		src += "                var generated_identifier_with_a_long_name_" + index;
+		src += " = another_generated_identifier_" + index + " + 12345678901234;\n";
+	}
+
+	return src;
+}
+
+static void bench_scan_levels()
+{
+	static const char *level_names[] = { "scalar", "sse2", "avx2" };
+
+	auto file = File::from("generated.wbl", generate_generated_code(200'000).c_str());
+	auto max_level = get_max_scan_level();
+
+	for (int level = 0; level <= static_cast<int>(max_level); ++level)
+	{
+		set_scan_level(static_cast<ScanLevel>(level));
+
+		auto seconds = time_best_of(5, [&]()
+		{
+			TokenBuffer::lex(file);
+		});
+
+		printf("scan level %s: %.3f ms, %.1f MB/sec\n", level_names[level], seconds * 1000.0, file.src().size() / seconds / 1e6);
+	}
+
+	set_scan_level(max_level);
+}
+
+static String generate_commented_code(usize line_count)
+{
+	String src;
+
+	src.reserve(line_count * 80);
+
+	for (usize i = 0; i < line_count; ++i)
+	{
+		auto index = std::to_string(i);
+
+		switch (i % 4)
+		{
+			case 0:
+				src += "/*\n * block comment describing the next few declarations " + index + "\n */\n";
+				break;
+
+			case 1:
+				src += "// line comment explaining the declaration below " + index + "\n";
+				break;
+
+			default:
+				break;
+		}
+
+		src += "var value_" + index + " = other_value_" + index + " + 42; // trailing comment\n";
+	}
+
+	return src;
+}
+
+static void bench_comments()
+{
+	auto src = generate_commented_code(200'000);
+
+	// the old pipeline copied the source and stripped comments in a separate pass before lexing
+	auto two_pass_seconds = time_best_of(5, [&]()
+	{
+		auto text = src;
+
+		preprocess(&text[0]);
+
+		auto file = File::from("commented.wbl", text.c_str());
+
+		TokenBuffer::lex(file);
+	});
+
+	auto fused_seconds = time_best_of(5, [&]()
+	{
+		auto file = File::from("commented.wbl", src.c_str());
+
+		TokenBuffer::lex(file);
+	});
+
+	printf("comments: preprocess then lex %.3f ms, fused lex %.3f ms, %.1f MB/sec\n", two_pass_seconds * 1000.0, fused_seconds * 1000.0, src.size() / fused_seconds / 1e6);
+}
+
+static void bench_parallel_lexing()
+{
+	auto src = generate_commented_code(1'000'000);
+	auto file = File::from("large.wbl", src.c_str());
+
+	auto serial_seconds = time_best_of(5, [&]()
+	{
+		TokenBuffer::lex(file);
+	});
+
+	auto parallel_seconds = time_best_of(5, [&]()
+	{
+		TokenBuffer::lex_parallel(file);
+	});
+
+	printf("parallel lexing: %.1f MB, serial %.3f ms, parallel %.3f ms on %u threads\n", src.size() / 1e6, serial_seconds * 1000.0, parallel_seconds * 1000.0, std::thread::hardware_concurrency());
+}
+
+static String generate_functions(usize count)
+{
+	String src;
+
+	src.reserve(count * 300);
+
+	for (usize i = 0; i < count; ++i)
+	{
+		auto index = std::to_string(i);
+
+		src += "function generated_function_" + index + "(first_parameter_value: u32, second_parameter_value: u64)\n{\n";
+		src += "\tvar first_local_variable: u32 = 1;\n";
+		src += "\tvar second_local_variable: u64 = 2;\n";
+		src += "\tfirst_local_variable = first_parameter_value;\n";
+		src += "\tsecond_local_variable = second_parameter_value;\n";
+		src += "}\n";
+	}
+
+	return src;
+}
+
+static String generate_expressions(usize count)
+{
+	String src;
+
+	src.reserve(count * 400);
+
+	for (usize i = 0; i < count; ++i)
+	{
+		auto index = std::to_string(i);
+
+		src += "function expression_function_" + index + "(first: u32, second: u64)\n{\n";
+		src += "\tvar a: u32 = first * 3 + second / 2 - (first % 5);\n";
+		src += "\tvar b: u64 = a << 2 | second & 255 | first;\n";
+		src += "\tvar c: bool = a < b && b >= first || !(a == second);\n";
+		src += "\ta = -first + -second * (a + b) - " + index + ";\n";
+		src += "\tb = (a + b) * (c - a) >= b;\n";
+		src += "}\n";
+	}
+
+	return src;
+}
+
+static void bench_parse()
+{
+	const usize function_count = 20'000;
+
+	auto directories = Array<Directory>();
+
+	directories.emplace_back(Directory::from("bench", File::from("expressions.wbl", generate_expressions(function_count).c_str())));
+
+	usize allocations = 0;
+
+	auto seconds = time_best_of(5, [&]()
+	{
+		auto start_count = allocation_count.load();
+		auto program = parse(directories);
+
+		allocations = allocation_count.load() - start_count;
+
+		if (!program)
+			printf("parse: failed to parse generated expressions\n");
+	});
+
+	printf("parse: %zu functions in %.3f ms, %.1f allocations/function\n", function_count, seconds * 1000.0, static_cast<f64>(allocations) / function_count);
+}
+
+static void bench_signature_parse()
+{
+	const usize function_count = 20'000;
+
+	auto directories = Array<Directory>();
+
+	directories.emplace_back(Directory::from("bench", File::from("expressions.wbl", generate_expressions(function_count).c_str())));
+
+	auto full_seconds = time_best_of(5, [&]()
+	{
+		parse(directories, 1);
+	});
+
+	auto signature_seconds = time_best_of(5, [&]()
+	{
+		auto program = parse(directories, 1, nullptr, true);
+
+		if (!program || !GlobalSymbolTable::generate(program.unwrap()))
+			printf("signature parse: failed to generate symbols from signatures\n");
+	});
+
+	printf("signature parse: %zu functions, full %.3f ms, signatures and symbol table %.3f ms\n", function_count, full_seconds * 1000.0, signature_seconds * 1000.0);
+}
+
+static void bench_reparse()
+{
+	// every generated function is 7 lines long
+	const usize function_count = 50'000 / 7;
+	const usize edit_count = 64;
+
+	auto src = generate_functions(function_count);
+	auto file = Box<File>(new File(File::from("reparse.wbl", src.c_str())));
+
+	auto full_seconds = time_best_of(5, [&]()
+	{
+		parse_module(*file);
+	});
+
+	auto module = parse_module(*file).unwrap();
+	f64 reparse_seconds = 0.0;
+
+	for (usize i = 0; i < edit_count; ++i)
+	{
+		// changes a single line in a function spread evenly through the file
+		auto function_name = "generated_function_" + std::to_string(i * function_count / edit_count) + "(";
+		auto line = src.find("= 1;", src.find(function_name));
+		auto edit = TextEdit { line, 4, i % 2 == 0 ? "= 12;" : "= 1;" };
+
+		src.replace(edit.pos, edit.length, edit.text);
+
+		auto edited_file = Box<File>(new File(File::from("reparse.wbl", src.c_str())));
+		auto start = std::chrono::steady_clock::now();
+		auto res = reparse_module(std::move(module), *edited_file, edit);
+
+		reparse_seconds += std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+		if (!res)
+		{
+			printf("reparse: failed to reparse edited function\n");
+			return;
+		}
+
+		module = res.unwrap();
+		file = std::move(edited_file);
+	}
+
+	printf("reparse: %zu lines, full parse %.3f ms, single line edit %.3f ms\n", function_count * 7, full_seconds * 1000.0, reparse_seconds / edit_count * 1000.0);
+}
+
+static void bench_parallel_parse()
+{
+	const usize package_count = 4;
+	const usize file_count = 16;
+
+	auto src = generate_expressions(500);
+	auto directories = Array<Directory>();
+
+	for (usize i = 0; i < package_count; ++i)
+	{
+		auto& directory = directories.emplace_back("package" + std::to_string(i));
+
+		for (usize j = 0; j < file_count; ++j)
+			directory.add_file(File::from(("file" + std::to_string(j) + ".wbl").c_str(), src.c_str()));
+	}
+
+	auto serial_seconds = time_best_of(5, [&]()
+	{
+		parse(directories, 1);
+	});
+
+	auto parallel_seconds = time_best_of(5, [&]()
+	{
+		parse(directories);
+	});
+
+	printf("parallel parse: %zu files, serial %.3f ms, parallel %.3f ms on %u threads\n", package_count * file_count, serial_seconds * 1000.0, parallel_seconds * 1000.0, std::thread::hardware_concurrency());
+}
+
+static void bench_syntax_cache()
+{
+	const usize file_count = 64;
+
+	auto cache_directory = std::filesystem::temp_directory_path() / "warbler_syntax_cache_bench";
+	auto src = generate_expressions(500);
+	auto directories = Array<Directory>();
+	auto& directory = directories.emplace_back("bench");
+
+	// each file needs text of its own or they would all share one entry
+	for (usize i = 0; i < file_count; ++i)
+		directory.add_file(File::from(("file" + std::to_string(i) + ".wbl").c_str(), (src + "function file_" + std::to_string(i) + "()\n{\n}\n").c_str()));
+
+	auto uncached_seconds = time_best_of(5, [&]()
+	{
+		parse(directories, 1);
+	});
+
+	f64 cold_seconds = 0.0;
+
+	// every cold run starts with an empty cache, so it pays for storing every module
+	for (usize i = 0; i < 5; ++i)
+	{
+		std::filesystem::remove_all(cache_directory);
+
+		SyntaxCache cache(cache_directory.string());
+		auto seconds = time_best_of(1, [&]()
+		{
+			parse(directories, 1, &cache);
+		});
+
+		if (i == 0 || seconds < cold_seconds)
+			cold_seconds = seconds;
+	}
+
+	SyntaxCache cache(cache_directory.string());
+	auto warm_seconds = time_best_of(5, [&]()
+	{
+		parse(directories, 1, &cache);
+	});
+
+	printf("syntax cache: %zu files, uncached %.3f ms, cold %.3f ms, warm %.3f ms, %zu hits, %zu misses\n", file_count, uncached_seconds * 1000.0, cold_seconds * 1000.0, warm_seconds * 1000.0, cache.hits(), cache.misses());
+
+	std::filesystem::remove_all(cache_directory);
+}
+
+static void bench_directory_read()
+{
+	const usize directory_count = 32;
+	const usize file_count = 32;
+
+	auto root = std::filesystem::temp_directory_path() / "warbler_directory_bench";
+	auto src = generate_expressions(20);
+
+	std::filesystem::remove_all(root);
+
+	for (usize i = 0; i < directory_count; ++i)
+	{
+		auto directory = root / ("package" + std::to_string(i % 4)) / ("module" + std::to_string(i));
+
+		std::filesystem::create_directories(directory);
+
+		for (usize j = 0; j < file_count; ++j)
+			std::ofstream(directory / ("file" + std::to_string(j) + ".wbl")) << src;
+	}
+
+	for (usize worker_count : { usize(1), usize(0) })
+	{
+		DirectoryReadTimes best;
+
+		for (usize i = 0; i < 5; ++i)
+		{
+			DirectoryReadTimes times;
+
+			Directory::read(root.string(), worker_count, &times);
+
+			if (i == 0 || times.discovery_seconds + times.load_seconds < best.discovery_seconds + best.load_seconds)
+				best = times;
+		}
+
+		printf("directory read: %zu files with %s, discovery %.3f ms, load %.3f ms\n", best.file_count, worker_count == 1 ? "1 worker" : "a worker per core", best.discovery_seconds * 1000.0, best.load_seconds * 1000.0);
+	}
+
+	std::filesystem::remove_all(root);
+}
+
+static void bench_validator_allocations()
+{
+	const usize function_count = 2'000;
+
+	auto directories = Array<Directory>();
+
+	directories.emplace_back(Directory::from("bench", File::from("functions.wbl", generate_functions(function_count).c_str())));
+
+	auto program = parse(directories);
+
+	if (!program)
+	{
+		printf("validator allocations: failed to parse generated functions\n");
+		return;
+	}
+
+	auto syntax = program.unwrap();
+	usize allocations = 0;
+
+	auto seconds = time_best_of(5, [&]()
+	{
+		auto start_count = allocation_count.load();
+		auto context = validate(syntax, 1);
+
+		allocations = allocation_count.load() - start_count;
+	});
+
+	printf("validator: %zu functions in %.3f ms, %.1f allocations/function\n", function_count, seconds * 1000.0, static_cast<f64>(allocations) / function_count);
+}
+
+static void bench_package_resolution()
+{
+	const usize depth = 32;
+	const usize functions_per_package = 16;
+	const usize lookup_count = 1'000'000;
+
+	auto directories = Array<Directory>();
+	String package;
+
+	// every package is nested in the one before it
+	for (usize i = 0; i < depth; ++i)
+	{
+		String src;
+
+		for (usize j = 0; j < functions_per_package; ++j)
+			src += "function function_" + std::to_string(i) + "_" + std::to_string(j) + "()\n{\n}\n";
+
+		if (!package.empty())
+			package += "::";
+
+		package += "package" + std::to_string(i);
+		directories.emplace_back(Directory::from(package.c_str(), File::from("package.wbl", src.c_str())));
+	}
+
+	auto program = parse(directories, 1, nullptr, true);
+	auto globals = program
+		? GlobalSymbolTable::generate(program.unwrap())
+		: Result<GlobalSymbolTable>();
+
+	if (!globals)
+	{
+		printf("package resolution: failed to generate symbols for nested packages\n");
+		return;
+	}
+
+	auto table = globals.unwrap();
+
+	for (usize i = 0; i < depth; ++i)
+		table.push_package("package" + std::to_string(i));
+
+	// names declared at every level, a primitive at the root and a name that is never found
+	Array<u32> identifiers;
+
+	for (usize i = 0; i < depth; ++i)
+		identifiers.push_back(Interner::intern("function_" + std::to_string(i) + "_0"));
+
+	identifiers.push_back(Interner::intern("u32"));
+	identifiers.push_back(Interner::intern("undeclared"));
+
+	usize found_count = 0;
+
+	auto seconds = time_best_of(5, [&]()
+	{
+		found_count = 0;
+
+		for (usize i = 0; i < lookup_count; ++i)
+			found_count += table.resolve(identifiers[i % identifiers.size()]) != nullptr;
+	});
+
+	printf("package resolution: depth %zu, %zu lookups in %.3f ms, %.1f ns/lookup, %zu found\n", depth, lookup_count, seconds * 1000.0, seconds * 1e9 / lookup_count, found_count);
+}
+
+// the block tables of a function: a few locals are declared and each is looked up a few times
+template <typename Map>
+static f64 time_block_tables(const Array<u32>& atoms, usize function_count, usize& found_count)
+{
+	const usize locals_per_block = 8;
+
+	return time_best_of(5, [&]()
+	{
+		found_count = 0;
+
+		for (usize i = 0; i < function_count; ++i)
+		{
+			Map block;
+
+			for (usize j = 0; j < locals_per_block; ++j)
+				block.emplace(atoms[(i + j) % atoms.size()], j);
+
+			for (usize j = 0; j < locals_per_block * 4; ++j)
+				found_count += block.find(atoms[(i + j) % atoms.size()]) != block.end();
+		}
+	});
+}
+
+// a package's globals: every name is declared once and then looked up many times, half of the
+// lookups being for names declared in another package
+template <typename Map>
+static f64 time_global_table(const Array<u32>& atoms, usize lookup_count, usize& found_count)
+{
+	Map globals;
+
+	for (usize i = 0; i < atoms.size() / 2; ++i)
+		globals.emplace(atoms[i], i);
+
+	return time_best_of(5, [&]()
+	{
+		found_count = 0;
+
+		for (usize i = 0; i < lookup_count; ++i)
+			found_count += globals.find(atoms[(i * 7919) % atoms.size()]) != globals.end();
+	});
+}
+
+static void bench_tables()
+{
+	const usize atom_count = 100'000;
+	const usize function_count = 200'000;
+	const usize lookup_count = 2'000'000;
+
+	Array<String> names;
+	Array<u32> atoms;
+
+	for (usize i = 0; i < atom_count; ++i)
+	{
+		names.push_back("table_identifier_" + std::to_string(i));
+		atoms.push_back(Interner::intern(names.back()));
+	}
+
+	usize flat_found = 0;
+	usize node_found = 0;
+	auto flat_blocks = time_block_tables<AtomTable<usize>>(atoms, function_count, flat_found);
+	auto node_blocks = time_block_tables<std::unordered_map<u32, usize>>(atoms, function_count, node_found);
+
+	printf("tables: %zu block tables, flat %.3f ms, unordered_map %.3f ms%s\n", function_count, flat_blocks * 1000.0, node_blocks * 1000.0, flat_found == node_found ? "" : " (results differ)");
+
+	auto flat_globals = time_global_table<AtomTable<usize>>(atoms, lookup_count, flat_found);
+	auto node_globals = time_global_table<std::unordered_map<u32, usize>>(atoms, lookup_count, node_found);
+
+	printf("tables: %zu global lookups, flat %.3f ms, unordered_map %.3f ms%s\n", lookup_count, flat_globals * 1000.0, node_globals * 1000.0, flat_found == node_found ? "" : " (results differ)");
+
+	// string keys are looked up by view, which unordered_map can only do by copying the view
+	Table<usize> flat_strings;
+	std::unordered_map<String, usize> node_strings;
+
+	for (usize i = 0; i < atom_count / 2; ++i)
+	{
+		flat_strings.emplace(StringView(names[i]), i);
+		node_strings.emplace(names[i], i);
+	}
+
+	auto flat_views = time_best_of(5, [&]()
+	{
+		flat_found = 0;
+
+		for (usize i = 0; i < lookup_count; ++i)
+			flat_found += flat_strings.find(StringView(names[(i * 7919) % atom_count])) != flat_strings.end();
+	});
+
+	auto node_views = time_best_of(5, [&]()
+	{
+		String key;
+
+		node_found = 0;
+
+		for (usize i = 0; i < lookup_count; ++i)
+		{
+			key.assign(StringView(names[(i * 7919) % atom_count]));
+			node_found += node_strings.find(key) != node_strings.end();
+		}
+	});
+
+	printf("tables: %zu string view lookups, flat %.3f ms, unordered_map %.3f ms%s\n", lookup_count, flat_views * 1000.0, node_views * 1000.0, flat_found == node_found ? "" : " (results differ)");
+}
+
+static void bench_scoped_variables()
+{
+	const usize depth = 64;
+	const usize variables_per_block = 4;
+	const usize function_count = 2'000;
+
+	// the same few names are declared in every block, so each block shadows the one around it
+	String src = "function f()\n{\n";
+
+	for (usize i = 0; i < variables_per_block; ++i)
+		src += "\tvar variable_" + std::to_string(i) + ": u32 = 0;\n";
+
+	src += "}\n";
+
+	auto file = File::from("scopes.wbl", src.c_str());
+	auto module = parse_module(file).unwrap();
+	const auto& declarations = module.pool->nodes<DeclarationSyntax>();
+	auto globals = GlobalSymbolTable::generate(ProgramSyntax(Array<PackageSyntax>())).unwrap();
+	Array<u32> identifiers;
+
+	for (const auto& declaration : declarations)
+		identifiers.push_back(declaration.variable().name().atom());
+
+	identifiers.push_back(Interner::intern("undeclared"));
+
+	usize scoped_found = 0;
+	usize scoped_allocations = 0;
+
+	auto scoped_seconds = time_best_of(5, [&]()
+	{
+		auto start_count = allocation_count.load();
+		auto symbols = FunctionSymbolTable(globals);
+
+		scoped_found = 0;
+
+		for (usize i = 0; i < function_count; ++i)
+		{
+			for (usize j = 0; j < depth; ++j)
+			{
+				symbols.push_block();
+
+				for (const auto& declaration : declarations)
+					symbols.add_variable(declaration.variable());
+
+				for (auto identifier : identifiers)
+					scoped_found += symbols.find_variable(identifier) != nullptr;
+			}
+
+			for (usize j = 0; j < depth; ++j)
+				symbols.pop_block();
+		}
+
+		scoped_allocations = allocation_count.load() - start_count;
+	});
+
+	// a table per block searched from the innermost one outwards, as blocks were kept before
+	usize block_found = 0;
+	usize block_allocations = 0;
+
+	auto block_seconds = time_best_of(5, [&]()
+	{
+		auto start_count = allocation_count.load();
+		Array<AtomTable<SymbolData>> blocks;
+
+		block_found = 0;
+
+		for (usize i = 0; i < function_count; ++i)
+		{
+			for (usize j = 0; j < depth; ++j)
+			{
+				auto& block = blocks.emplace_back();
+
+				for (const auto& declaration : declarations)
+					block.emplace(declaration.variable().name().atom(), declaration.variable());
+
+				for (auto identifier : identifiers)
+				{
+					for (usize k = blocks.size(); k-- > 0;)
+					{
+						if (blocks[k].find(identifier) != blocks[k].end())
+						{
+							block_found += 1;
+							break;
+						}
+					}
+				}
+			}
+
+			blocks.clear();
+		}
+
+		block_allocations = allocation_count.load() - start_count;
+	});
+
+	printf("scoped variables: depth %zu, scoped table %.3f ms with %zu allocations, table per block %.3f ms with %zu allocations%s\n", depth, scoped_seconds * 1000.0, scoped_allocations, block_seconds * 1000.0, block_allocations, scoped_found == block_found ? "" : " (results differ)");
+}
+
+static void bench_parallel_validation()
+{
+	const usize package_count = 4;
+	const usize function_count = 5'000;
+
+	auto directories = Array<Directory>();
+
+	for (usize i = 0; i < package_count; ++i)
+		directories.emplace_back(Directory::from(("package" + std::to_string(i)).c_str(), File::from("functions.wbl", generate_functions(function_count).c_str())));
+
+	auto program = parse(directories);
+
+	if (!program)
+	{
+		printf("parallel validation: failed to parse generated functions\n");
+		return;
+	}
+
+	auto syntax = program.unwrap();
+
+	auto serial_seconds = time_best_of(5, [&]()
+	{
+		validate(syntax, 1);
+	});
+
+	auto parallel_seconds = time_best_of(5, [&]()
+	{
+		validate(syntax);
+	});
+
+	printf("parallel validation: %zu functions, serial %.3f ms, parallel %.3f ms on %u threads\n", package_count * function_count, serial_seconds * 1000.0, parallel_seconds * 1000.0, std::thread::hardware_concurrency());
+}
+
+static void bench_struct_validation()
+{
+	const usize chain_count = 20;
+	const usize chain_length = 1'000;
+	const usize struct_count = chain_count * chain_length;
+
+	// every struct contains a struct one step shorter of a neighbouring chain, declared after
+	// it as in generated schemas, so there are chain_length levels of dependencies while every
+	// struct stays a few KiB in size, and it points to structs of other chains
+	String src;
+
+	for (usize depth = chain_length; depth-- > 0;)
+	{
+		for (usize chain = 0; chain < chain_count; ++chain)
+		{
+			auto name = "type_" + std::to_string(chain) + "_" + std::to_string(depth);
+
+			src += "struct " + name + "\n{\n\tvalue: u32";
+
+			if (depth > 0)
+				src += ",\n\tprevious: type_" + std::to_string((chain + depth) % chain_count) + "_" + std::to_string(depth - 1);
+
+			src += ",\n\tsibling: *type_" + std::to_string((chain + 1) % chain_count) + "_" + std::to_string(depth);
+			src += "\n}\n";
+		}
+	}
+
+	auto directories = Array<Directory>();
+
+	directories.emplace_back(Directory::from("schema", File::from("schema.wbl", src.c_str())));
+
+	auto program = parse(directories);
+
+	if (!program)
+	{
+		printf("struct validation: failed to parse generated structs\n");
+		return;
+	}
+
+	auto syntax = program.unwrap();
+
+	auto serial_seconds = time_best_of(5, [&]()
+	{
+		if (!validate(syntax, 1))
+			printf("struct validation: generated structs are invalid\n");
+	});
+
+	auto parallel_seconds = time_best_of(5, [&]()
+	{
+		validate(syntax);
+	});
+
+	printf("struct validation: %zu structs, serial %.3f ms, parallel %.3f ms on %u threads\n", struct_count, serial_seconds * 1000.0, parallel_seconds * 1000.0, std::thread::hardware_concurrency());
+}
+
+int main()
+{
+	const usize identifier_count = 2'000'000;
+
+	bench_identifiers("random identifiers", generate_identifiers(identifier_count));
+	bench_identifiers("vocabulary identifiers", generate_vocabulary_identifiers(identifier_count, 4'096));
+	bench_scan_levels();
+	bench_comments();
+	bench_parallel_lexing();
+	bench_parse();
+	bench_signature_parse();
+	bench_reparse();
+	bench_parallel_parse();
+	bench_syntax_cache();
+	bench_directory_read();
+	bench_validator_allocations();
+	bench_parallel_validation();
+	bench_struct_validation();
+	bench_package_resolution();
+	bench_tables();
+	bench_scoped_variables();
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+// local headers
+#include <warbler/directory.hpp>
+#include <warbler/util/print.hpp>
+
+// standard headers
+#include <filesystem>
+#include <fstream>
+
+using namespace warbler;
+
+static String create_source_tree(const char *name)
+{
+	auto root = std::filesystem::temp_directory_path() / name;
+
+	std::filesystem::remove_all(root);
+
+	for (usize i = 0; i < 4; ++i)
+	{
+		auto directory = root;
+
+		// every package is nested one level deeper than the previous one
+		for (usize j = 0; j <= i; ++j)
+			directory /= "package" + std::to_string(j);
+
+		std::filesystem::create_directories(directory);
+
+		for (usize j = 0; j < 10; ++j)
+		{
+			std::ofstream(directory / ("file" + std::to_string(j) + ".wbl")) << "function f" << i << "_" << j << "()\n{\n}\n";
+			std::ofstream(directory / ("notes" + std::to_string(j) + ".txt")) << "not a source file\n";
+		}
+	}
+
+	return root.string();
+}
+
+static String get_tree_description(const Array<Directory>& directories)
+{
+	String description;
+
+	for (const auto& directory : directories)
+	{
+		description += directory.path() + "\n";
+
+		for (const auto& file : directory.files())
+			description += "\t" + file.filename() + ": " + String(file.src()) + "\n";
+	}
+
+	return description;
+}
+
+static bool test_concurrent_reading()
+{
+	static const usize worker_counts[] = { 2, 3, 8 };
+
+	auto root = create_source_tree("warbler_directory_test");
+	auto serial = Directory::read(root, 1);
+
+	if (!serial)
+	{
+		print_error("failed to read the source tree serially");
+		return false;
+	}
+
+	auto directories = serial.unwrap();
+	usize file_count = 0;
+
+	for (const auto& directory : directories)
+		file_count += directory.files().size();
+
+	if (directories.size() != 5 || file_count != 40)
+	{
+		print_error("source tree was read as " + std::to_string(directories.size()) + " directories with " + std::to_string(file_count) + " source files");
+		return false;
+	}
+
+	auto expected = get_tree_description(directories);
+
+	for (auto worker_count : worker_counts)
+	{
+		DirectoryReadTimes times;
+		auto res = Directory::read(root, worker_count, &times);
+
+		if (!res || get_tree_description(res.unwrap()) != expected)
+		{
+			print_error("reading with " + std::to_string(worker_count) + " workers differs from reading serially");
+			return false;
+		}
+
+		if (times.file_count != file_count)
+		{
+			print_error("read times count " + std::to_string(times.file_count) + " files instead of " + std::to_string(file_count));
+			return false;
+		}
+	}
+
+	std::filesystem::remove_all(root);
+
+	return true;
+}
+
+int main()
+{
+	bool success = true;
+
+	success = test_concurrent_reading() && success;
+
+	if (!success)
+		return 1;
+
+	print_note("directory tests passed");
+
+	return 0;
+}
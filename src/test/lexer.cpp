@@ -0,0 +1,865 @@
+// local headers
+#include <warbler/token.hpp>
+#include <warbler/scanner.hpp>
+#include <warbler/preprocessor.hpp>
+#include <warbler/util/print.hpp>
+
+// standard headers
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace warbler;
+
+static const ScanLevel scan_levels[] = { ScanLevel::Scalar, ScanLevel::Sse2, ScanLevel::Avx2 };
+
+// scanned before main, so the scanners have to be usable from the initializers of statics
+static const char static_text[] = "identifier  \n";
+static const char *static_identifier_end = skip_identifier(static_text, static_text + sizeof(static_text) - 1);
+static const char *static_whitespace_end = skip_whitespace(static_identifier_end, static_text + sizeof(static_text) - 1);
+
+static bool test_static_scanning()
+{
+	if (static_identifier_end != static_text + 10 || static_whitespace_end != static_text + 13)
+	{
+		print_error("text scanned while initializing statics was not scanned correctly");
+		return false;
+	}
+
+	if (get_scan_level() != get_max_scan_level())
+	{
+		print_error("scanners picked on first use were not the best supported ones");
+		return false;
+	}
+
+	return true;
+}
+
+static String generate_source(std::mt19937& rng, usize fragment_count)
+{
+	static const char *operators[] =
+	{
+		"(", ")", "[", "]", "{", "}", ";", ":", ",", ".", "..", "...", "<", "<<", "<<=", "<=", ">", ">>",
+		">>=", ">=", "%", "%=", "^", "^=", "&", "&&", "&&=", "&=", "*", "*=", "-", "-=", "->", "=", "==",
+		"=>", "|", "||", "||=", "|=", "+", "+=", "?", "!", "!=", "/", "/="
+	};
+	static const char identifier_chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+	static const char whitespace_chars[] = " \t\n\r";
+
+	String src;
+
+	for (usize i = 0; i < fragment_count; ++i)
+	{
+		switch (rng() % 7)
+		{
+			case 0:
+			case 1:
+			{
+				usize length = 1 + rng() % 80;
+
+				src += identifier_chars[rng() % 53];
+
+				for (usize j = 1; j < length; ++j)
+					src += identifier_chars[rng() % (sizeof(identifier_chars) - 1)];
+				break;
+			}
+
+			case 2:
+			{
+				usize length = 1 + rng() % 40;
+
+				for (usize j = 0; j < length; ++j)
+					src += rng() % 10 == 0 ? '.' : static_cast<char>('0' + rng() % 10);
+				break;
+			}
+
+			case 3:
+			{
+				char terminal = rng() % 2 ? '"' : '\'';
+				usize length = rng() % 60;
+
+				src += terminal;
+
+				for (usize j = 0; j < length; ++j)
+				{
+					switch (rng() % 8)
+					{
+						case 0:
+							src += '\\';
+							break;
+
+						case 1:
+							src += '\n';
+							break;
+
+						default:
+							src += identifier_chars[rng() % (sizeof(identifier_chars) - 1)];
+							break;
+					}
+				}
+
+				src += terminal;
+				break;
+			}
+
+			case 4:
+				src += operators[rng() % (sizeof(operators) / sizeof(*operators))];
+				break;
+
+			default:
+			{
+				usize length = 1 + rng() % 70;
+
+				for (usize j = 0; j < length; ++j)
+					src += whitespace_chars[rng() % (sizeof(whitespace_chars) - 1)];
+				break;
+			}
+		}
+
+		src += ' ';
+	}
+
+	return src;
+}
+
+static bool is_same_token_stream(const TokenBuffer& expected, const TokenBuffer& actual)
+{
+	if (expected.size() != actual.size())
+		return false;
+
+	for (usize i = 0; i < expected.size(); ++i)
+	{
+		if (expected.type(i) != actual.type(i) || expected.location(i) != actual.location(i) || expected.length(i) != actual.length(i))
+			return false;
+	}
+
+	return true;
+}
+
+static bool test_simd_token_streams()
+{
+	std::mt19937 rng(42);
+
+	for (usize i = 0; i < 200; ++i)
+	{
+		auto file = File::from("random.wbl", generate_source(rng, 1 + rng() % 400).c_str());
+
+		set_scan_level(ScanLevel::Scalar);
+
+		auto expected = TokenBuffer::lex(file);
+
+		for (auto level : scan_levels)
+		{
+			set_scan_level(level);
+
+			auto actual = TokenBuffer::lex(file);
+
+			if (!is_same_token_stream(expected, actual))
+			{
+				print_error("token stream for scan level " + std::to_string(static_cast<int>(level)) + " differs from the scalar scanner");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static String generate_comments(std::mt19937& rng, usize fragment_count)
+{
+	static const char *fragments[] = { "//", "/*", "*/", "*", "/", "\n", "\"", "'", "\\", "abc", "    ", "x = y;" };
+
+	String src;
+
+	for (usize i = 0; i < fragment_count; ++i)
+		src += fragments[rng() % (sizeof(fragments) / sizeof(*fragments))];
+
+	// the preprocessor may step over the final null character after a trailing line comment
+	src += "\n;\n";
+
+	return src;
+}
+
+static bool test_simd_preprocessor()
+{
+	std::mt19937 rng(1337);
+
+	for (usize i = 0; i < 500; ++i)
+	{
+		auto src = generate_comments(rng, rng() % 300);
+
+		set_scan_level(ScanLevel::Scalar);
+
+		auto expected = src;
+
+		preprocess(&expected[0]);
+
+		for (auto level : scan_levels)
+		{
+			set_scan_level(level);
+
+			auto actual = src;
+
+			preprocess(&actual[0]);
+
+			if (String(expected.c_str()) != String(actual.c_str()))
+			{
+				print_error("preprocessed text for scan level " + std::to_string(static_cast<int>(level)) + " differs from the scalar scanner");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool is_literal(TokenType type)
+{
+	return type == TokenType::CharLiteral || type == TokenType::StringLiteral;
+}
+
+static String insert_comments(std::mt19937& rng, const String& src, const TokenBuffer& tokens)
+{
+	static const char *line_comments[] = { "//", "// comment", "//*/", "///**/", "// x = y; // z" };
+	static const char *block_comments[] =
+	{
+		"/**/", "/* comment */", "/*\n\n*/", "/* // */", "/***/", "/* a\n * b\n */",
+		"/* it's\n a \"quote\n */", "/*\n'\n#\\\n\"\n*/"
+	};
+
+	String out;
+	usize pos = 0;
+
+	for (usize i = 0; i < tokens.size(); ++i)
+	{
+		auto token_pos = tokens.pos(i);
+
+		out.append(src, pos, token_pos - pos);
+		pos = token_pos;
+
+		// comments are only put where there is already whitespace between tokens so they can't join
+		// them, and away from literals as their tokens don't include the closing quote
+		if (i == 0 || static_cast<u8>(src[token_pos - 1]) > ' ' || rng() % 4)
+			continue;
+
+		if (is_literal(tokens.type(i)) || is_literal(tokens.type(i - 1)))
+			continue;
+
+		if (rng() % 2)
+		{
+			out += line_comments[rng() % (sizeof(line_comments) / sizeof(*line_comments))];
+			out += '\n';
+		}
+		else
+		{
+			out += block_comments[rng() % (sizeof(block_comments) / sizeof(*block_comments))];
+			out += ' ';
+		}
+	}
+
+	out.append(src, pos, String::npos);
+
+	return out;
+}
+
+static bool test_comment_skipping()
+{
+	std::mt19937 rng(2024);
+
+	for (usize i = 0; i < 200; ++i)
+	{
+		auto src = generate_source(rng, 1 + rng() % 300);
+		auto file = File::from("plain.wbl", src.c_str());
+		auto expected = TokenBuffer::lex(file);
+		auto commented_src = insert_comments(rng, src, expected);
+		auto commented_file = File::from("commented.wbl", commented_src.c_str());
+		auto actual = TokenBuffer::lex(commented_file);
+
+		if (expected.size() != actual.size())
+		{
+			print_error("source with comments lexed to " + std::to_string(actual.size()) + " tokens instead of " + std::to_string(expected.size()));
+			return false;
+		}
+
+		for (usize j = 0; j < expected.size(); ++j)
+		{
+			auto expected_text = file.get_view(expected.pos(j), expected.length(j));
+			auto actual_text = commented_file.get_view(actual.pos(j), actual.length(j));
+
+			if (expected.type(j) != actual.type(j) || expected_text != actual_text)
+			{
+				print_error(actual.at(j), "token " + std::to_string(j) + " differs from the source without comments");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool is_same_as_serial(const File& file, const TokenBuffer& tokens)
+{
+	auto token = Token::get_initial(file);
+
+	for (usize i = 0; i < tokens.size(); ++i)
+	{
+		if (token.type() != tokens.type(i) || token.location() != tokens.location(i) || token.length() != tokens.length(i))
+			return false;
+
+		if (token.type() == TokenType::Identifier && token.atom() != tokens.atom(i))
+			return false;
+
+		if (token.type() == TokenType::EndOfFile)
+			return i + 1 == tokens.size();
+
+		token.increment();
+	}
+
+	return false;
+}
+
+static bool test_parallel_lexing()
+{
+	std::mt19937 rng(1234);
+
+	for (usize i = 0; i < 200; ++i)
+	{
+		auto plain_file = File::from("plain.wbl", generate_source(rng, 1 + rng() % 800).c_str());
+		auto src = insert_comments(rng, String(plain_file.src()), TokenBuffer::lex(plain_file));
+		auto file = File::from("random.wbl", src.c_str());
+
+		for (usize chunk_count : { 2, 3, 7, 16, 64 })
+		{
+			auto tokens = TokenBuffer::lex_parallel(file, chunk_count);
+
+			if (!is_same_as_serial(file, tokens))
+			{
+				print_error("parallel lexing with " + std::to_string(chunk_count) + " chunks differs from serial lexing");
+				return false;
+			}
+		}
+	}
+
+	// a quote inside of a long comment looks like a literal that is too long to a chunk that
+	// starts in the comment
+	String src = "/*\n";
+
+	for (usize i = 0; i < 1000; ++i)
+		src += "y\n";
+
+	src += "'\n";
+
+	for (usize i = 0; i < 35000; ++i)
+		src += "x\n";
+
+	src += "*/\nend";
+
+	auto file = File::from("comment.wbl", src.c_str());
+	auto tokens = TokenBuffer::lex_parallel(file, 64);
+
+	if (!is_same_as_serial(file, tokens))
+	{
+		print_error("parallel lexing of a quote in a long comment differs from serial lexing");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_line_index()
+{
+	std::mt19937 rng(7);
+
+	for (usize i = 0; i < 100; ++i)
+	{
+		auto src = generate_source(rng, rng() % 200);
+		auto file = File::from("random.wbl", src.c_str());
+		usize line = 0;
+		usize col = 0;
+
+		for (usize pos = 0; pos <= src.size(); ++pos)
+		{
+			if (file.get_line(pos) != line || file.get_col(pos) != col)
+			{
+				print_error("line index gives " + std::to_string(file.get_line(pos)) + ":" + std::to_string(file.get_col(pos))
+					+ " for position " + std::to_string(pos) + ", expected " + std::to_string(line) + ":" + std::to_string(col));
+				return false;
+			}
+
+			if (pos < src.size() && src[pos] == '\n')
+			{
+				line += 1;
+				col = 0;
+			}
+			else
+			{
+				col += 1;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool test_interner()
+{
+	const usize thread_count = 8;
+	const usize identifier_count = 20'000;
+
+	Array<String> identifiers;
+
+	for (usize i = 0; i < identifier_count; ++i)
+		identifiers.push_back("interned_" + std::to_string(i * 7919));
+
+	Array<Array<u32>> atoms(thread_count);
+	Array<std::thread> threads;
+
+	// every thread interns the same identifiers starting from a different point and alternating
+	// direction. half of them go through a cache, which fills up before they are all interned
+	// and has to give the same atoms the second time around.
+	for (usize t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			auto& thread_atoms = atoms[t];
+			auto is_cached = t % 4 >= 2;
+			InternCache cache;
+
+			thread_atoms.resize(identifier_count);
+
+			for (usize pass = 0; pass < (is_cached ? 2 : 1); ++pass)
+			{
+				for (usize i = 0; i < identifier_count; ++i)
+				{
+					auto offset = t % 2 ? identifier_count - 1 - i : i;
+					auto index = (offset + t * identifier_count / thread_count) % identifier_count;
+					auto atom = is_cached
+						? cache.intern(identifiers[index])
+						: Interner::intern(identifiers[index]);
+
+					// a different atom on the second pass is reported as more than one atom below
+					if (pass == 0)
+						thread_atoms[index] = atom;
+					else if (atom != thread_atoms[index])
+						thread_atoms[index] = UINT32_MAX;
+				}
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	for (usize i = 0; i < identifier_count; ++i)
+	{
+		auto atom = atoms[0][i];
+
+		for (usize t = 1; t < thread_count; ++t)
+		{
+			if (atoms[t][i] != atom)
+			{
+				print_error("identifier '" + identifiers[i] + "' was interned as more than one atom");
+				return false;
+			}
+		}
+
+		if (Interner::get(atom) != identifiers[i] || Interner::find(identifiers[i]) != atom)
+		{
+			print_error("atom " + std::to_string(atom) + " does not map back to '" + identifiers[i] + "'");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+struct ExpectedKeyword
+{
+	const char *text;
+	TokenType type;
+};
+
+static const ExpectedKeyword expected_keywords[] =
+{
+	{ "break", TokenType::KeywordBreak },
+	{ "case", TokenType::KeywordCase },
+	{ "continue", TokenType::KeywordContinue },
+	{ "else", TokenType::KeywordElse },
+	{ "enum", TokenType::KeywordEnum },
+	{ "export", TokenType::KeywordExport },
+	{ "false", TokenType::KeywordFalse },
+	{ "for", TokenType::KeywordFor },
+	{ "function", TokenType::KeywordFunction },
+	{ "if", TokenType::KeywordIf },
+	{ "import", TokenType::KeywordImport },
+	{ "loop", TokenType::KeywordLoop },
+	{ "match", TokenType::KeywordMatch },
+	{ "mut", TokenType::KeywordMut },
+	{ "private", TokenType::KeywordPrivate },
+	{ "public", TokenType::KeywordPublic },
+	{ "return", TokenType::KeywordReturn },
+	{ "struct", TokenType::KeywordStruct },
+	{ "then", TokenType::KeywordThen },
+	{ "true", TokenType::KeywordTrue },
+	{ "type", TokenType::KeywordType },
+	{ "union", TokenType::KeywordUnion },
+	{ "var", TokenType::KeywordVar },
+	{ "while", TokenType::KeywordWhile }
+};
+
+static bool is_expected_keyword(const String& text)
+{
+	for (const auto& keyword : expected_keywords)
+	{
+		if (text == keyword.text)
+			return true;
+	}
+
+	return false;
+}
+
+// Words that the keyword lookup has to tell apart from keywords: the words around every
+// keyword that only differ from it where the hash does not look, and words just outside the
+// lengths a keyword can have.
+static Array<String> get_keyword_near_misses()
+{
+	Array<String> words = { "a", "e", "x", "_", "functions", "continues", "functionx", "whilewhile" };
+
+	for (const auto& keyword : expected_keywords)
+	{
+		String text = keyword.text;
+
+		for (usize length = 1; length < text.size(); ++length)
+			words.push_back(text.substr(0, length));
+
+		for (usize start = 1; start < text.size(); ++start)
+			words.push_back(text.substr(start));
+
+		words.push_back(text + "s");
+		words.push_back(text + "_");
+		words.push_back(text + "1");
+		words.push_back("_" + text);
+		words.push_back(text.substr(0, 1) + text);
+
+		// the same length and first, second and last characters as the keyword
+		for (usize i = 2; i + 1 < text.size(); ++i)
+		{
+			auto changed = text;
+
+			changed[i] = changed[i] == 'z' ? 'y' : 'z';
+			words.push_back(changed);
+		}
+
+		auto capitalized = text;
+
+		capitalized[0] = static_cast<char>(capitalized[0] - 'a' + 'A');
+		words.push_back(capitalized);
+	}
+
+	Array<String> near_misses;
+
+	for (auto& word : words)
+	{
+		if (!is_expected_keyword(word))
+			near_misses.push_back(std::move(word));
+	}
+
+	return near_misses;
+}
+
+static bool test_keywords()
+{
+	auto near_misses = get_keyword_near_misses();
+	String src;
+
+	for (const auto& keyword : expected_keywords)
+		src += String(keyword.text) + " ";
+
+	for (const auto& word : near_misses)
+		src += word + " ";
+
+	auto file = File::from("keywords.wbl", src.c_str());
+	auto tokens = TokenBuffer::lex(file);
+	auto keyword_count = std::size(expected_keywords);
+
+	if (tokens.size() != keyword_count + near_misses.size() + 1)
+	{
+		print_error("keywords and words like them were lexed as " + std::to_string(tokens.size()) + " tokens");
+		return false;
+	}
+
+	for (usize i = 0; i < keyword_count; ++i)
+	{
+		if (tokens.type(i) != expected_keywords[i].type)
+		{
+			print_error("keyword '" + String(expected_keywords[i].text) + "' was lexed as token type " + std::to_string(static_cast<int>(tokens.type(i))));
+			return false;
+		}
+	}
+
+	for (usize i = 0; i < near_misses.size(); ++i)
+	{
+		auto index = keyword_count + i;
+
+		if (tokens.type(index) != TokenType::Identifier || Interner::get(tokens.atom(index)) != near_misses[i])
+		{
+			print_error("'" + near_misses[i] + "' was not lexed as an identifier");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test_token_round_trip()
+{
+	static const u32 locations[] = { 0, 1, 0x12345678, UINT32_MAX };
+	static const usize lengths[] = { 0, 1, 255, 256, UINT16_MAX };
+
+	// every field has to survive being packed into 12 bytes, including the extremes
+	for (auto location : locations)
+	{
+		for (auto length : lengths)
+		{
+			for (auto type = 0; type <= static_cast<int>(TokenType::KeywordWhile); ++type)
+			{
+				auto token_type = static_cast<TokenType>(type);
+				auto token = Token(location, length, token_type, token_type == TokenType::Identifier ? UINT32_MAX : 0);
+
+				if (token.location() != location || token.length() != length || token.type() != token_type
+					|| (token_type == TokenType::Identifier && token.atom() != UINT32_MAX))
+				{
+					print_error("token with location " + std::to_string(location) + " and length " + std::to_string(length) + " did not round-trip");
+					return false;
+				}
+			}
+		}
+	}
+
+	// the longest token that can be stored, followed by one of every other kind
+	auto identifier = String(UINT16_MAX, 'x');
+	auto src = "a " + identifier + " 12.5 struct <<= b";
+	auto file = File::from("round_trip.wbl", src.c_str());
+	auto tokens = TokenBuffer::lex(file);
+
+	if (tokens.size() != 7 || tokens.length(1) != UINT16_MAX || Interner::get(tokens.atom(1)) != identifier)
+	{
+		print_error("longest possible identifier was not lexed as a single token");
+		return false;
+	}
+
+	for (usize i = 0; i < tokens.size(); ++i)
+	{
+		auto token = tokens.at(i);
+
+		if (token.location() != tokens.location(i) || token.length() != tokens.length(i) || token.type() != tokens.type(i)
+			|| token.pos() != tokens.pos(i) || &token.file() != &file)
+		{
+			print_error("token " + std::to_string(i) + " read from the buffer differs from the buffer");
+			return false;
+		}
+
+		if (token.type() == TokenType::Identifier && (token.atom() != tokens.atom(i) || Interner::get(token.atom()) != token.view()))
+		{
+			print_error("identifier " + std::to_string(i) + " lost its atom");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test_token_length_overflow()
+{
+#ifdef _WIN32
+	return true;
+#else
+	// a token that does not fit in 16 bits is a fatal error, so it is lexed in a child process
+	int pipe_fds[2];
+
+	if (pipe(pipe_fds))
+	{
+		print_error("failed to create pipe for the child process");
+		return false;
+	}
+
+	std::cout.flush();
+
+	auto pid = fork();
+
+	if (pid == 0)
+	{
+		dup2(pipe_fds[1], STDOUT_FILENO);
+		close(pipe_fds[0]);
+		std::cout << std::unitbuf;
+
+		auto src = "a " + String(static_cast<usize>(UINT16_MAX) + 1, 'x') + " b";
+		auto file = File::from("overflow.wbl", src.c_str());
+
+		TokenBuffer::lex(file);
+		_exit(0);
+	}
+
+	close(pipe_fds[1]);
+
+	String output;
+	char buffer[256];
+	ssize_t count;
+
+	while ((count = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+		output.append(buffer, static_cast<usize>(count));
+
+	close(pipe_fds[0]);
+
+	int status = 0;
+
+	waitpid(pid, &status, 0);
+
+	if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGABRT || output.find("Tokens may not be longer than 65535 characters.") == String::npos)
+	{
+		print_error("token longer than 65535 characters was not reported:\n" + output);
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+static usize get_page_size()
+{
+#ifdef _WIN32
+	return 4096;
+#else
+	return static_cast<usize>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static bool test_mapped_file(usize size)
+{
+	auto path = (std::filesystem::temp_directory_path() / ("warbler_mapped_" + std::to_string(size) + ".wbl")).string();
+	String text;
+
+	// words separated by spaces with a word running up to the end of the file, so the
+	// identifier scanner is the one to find the end
+	for (usize i = 0; i < size; ++i)
+		text += i % 6 == 5 && i + 1 < size ? ' ' : static_cast<char>('a' + i % 5);
+
+	if (!write_file(path, text))
+		return false;
+
+	auto res = File::read(path);
+
+	std::filesystem::remove(path);
+
+	if (!res)
+	{
+		print_error("failed to read file of " + std::to_string(size) + " bytes");
+		return false;
+	}
+
+	auto file = res.unwrap();
+
+	if (file.src() != text || file[size] != '\0')
+	{
+		print_error("text of file of " + std::to_string(size) + " bytes is not followed by a null character");
+		return false;
+	}
+
+	auto buffered = File::from("buffered.wbl", text.c_str());
+	auto expected = TokenBuffer::lex(buffered);
+
+	for (auto level : scan_levels)
+	{
+		set_scan_level(level);
+
+		auto tokens = TokenBuffer::lex(file);
+		auto last = tokens.size() - 1;
+
+		if (tokens.size() != expected.size() || tokens.type(last) != TokenType::EndOfFile || tokens.pos(last) != size
+			|| tokens.pos(last - 1) + tokens.length(last - 1) != size)
+		{
+			print_error("lexing file of " + std::to_string(size) + " bytes did not stop at the end of the file");
+			return false;
+		}
+
+		for (usize i = 0; i < tokens.size(); ++i)
+		{
+			if (tokens.type(i) != expected.type(i) || tokens.pos(i) != expected.pos(i) || tokens.length(i) != expected.length(i))
+			{
+				print_error("tokens of mapped file of " + std::to_string(size) + " bytes differ from those of the same text in memory");
+				return false;
+			}
+		}
+	}
+
+	set_scan_level(get_max_scan_level());
+
+	return true;
+}
+
+static bool test_mapped_files()
+{
+	auto page_size = get_page_size();
+
+	// a file ending on a page boundary is followed by the zeroed page reserved after it
+	if (!test_mapped_file(page_size) || !test_mapped_file(page_size - 1) || !test_mapped_file(2 * page_size))
+		return false;
+
+	auto path = (std::filesystem::temp_directory_path() / "warbler_mapped_empty.wbl").string();
+
+	if (!write_file(path, ""))
+		return false;
+
+	String diagnostics;
+	bool is_read;
+
+	{
+		DiagnosticCapture capture;
+
+		is_read = File::read(path).is_ok();
+		diagnostics = capture.text();
+	}
+
+	std::filesystem::remove(path);
+
+	if (is_read || diagnostics.find("was empty") == String::npos)
+	{
+		print_error("reading an empty file did not fail");
+		return false;
+	}
+
+	return true;
+}
+
+int main()
+{
+	bool success = true;
+
+	success = test_static_scanning() && success;
+	success = test_simd_token_streams() && success;
+	success = test_simd_preprocessor() && success;
+	success = test_comment_skipping() && success;
+	success = test_parallel_lexing() && success;
+	success = test_line_index() && success;
+	success = test_interner() && success;
+	success = test_keywords() && success;
+	success = test_token_round_trip() && success;
+	success = test_token_length_overflow() && success;
+	success = test_mapped_files() && success;
+
+	set_scan_level(get_max_scan_level());
+
+	if (!success)
+		return 1;
+
+	print_note("lexer tests passed");
+
+	return 0;
+}
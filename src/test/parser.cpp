@@ -0,0 +1,1225 @@
+// local headers
+#include <warbler/parser.hpp>
+#include <warbler/syntax_cache.hpp>
+#include <warbler/symbol_table.hpp>
+#include <warbler/util/print.hpp>
+
+// standard headers
+#include <atomic>
+#include <cassert>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <thread>
+
+using namespace warbler;
+
+// Expressions are generated together with the tree the grammar gives them, written as an
+// s-expression. Levels run from loosest to tightest binding, so an operand of a level can be
+// any expression from a tighter level or anything in parentheses.
+enum GrammarLevel
+{
+	AssignmentLevel,
+	ConditionalLevel,
+	BooleanOrLevel,
+	BooleanAndLevel,
+	BitwiseOrLevel,
+	BitwiseAndLevel,
+	EqualityLevel,
+	RelationalLevel,
+	BitShiftLevel,
+	AdditiveLevel,
+	MultiplicativeLevel,
+	PrefixLevel,
+	PostfixLevel,
+	PrimaryLevel
+};
+
+struct GrammarOperator
+{
+	const char *text;
+	int type;
+};
+
+struct BinaryGrammar
+{
+	const char *name;
+	// boolean and bitwise levels only have one operator, so their operands carry no type
+	bool is_typed;
+	Array<GrammarOperator> operators;
+};
+
+struct GeneratedExpression
+{
+	String src;
+	String tree;
+};
+
+static const BinaryGrammar& get_binary_grammar(int level)
+{
+	static const BinaryGrammar grammars[] =
+	{
+		{ "or", false, { { "||", 0 } } },
+		{ "and", false, { { "&&", 0 } } },
+		{ "bitor", false, { { "|", 0 } } },
+		{ "bitand", false, { { "&", 0 } } },
+		{ "eq", true, { { "==", 0 }, { "!=", 1 } } },
+		{ "rel", true, { { ">", 0 }, { "<", 1 }, { ">=", 2 }, { "<=", 3 } } },
+		{ "shift", true, { { "<<", 0 }, { ">>", 1 } } },
+		{ "add", true, { { "+", 0 } } },
+		{ "mul", true, { { "*", 0 }, { "/", 1 }, { "%", 2 } } }
+	};
+
+	return grammars[level - BooleanOrLevel];
+}
+
+static GeneratedExpression generate_expression(std::mt19937& rng, int min_level, usize depth);
+
+static GeneratedExpression generate_primary(std::mt19937& rng, usize depth)
+{
+	static const char *const names[] = { "a", "b", "count", "value", "x1" };
+	static const char *const numbers[] = { "0", "1", "42", "7" };
+
+	switch (depth > 0 ? rng() % 3 : rng() % 2)
+	{
+		case 0:
+		{
+			String name = names[rng() % std::size(names)];
+
+			return { name, name };
+		}
+
+		case 1:
+		{
+			String number = numbers[rng() % std::size(numbers)];
+
+			return { number, number };
+		}
+
+		default:
+		{
+			// parentheses only group, they do not add a node
+			auto inner = generate_expression(rng, AssignmentLevel, depth - 1);
+
+			return { "( " + inner.src + " )", inner.tree };
+		}
+	}
+}
+
+static GeneratedExpression generate_expression(std::mt19937& rng, int min_level, usize depth)
+{
+	if (depth == 0)
+		return generate_primary(rng, depth);
+
+	auto level = min_level + static_cast<int>(rng() % (PrimaryLevel - min_level + 1));
+
+	switch (level)
+	{
+		case AssignmentLevel:
+		{
+			static const char *const operators[] = { "=", "*=", "/=", "%=", "+=", "-=", "<<=", ">>=", "&=", "|=", "^=" };
+
+			auto type = rng() % std::size(operators);
+			auto lhs = generate_expression(rng, ConditionalLevel, depth - 1);
+			auto rhs = generate_expression(rng, ConditionalLevel, depth - 1);
+
+			return { lhs.src + " " + operators[type] + " " + rhs.src, "(assign" + std::to_string(type) + " " + lhs.tree + " " + rhs.tree + ")" };
+		}
+
+		case ConditionalLevel:
+		{
+			auto lhs = generate_expression(rng, BooleanOrLevel, depth - 1);
+			auto true_case = generate_expression(rng, BooleanOrLevel, depth - 1);
+			auto false_case = generate_expression(rng, BooleanOrLevel, depth - 1);
+
+			return { lhs.src + " then " + true_case.src + " else " + false_case.src, "(cond " + lhs.tree + " " + true_case.tree + " " + false_case.tree + ")" };
+		}
+
+		case PrefixLevel:
+		{
+			static const GrammarOperator operators[] = { { "&", 0 }, { "*", 1 }, { "+", 2 }, { "-", 3 }, { "!", 5 } };
+
+			const auto& op = operators[rng() % std::size(operators)];
+			auto operand = generate_expression(rng, PrefixLevel, depth - 1);
+
+			return { String(op.text) + " " + operand.src, "(prefix" + std::to_string(op.type) + " " + operand.tree + ")" };
+		}
+
+		case PostfixLevel:
+		{
+			auto expression = generate_primary(rng, depth - 1);
+			auto count = 1 + rng() % 2;
+
+			for (usize i = 0; i < count; ++i)
+			{
+				if (rng() % 2)
+				{
+					auto index = generate_expression(rng, AssignmentLevel, depth - 1);
+
+					expression.src += " [ " + index.src + " ]";
+					expression.tree = "(index " + expression.tree + " " + index.tree + ")";
+				}
+				else
+				{
+					expression.src += " . member";
+					expression.tree = "(member " + expression.tree + " member)";
+				}
+			}
+
+			return expression;
+		}
+
+		case PrimaryLevel:
+			return generate_primary(rng, depth);
+
+		default:
+		{
+			const auto& grammar = get_binary_grammar(level);
+			auto lhs = generate_expression(rng, level + 1, depth - 1);
+			auto count = 1 + rng() % 3;
+
+			auto src = lhs.src;
+			auto tree = "(" + String(grammar.name) + " " + lhs.tree;
+
+			for (usize i = 0; i < count; ++i)
+			{
+				const auto& op = grammar.operators[rng() % grammar.operators.size()];
+				auto rhs = generate_expression(rng, level + 1, depth - 1);
+
+				src += " " + String(op.text) + " " + rhs.src;
+				tree += grammar.is_typed
+					? " " + std::to_string(op.type) + " " + rhs.tree
+					: " " + rhs.tree;
+			}
+
+			return { src, tree + ")" };
+		}
+	}
+}
+
+static String get_tree(const ExpressionSyntax& expression);
+
+template <typename Node>
+static String get_list_tree(const char *name, const Node& node)
+{
+	auto tree = "(" + String(name) + " " + get_tree(node.lhs());
+
+	for (const auto& rhs : node.rhs())
+		tree += " " + get_tree(rhs);
+
+	return tree + ")";
+}
+
+template <typename Node>
+static String get_typed_list_tree(const char *name, const Node& node)
+{
+	auto tree = "(" + String(name) + " " + get_tree(node.lhs());
+
+	for (const auto& rhs : node.rhs())
+		tree += " " + std::to_string(static_cast<int>(rhs.type)) + " " + get_tree(rhs.expr);
+
+	return tree + ")";
+}
+
+static String get_tree(const ExpressionSyntax& expression)
+{
+	switch (expression.type())
+	{
+		case ExpressionType::Assignment:
+		{
+			const auto& assignment = expression.assignment();
+
+			return "(assign" + std::to_string(static_cast<int>(assignment.type())) + " " + get_tree(assignment.lhs()) + " " + get_tree(assignment.rhs()) + ")";
+		}
+
+		case ExpressionType::Conditional:
+		{
+			const auto& conditional = expression.conditional();
+
+			return "(cond " + get_tree(conditional.lhs()) + " " + get_tree(conditional.true_case()) + " " + get_tree(conditional.false_case()) + ")";
+		}
+
+		case ExpressionType::BooleanOr:
+			return get_list_tree("or", expression.boolean_or());
+
+		case ExpressionType::BooleanAnd:
+			return get_list_tree("and", expression.boolean_and());
+
+		case ExpressionType::BitwiseOr:
+			return get_list_tree("bitor", expression.bitwise_or());
+
+		case ExpressionType::BitwiseXor:
+			return get_list_tree("bitxor", expression.bitwise_xor());
+
+		case ExpressionType::BitwiseAnd:
+			return get_list_tree("bitand", expression.bitwise_and());
+
+		case ExpressionType::Equality:
+			return get_typed_list_tree("eq", expression.equality());
+
+		case ExpressionType::Relational:
+			return get_typed_list_tree("rel", expression.relational());
+
+		case ExpressionType::Shift:
+			return get_typed_list_tree("shift", expression.bit_shift());
+
+		case ExpressionType::Additive:
+			return get_typed_list_tree("add", expression.additive());
+
+		case ExpressionType::Multiplicative:
+			return get_typed_list_tree("mul", expression.multiplicative());
+
+		case ExpressionType::Prefix:
+		{
+			const auto& prefix = expression.prefix();
+
+			return "(prefix" + std::to_string(static_cast<int>(prefix.type())) + " " + get_tree(prefix.expression()) + ")";
+		}
+
+		case ExpressionType::Postfix:
+		{
+			const auto& postfix = expression.postfix();
+
+			switch (postfix.type())
+			{
+				case PostfixType::Index:
+					return "(index " + get_tree(postfix.expression()) + " " + get_tree(postfix.index()) + ")";
+
+				case PostfixType::Member:
+					return "(member " + get_tree(postfix.expression()) + " " + postfix.member().text() + ")";
+
+				default:
+				{
+					auto tree = "(call " + get_tree(postfix.expression());
+
+					for (const auto& argument : postfix.arguments())
+						tree += " " + get_tree(argument);
+
+					return tree + ")";
+				}
+			}
+		}
+
+		case ExpressionType::Constant:
+			return expression.constant().token().text();
+
+		case ExpressionType::Symbol:
+			return expression.symbol().token().text();
+
+		default:
+			return "(unknown)";
+	}
+}
+
+static bool test_expression_trees()
+{
+	const usize expression_count = 2000;
+
+	std::mt19937 rng(4321);
+	SyntaxPool pool;
+	SyntaxPoolScope scope(pool);
+
+	for (usize i = 0; i < expression_count; ++i)
+	{
+		auto expected = generate_expression(rng, AssignmentLevel, 1 + i % 6);
+		auto file = File::from("expression.wbl", (expected.src + "\n").c_str());
+		auto tokens = TokenBuffer::lex(file);
+		auto token = TokenIterator(tokens);
+		auto res = parse_expression(token);
+
+		if (!res)
+		{
+			print_error("failed to parse '" + expected.src + "'");
+			return false;
+		}
+
+		if (token.type() != TokenType::EndOfFile)
+		{
+			print_error(*token, "expression '" + expected.src + "' was not parsed to the end");
+			return false;
+		}
+
+		auto actual = get_tree(res.unwrap());
+
+		if (actual != expected.tree)
+		{
+			print_error("'" + expected.src + "' was parsed as " + actual + " instead of " + expected.tree);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test_pool_registry()
+{
+	const usize pool_count = 1000;
+	const usize thread_count = 4;
+
+	Array<std::unique_ptr<SyntaxPool>> pools;
+
+	for (usize i = 0; i < pool_count; ++i)
+		pools.emplace_back(std::make_unique<SyntaxPool>());
+
+	for (const auto& pool : pools)
+	{
+		if (&SyntaxPool::get(pool->id()) != pool.get())
+		{
+			print_error("syntax pool " + std::to_string(static_cast<usize>(pool->id())) + " was not found by its id");
+			return false;
+		}
+	}
+
+	std::atomic<bool> is_done = false;
+	std::atomic<bool> success = true;
+	Array<std::thread> threads;
+
+	// pools are looked up on several threads while another registers and unregisters pools
+	for (usize t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (usize i = t; !is_done; ++i)
+			{
+				const auto& pool = pools[i % pool_count];
+
+				if (&SyntaxPool::get(pool->id()) != pool.get())
+					success = false;
+			}
+		});
+	}
+
+	for (usize i = 0; i < 2'000; ++i)
+	{
+		Array<std::unique_ptr<SyntaxPool>> temporary;
+
+		for (usize j = 0; j < i % 300; ++j)
+			temporary.emplace_back(std::make_unique<SyntaxPool>());
+	}
+
+	is_done = true;
+
+	for (auto& thread : threads)
+		thread.join();
+
+	if (!success)
+	{
+		print_error("syntax pools were not found while other pools were registered");
+		return false;
+	}
+
+	return true;
+}
+
+static Array<Directory> generate_packages(usize package_count, usize file_count, usize invalid_file_step, usize edited_file_number = 0)
+{
+	Array<Directory> directories;
+	usize file_number = 0;
+
+	for (usize i = 0; i < package_count; ++i)
+	{
+		auto& directory = directories.emplace_back("package" + std::to_string(i));
+
+		for (usize j = 0; j < file_count; ++j)
+		{
+			auto name = std::to_string(i) + "_" + std::to_string(j);
+			String src;
+
+			src += "struct type_" + name + "\n{\n\tvalue: u32\n}\n";
+
+			for (usize k = 0; k < 3; ++k)
+				src += "function function_" + name + "_" + std::to_string(k) + "(a: u32)\n{\n\ta = a + " + std::to_string(k) + ";\n}\n";
+
+			file_number += 1;
+
+			if (invalid_file_step > 0 && file_number % invalid_file_step == 0)
+				src += "function broken_" + name + "(a: u32\n{\n}\n";
+
+			if (file_number == edited_file_number)
+				src += "function edited_" + name + "(b: u32)\n{\n\tb = b * 2;\n}\n";
+
+			directory.add_file(File::from((name + ".wbl").c_str(), src.c_str()));
+		}
+	}
+
+	return directories;
+}
+
+static String get_declaration_names(const ProgramSyntax& program)
+{
+	String names;
+
+	for (const auto& package : program.packages())
+	{
+		names += package.name() + ":";
+
+		for (const auto& type : package.structs())
+			names += " " + type.name().text();
+
+		for (const auto& function : package.functions())
+			names += " " + function.name().text();
+
+		names += "\n";
+	}
+
+	return names;
+}
+
+static bool test_parallel_parsing()
+{
+	static const usize worker_counts[] = { 2, 3, 8 };
+
+	auto directories = generate_packages(4, 9, 0);
+	auto serial = parse(directories, 1);
+
+	if (!serial)
+	{
+		print_error("failed to parse generated packages");
+		return false;
+	}
+
+	auto expected = get_declaration_names(serial.unwrap());
+
+	for (auto worker_count : worker_counts)
+	{
+		auto program = parse(directories, worker_count);
+
+		if (!program || get_declaration_names(program.unwrap()) != expected)
+		{
+			print_error("parsing with " + std::to_string(worker_count) + " workers differs from parsing serially");
+			return false;
+		}
+	}
+
+	auto invalid_directories = generate_packages(4, 9, 7);
+	String expected_diagnostics;
+
+	bool is_parsed;
+
+	{
+		DiagnosticCapture capture;
+
+		is_parsed = parse(invalid_directories, 1).is_ok();
+		expected_diagnostics = capture.text();
+	}
+
+	if (is_parsed || expected_diagnostics.empty())
+	{
+		print_error("generated packages with syntax errors were parsed without errors");
+		return false;
+	}
+
+	// parsing stops at the first file with an error, the 7th one
+	if (expected_diagnostics.find("0_6.wbl") == String::npos || expected_diagnostics.find("1_4.wbl") != String::npos)
+	{
+		print_error("diagnostics are not limited to the first file with an error:\n" + expected_diagnostics);
+		return false;
+	}
+
+	for (auto worker_count : worker_counts)
+	{
+		String diagnostics;
+
+		{
+			DiagnosticCapture capture;
+
+			is_parsed = parse(invalid_directories, worker_count).is_ok();
+			diagnostics = capture.text();
+		}
+
+		if (is_parsed || diagnostics != expected_diagnostics)
+		{
+			print_error("diagnostics with " + std::to_string(worker_count) + " workers differ from parsing serially:\n" + diagnostics);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static String get_token_tree(const Token& token)
+{
+	return token.text() + "@" + std::to_string(token.pos());
+}
+
+static String get_type_tree(const TypeAnnotationSyntax& type)
+{
+	auto tree = get_token_tree(type.name());
+
+	for (const auto& ptr : type.ptrs())
+		tree += ptr.is_mutable ? "*mut" : "*";
+
+	return tree;
+}
+
+static String get_block_tree(const BlockStatementSyntax& block)
+{
+	String tree = "{";
+
+	for (const auto& statement : block.statements())
+	{
+		switch (statement.type())
+		{
+			case StatementType::Expression:
+				tree += " " + get_tree(statement.expression().expression()) + ";";
+				break;
+
+			case StatementType::Declaration:
+				tree += " let " + get_token_tree(statement.declaration().variable().name()) + " = " + get_tree(statement.declaration().value()) + ";";
+				break;
+
+			case StatementType::Block:
+				tree += " " + get_block_tree(statement.block());
+				break;
+
+			default:
+				tree += " (unknown);";
+				break;
+		}
+	}
+
+	return tree + " }";
+}
+
+// declarations with the text and position of every token, which relocated syntax has to
+// reproduce exactly
+static String get_declarations_tree(const Array<StructSyntax>& structs, const Array<FunctionSyntax>& functions)
+{
+	String tree;
+
+	for (const auto& type : structs)
+	{
+		tree += "\tstruct " + get_token_tree(type.name()) + " {";
+
+		for (const auto& member : type.members())
+			tree += " " + get_token_tree(member.name()) + ": " + get_type_tree(member.type()) + ";";
+
+		tree += " }\n";
+	}
+
+	for (const auto& function : functions)
+	{
+		const auto& signature = function.signature();
+
+		tree += "\tfunction " + get_token_tree(function.name()) + "(";
+
+		for (const auto& parameter : signature.parameters())
+			tree += " " + get_token_tree(parameter.name()) + ": " + get_type_tree(parameter.type());
+
+		tree += " )";
+
+		if (signature.return_type())
+			tree += ": " + get_type_tree(*signature.return_type());
+
+		// the offset from the name checks that skipped bodies are moved along with their function
+		tree += function.is_body_parsed()
+			? " " + get_block_tree(function.body()) + "\n"
+			: " { skipped " + std::to_string(function.body_range().location - function.name().location()) + "+" + std::to_string(function.body_range().length) + " }\n";
+	}
+
+	return tree;
+}
+
+static String get_program_tree(const ProgramSyntax& program)
+{
+	String tree;
+
+	for (const auto& package : program.packages())
+		tree += package.name() + "\n" + get_declarations_tree(package.structs(), package.functions());
+
+	return tree;
+}
+
+static bool test_syntax_cache()
+{
+	const usize package_count = 2;
+	const usize file_count = 5;
+
+	auto cache_directory = (std::filesystem::temp_directory_path() / "warbler_syntax_cache_test").string();
+
+	std::filesystem::remove_all(cache_directory);
+
+	auto directories = generate_packages(package_count, file_count, 0);
+	auto uncached = parse(directories, 1);
+
+	if (!uncached)
+	{
+		print_error("failed to parse generated packages");
+		return false;
+	}
+
+	auto expected = get_program_tree(uncached.unwrap());
+	SyntaxCache cache(cache_directory);
+
+	// the second run reads new copies of the files, so loaded syntax has to be moved to
+	// where they are now
+	for (usize run = 0; run < 2; ++run)
+	{
+		auto run_directories = generate_packages(package_count, file_count, 0);
+		auto program = parse(run_directories, 2, &cache);
+
+		if (!program || get_program_tree(program.unwrap()) != expected)
+		{
+			print_error("syntax parsed with the cache on run " + std::to_string(run + 1) + " differs from parsing without it");
+			return false;
+		}
+
+		auto expected_hits = run * package_count * file_count;
+
+		if (cache.hits() != expected_hits || cache.misses() != package_count * file_count)
+		{
+			print_error("run " + std::to_string(run + 1) + " of the syntax cache had " + std::to_string(cache.hits()) + " hits and " + std::to_string(cache.misses()) + " misses");
+			return false;
+		}
+	}
+
+	// only the edited file has to be parsed again
+	auto edited_directories = generate_packages(package_count, file_count, 0, 3);
+	auto edited_expected = get_program_tree(parse(edited_directories, 1).unwrap());
+	auto edited = parse(edited_directories, 2, &cache);
+
+	if (!edited || get_program_tree(edited.unwrap()) != edited_expected)
+	{
+		print_error("syntax parsed with the cache after editing a file differs from parsing without it");
+		return false;
+	}
+
+	if (cache.hits() != 2 * package_count * file_count - 1 || cache.misses() != package_count * file_count + 1)
+	{
+		print_error("editing a file gave " + std::to_string(cache.hits()) + " hits and " + std::to_string(cache.misses()) + " misses");
+		return false;
+	}
+
+	std::filesystem::remove_all(cache_directory);
+
+	return true;
+}
+
+static bool test_damaged_cache_entries()
+{
+	auto cache_directory = (std::filesystem::temp_directory_path() / "warbler_damaged_cache_test").string();
+
+	std::filesystem::remove_all(cache_directory);
+
+	auto file = File::from("damaged.wbl", "struct point\n{\n\tx: u32\n}\n"
+		"function scale(p: u32, factor: u32)\n{\n\tvar x = p * factor + (factor << 2);\n\tx = -x != 3 && x < 7 || f(x, p)[1].y;\n\tx %= 12.5;\n}\n");
+	SyntaxCache cache(cache_directory);
+	auto res = cache.parse_module(file);
+
+	if (!res)
+	{
+		print_error("failed to parse module to cache");
+		return false;
+	}
+
+	auto module = res.unwrap();
+	auto expected = get_declarations_tree(module.structs, module.functions);
+	auto iter = std::filesystem::directory_iterator(cache_directory);
+	auto path = iter->path().string();
+	auto entry = read_file(path).unwrap();
+
+	// every damaged copy of the entry has to be parsed again instead of being loaded
+	for (usize i = 0; i <= entry.size(); ++i)
+	{
+		auto damaged = i < entry.size()
+			? entry
+			: entry.substr(0, entry.size() / 2);
+
+		if (i < entry.size())
+			damaged[i] ^= 0x5a;
+
+		if (!write_file(path, damaged))
+			return false;
+
+		auto damaged_res = cache.parse_module(file);
+		auto is_same = damaged_res.is_ok();
+
+		if (is_same)
+		{
+			auto damaged_module = damaged_res.unwrap();
+
+			is_same = get_declarations_tree(damaged_module.structs, damaged_module.functions) == expected;
+		}
+
+		if (!is_same)
+		{
+			print_error("module loaded from a cache entry damaged at byte " + std::to_string(i) + " differs from parsing it");
+			return false;
+		}
+	}
+
+	if (cache.hits() != 0 || cache.misses() != entry.size() + 2)
+	{
+		print_error("damaged cache entries gave " + std::to_string(cache.hits()) + " hits");
+		return false;
+	}
+
+	std::filesystem::remove_all(cache_directory);
+
+	return true;
+}
+
+static String generate_module_source(usize declaration_count)
+{
+	String src;
+
+	for (usize i = 0; i < declaration_count; ++i)
+	{
+		auto index = std::to_string(i);
+
+		if (i % 4 == 0)
+			src += "struct type_" + index + "\n{\n\tvalue: u32,\n\tother: u64\n}\n\n";
+		else
+			src += "function function_" + index + "(a: u32, b: u32)\n{\n\ta = a + b * " + index + ";\n\tb = a;\n}\n\n";
+
+		// closes a block comment that an edit opens before it
+		if (i == 7)
+			src += "// */\n\n";
+	}
+
+	return src;
+}
+
+struct ReparseState
+{
+	String src;
+	// keeps the file of the module alive while its syntax is used
+	Box<File> file;
+	ModuleSyntax module;
+};
+
+// Applies an edit and checks that reparsing gives the same syntax and diagnostics as parsing
+// the edited file in full. Edits that leave the file with errors are undone.
+static bool check_reparse(ReparseState& state, const TextEdit& edit, const char *description)
+{
+	auto src = state.src.substr(0, edit.pos) + edit.text + state.src.substr(edit.pos + edit.length);
+	auto file = Box<File>(new File(File::from("reparse.wbl", src.c_str())));
+	auto skip_bodies = state.module.skip_bodies;
+	auto is_over_threshold = state.module.dead_node_count * 2 > state.module.pool->node_count();
+	auto full = Optional<ModuleSyntax>();
+	auto reparsed = Optional<ModuleSyntax>();
+	String full_diagnostics;
+	String reparsed_diagnostics;
+
+	{
+		DiagnosticCapture capture;
+		auto res = parse_module(*file, skip_bodies);
+
+		if (res)
+			full = res.unwrap();
+
+		full_diagnostics = capture.text();
+	}
+
+	{
+		DiagnosticCapture capture;
+		auto res = reparse_module(std::move(state.module), *file, edit);
+
+		if (res)
+			reparsed = res.unwrap();
+
+		reparsed_diagnostics = capture.text();
+	}
+
+	if (full.has_value() != reparsed.has_value() || full_diagnostics != reparsed_diagnostics)
+	{
+		print_error(String("reparsing after ") + description + " gave different results than parsing in full:\n" + reparsed_diagnostics);
+		return false;
+	}
+
+	if (!full)
+	{
+		// the previous syntax was consumed by the failed reparse
+		state.module = parse_module(*state.file, skip_bodies).unwrap();
+		return true;
+	}
+
+	auto expected = get_declarations_tree(full->structs, full->functions);
+	auto actual = get_declarations_tree(reparsed->structs, reparsed->functions);
+
+	if (actual != expected)
+	{
+		print_error(String("reparsing after ") + description + " gave:\n" + actual + "instead of:\n" + expected);
+		return false;
+	}
+
+	if (reparsed->skip_bodies != skip_bodies)
+	{
+		print_error(String("reparsing after ") + description + " did not keep bodies skipped");
+		return false;
+	}
+
+	// every node in the pool is either in use or counted as dead
+	if (reparsed->pool->node_count() - reparsed->dead_node_count != full->pool->node_count())
+	{
+		print_error(String("reparsing after ") + description + " lost track of the dead nodes in the pool");
+		return false;
+	}
+
+	if (is_over_threshold && reparsed->dead_node_count != 0)
+	{
+		print_error(String("reparsing after ") + description + " kept a pool that was mostly dead nodes");
+		return false;
+	}
+
+	state.src = std::move(src);
+	state.module = std::move(*reparsed);
+	state.file = std::move(file);
+
+	return true;
+}
+
+static TextEdit get_replacement(const String& src, const String& text, const String& replacement)
+{
+	auto pos = src.find(text);
+
+	assert(pos != String::npos);
+
+	return TextEdit { pos, text.size(), replacement };
+}
+
+static bool check_random_edits(ReparseState& state, usize edit_count)
+{
+	// the inserted text only uses characters the lexer accepts and the final new line is never
+	// edited, so every edit either parses or fails with a syntax error
+	static const char *snippets[] =
+	{
+		"", " ", "\n", "a", "1", ";", "{", "}", "/*", "*/", "//", "+ b", "\ta = a * b;\n", "\n}\n",
+		"function g(c: u32)\n{\n\tc = c;\n}\n", "struct s\n{\n\tv: u32\n}\n", "function_"
+	};
+
+	std::mt19937 rng(1234);
+
+	for (usize i = 0; i < edit_count; ++i)
+	{
+		auto size = state.src.size() - 1;
+		auto pos = rng() % size;
+		auto length = std::min<usize>(rng() % 24, size - pos);
+		auto edit = TextEdit { pos, length, snippets[rng() % std::size(snippets)] };
+
+		if (!check_reparse(state, edit, "a random edit"))
+			return false;
+	}
+
+	return true;
+}
+
+static bool test_incremental_reparse()
+{
+	auto src = generate_module_source(16);
+	auto file = Box<File>(new File(File::from("reparse.wbl", src.c_str())));
+	auto module = parse_module(*file).unwrap();
+	auto state = ReparseState { src, std::move(file), std::move(module) };
+
+	struct Replacement
+	{
+		const char *description;
+		const char *text;
+		const char *replacement;
+	};
+
+	static const Replacement replacements[] =
+	{
+		{ "editing a statement", "b * 3;", "b * 33;" },
+		{ "renaming a function", "function_5", "renamed_5" },
+		{ "inserting a function between two others", "}\n\nfunction function_3", "}\n\nfunction inserted(c: u32)\n{\n\tc = c;\n}\n\nfunction function_3" },
+		{ "deleting a function", "function function_6(a: u32, b: u32)\n{\n\ta = a + b * 6;\n\tb = a;\n}\n\n", "" },
+		{ "adding a struct member", "struct type_8\n{\n\tvalue: u32", "struct type_8\n{\n\tvalue: u32,\n\tadded: u8" },
+		{ "breaking a statement", "b * 10", "b * * 10" },
+		{ "joining two functions", "}\n\nfunction function_10(a: u32, b: u32)\n{", "" },
+		{ "opening a comment over several declarations", "\n\nfunction function_3", "\n/*\nfunction function_3" },
+		{ "closing the comment again", "/*", "" },
+		{ "removing a closing brace", "\tb = a;\n}\n\nfunction function_14", "\tb = a;\n\nfunction function_14" },
+		{ "editing the first declaration", "struct type_0", "struct first_type" },
+		{ "editing the last declaration", "b * 15;", "b;" },
+	};
+
+	for (const auto& replacement : replacements)
+	{
+		auto edit = get_replacement(state.src, replacement.text, replacement.replacement);
+
+		if (!check_reparse(state, edit, replacement.description))
+			return false;
+	}
+
+	if (!check_random_edits(state, 1000))
+		return false;
+
+	// edits of a module parsed without function bodies have to be reparsed the same way
+	auto skipped_file = Box<File>(new File(File::from("reparse_skipped.wbl", src.c_str())));
+	auto skipped_module = parse_module(*skipped_file, true).unwrap();
+	auto skipped_state = ReparseState { src, std::move(skipped_file), std::move(skipped_module) };
+
+	return check_random_edits(skipped_state, 300);
+}
+
+static bool test_signature_parsing()
+{
+	auto src = generate_module_source(16);
+	auto file = File::from("signatures.wbl", src.c_str());
+	auto full = parse_module(file).unwrap();
+	auto res = parse_module(file, true);
+
+	if (!res)
+	{
+		print_error("failed to parse signatures");
+		return false;
+	}
+
+	auto module = res.unwrap();
+
+	for (const auto& function : module.functions)
+	{
+		if (function.is_body_parsed())
+		{
+			print_error(function.name(), "body was parsed while parsing signatures");
+			return false;
+		}
+	}
+
+	if (!module.pool->nodes<StatementSyntax>().empty())
+	{
+		print_error("statements were added to the pool while parsing signatures");
+		return false;
+	}
+
+	// bodies parsed later have to be the same as when they are parsed with their signature
+	if (!parse_function_bodies(module) || get_declarations_tree(module.structs, module.functions) != get_declarations_tree(full.structs, full.functions))
+	{
+		print_error("bodies parsed after their signatures differ from parsing them in full:\n" + get_declarations_tree(module.structs, module.functions));
+		return false;
+	}
+
+	auto directories = generate_packages(3, 4, 0);
+	auto program_res = parse(directories, 2, nullptr, true);
+
+	if (!program_res)
+	{
+		print_error("failed to parse signatures of generated packages");
+		return false;
+	}
+
+	auto program = program_res.unwrap();
+	auto globals = GlobalSymbolTable::generate(program);
+
+	if (!globals)
+	{
+		print_error("failed to generate the symbol table from signatures");
+		return false;
+	}
+
+	auto table = globals.unwrap();
+
+	table.push_package("package2");
+
+	auto *function = table.resolve(Interner::intern("function_2_3_1"));
+
+	if (function == nullptr || function->type() != SymbolType::Function || function->function_syntax().is_body_parsed())
+	{
+		print_error("function was not found in the symbol table generated from signatures");
+		return false;
+	}
+
+	for (auto& package : program.packages())
+	{
+		if (!parse_function_bodies(package))
+		{
+			print_error("failed to parse skipped bodies of package " + package.name());
+			return false;
+		}
+	}
+
+	if (get_program_tree(program) != get_program_tree(parse(directories, 1).unwrap()))
+	{
+		print_error("bodies of generated packages parsed after their signatures differ from parsing them in full");
+		return false;
+	}
+
+	// blocks are not statements yet, but their braces are still matched
+	auto nested_file = File::from("nested.wbl", "function nested(a: u32)\n{\n\t{\n\t\ta = a;\n\t\t{\n\t\t}\n\t}\n}\nfunction after(b: u32)\n{\n\tb = b;\n}\n");
+	auto nested = parse_module(nested_file, true);
+
+	if (!nested)
+	{
+		print_error("failed to parse signatures of functions with nested braces");
+		return false;
+	}
+
+	auto nested_module = nested.unwrap();
+
+	if (nested_module.functions.size() != 2 || nested_module.functions[1].name().text() != "after")
+	{
+		print_error("nested braces were not matched while parsing signatures");
+		return false;
+	}
+
+	auto unmatched_file = File::from("unmatched.wbl", "function unmatched(a: u32)\n{\n\t{\n\ta = a;\n}\n");
+	bool is_parsed;
+
+	{
+		DiagnosticCapture capture;
+
+		is_parsed = parse_module(unmatched_file, true).is_ok();
+	}
+
+	if (is_parsed)
+	{
+		print_error("function body without a closing brace was skipped");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_package_scopes()
+{
+	auto directories = Array<Directory>();
+
+	directories.emplace_back(Directory::from("outer", File::from("outer.wbl", "function shared()\n{\n}\nfunction outer_only()\n{\n}\n")));
+	directories.emplace_back(Directory::from("outer::inner", File::from("inner.wbl", "function shared()\n{\n}\n")));
+	directories.emplace_back(Directory::from("other", File::from("other.wbl", "function shared()\n{\n}\n")));
+
+	auto program = parse(directories, 1).unwrap();
+	auto globals = GlobalSymbolTable::generate(program);
+
+	if (!globals)
+	{
+		print_error("packages declaring the same name in different scopes conflicted");
+		return false;
+	}
+
+	auto table = globals.unwrap();
+	auto shared = Interner::intern("shared");
+	auto outer_only = Interner::intern("outer_only");
+
+	auto resolves_to = [&](u32 identifier, StringView symbol)
+	{
+		auto *data = table.resolve(identifier);
+
+		return symbol.empty()
+			? data == nullptr
+			: data != nullptr && data->symbol_text() == symbol;
+	};
+
+	table.push_package("outer");
+	table.push_package("inner");
+
+	if (!resolves_to(shared, "outer::inner::shared") || !resolves_to(outer_only, "outer::outer_only"))
+	{
+		print_error("names in a nested package did not resolve through its parents");
+		return false;
+	}
+
+	auto *primitive = table.resolve(Interner::intern("u32"));
+
+	if (primitive == nullptr || primitive->type() != SymbolType::Primitive)
+	{
+		print_error("primitive did not resolve from a nested package");
+		return false;
+	}
+
+	table.pop_package();
+
+	if (!resolves_to(shared, "outer::shared"))
+	{
+		print_error("popping a package did not return to its parent");
+		return false;
+	}
+
+	table.pop_package();
+	table.push_package("other");
+
+	if (!resolves_to(shared, "other::shared") || !resolves_to(outer_only, ""))
+	{
+		print_error("names resolved into a sibling package");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_scoped_variables()
+{
+	auto file = File::from("scopes.wbl", "function f()\n{\n\tvar a: u32 = 1;\n\tvar b: u32 = 2;\n\tvar a: u32 = 3;\n\tvar b: u32 = 4;\n}\n");
+	auto module = parse_module(file).unwrap();
+	const auto& declarations = module.pool->nodes<DeclarationSyntax>();
+	auto globals = GlobalSymbolTable::generate(ProgramSyntax(Array<PackageSyntax>())).unwrap();
+	auto symbols = FunctionSymbolTable(globals);
+	auto a = Interner::intern("a");
+	auto b = Interner::intern("b");
+
+	auto resolves_to = [&](u32 identifier, const DeclarationSyntax *declaration)
+	{
+		auto *data = symbols.resolve(identifier);
+
+		return declaration == nullptr
+			? data == nullptr
+			: data != nullptr && &data->variable_syntax() == &declaration->variable();
+	};
+
+	symbols.push_block();
+	symbols.add_variable(declarations[0].variable());
+	symbols.push_block();
+
+	if (!symbols.add_variable(declarations[2].variable()).success || !resolves_to(a, &declarations[2]) || !resolves_to(b, nullptr))
+	{
+		print_error("variable in an inner block did not shadow the outer one");
+		return false;
+	}
+
+	symbols.add_variable(declarations[1].variable());
+
+	bool is_redeclared;
+
+	{
+		DiagnosticCapture capture;
+
+		is_redeclared = !symbols.add_variable(declarations[3].variable()).success;
+	}
+
+	if (!is_redeclared || !resolves_to(b, &declarations[3]))
+	{
+		print_error("variable declared twice in a block was not reported");
+		return false;
+	}
+
+	symbols.pop_block();
+
+	if (!resolves_to(a, &declarations[0]) || !resolves_to(b, nullptr))
+	{
+		print_error("leaving a block did not restore the variables it shadowed");
+		return false;
+	}
+
+	symbols.pop_block();
+
+	if (!resolves_to(a, nullptr))
+	{
+		print_error("variable is still bound after leaving its block");
+		return false;
+	}
+
+	return true;
+}
+
+int main()
+{
+	bool success = true;
+
+	success = test_expression_trees() && success;
+	success = test_pool_registry() && success;
+	success = test_parallel_parsing() && success;
+	success = test_syntax_cache() && success;
+	success = test_damaged_cache_entries() && success;
+	success = test_incremental_reparse() && success;
+	success = test_signature_parsing() && success;
+	success = test_package_scopes() && success;
+	success = test_scoped_variables() && success;
+
+	if (!success)
+		return 1;
+
+	print_note("parser tests passed");
+
+	return 0;
+}
@@ -0,0 +1,194 @@
+// local headers
+#include <warbler/file.hpp>
+#include <warbler/source_manager.hpp>
+#include <warbler/util/print.hpp>
+
+// standard headers
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+using namespace warbler;
+
+static bool is_unloaded(u32 location)
+{
+	try
+	{
+		SourceManager::get_file(location);
+	}
+	catch (const std::runtime_error&)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+static bool test_file_lookup()
+{
+	Array<File> files;
+
+	for (usize i = 0; i < 50; ++i)
+		files.emplace_back(File::from(("lookup" + std::to_string(i) + ".wbl").c_str(), String(i * 997, 'x').c_str()));
+
+	// moving the files into the array has to have moved their entries along with them
+	for (const auto& file : files)
+	{
+		for (usize pos = 0; pos <= file.src().size(); ++pos)
+		{
+			if (&SourceManager::get_file(file.get_location(pos)) != &file)
+			{
+				print_error("location of position " + std::to_string(pos) + " in " + file.filename() + " does not map back to it");
+				return false;
+			}
+		}
+
+		if (!is_unloaded(file.get_location(file.src().size()) + 1))
+		{
+			print_error("location after the end of " + file.filename() + " belongs to a file");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static std::unique_ptr<File> create_file(const char *name, usize size)
+{
+	return std::make_unique<File>(File::from(name, String(size, 'x').c_str()));
+}
+
+static bool test_range_reuse()
+{
+	auto first = create_file("first.wbl", 10'000);
+	auto second = create_file("second.wbl", 10'000);
+	auto third = create_file("third.wbl", 1);
+	auto first_base = first->base();
+	auto second_base = second->base();
+
+	first.reset();
+
+	if (!is_unloaded(first_base) || &SourceManager::get_file(second_base) != second.get())
+	{
+		print_error("removing a file did not unload only its locations");
+		return false;
+	}
+
+	auto reused = create_file("reused.wbl", 5'000);
+
+	if (reused->base() != first_base)
+	{
+		print_error("locations of a removed file were not reused");
+		return false;
+	}
+
+	// the ranges of neighbouring files are merged, so a file as big as both fits where they were
+	reused.reset();
+	second.reset();
+
+	auto merged = create_file("merged.wbl", 20'000);
+
+	if (merged->base() != first_base)
+	{
+		print_error("ranges of neighbouring removed files were not merged");
+		return false;
+	}
+
+	if (&SourceManager::get_file(third->base()) != third.get() || &SourceManager::get_file(merged->get_location(20'000)) != merged.get())
+	{
+		print_error("files added around removed ones were not found");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_long_session()
+{
+	// every file takes at least a page of 4096 locations, so far more locations are used over
+	// the session than fit in 4 GiB, but never at once
+	const usize edit_count = (usize(1) << 20) + 1024;
+
+	auto previous = create_file("edit.wbl", 0);
+
+	for (usize i = 0; i < edit_count; ++i)
+	{
+		// an edited file is loaded before the previous version of it is removed
+		auto next = create_file("edit.wbl", i % 64);
+
+		previous = std::move(next);
+	}
+
+	if (&SourceManager::get_file(previous->base()) != previous.get())
+	{
+		print_error("file loaded at the end of a long session was not found");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_concurrent_lookup()
+{
+	const usize file_count = 64;
+	const usize thread_count = 4;
+
+	Array<File> files;
+
+	for (usize i = 0; i < file_count; ++i)
+		files.emplace_back(File::from("shared.wbl", String(1 + i * 131, 'x').c_str()));
+
+	std::atomic<bool> is_done = false;
+	std::atomic<bool> success = true;
+	Array<std::thread> threads;
+
+	// files are looked up on several threads while another adds and removes files
+	for (usize t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (usize i = 0; !is_done; ++i)
+			{
+				const auto& file = files[(i + t) % file_count];
+				auto pos = (i * 7) % (file.src().size() + 1);
+
+				if (&SourceManager::get_file(file.get_location(pos)) != &file)
+					success = false;
+			}
+		});
+	}
+
+	for (usize i = 0; i < 2'000; ++i)
+		auto file = File::from("temporary.wbl", String(i % 9'000, 'y').c_str());
+
+	is_done = true;
+
+	for (auto& thread : threads)
+		thread.join();
+
+	if (!success)
+	{
+		print_error("files were not found while other files were added and removed");
+		return false;
+	}
+
+	return true;
+}
+
+int main()
+{
+	bool success = true;
+
+	success = test_file_lookup() && success;
+	success = test_range_reuse() && success;
+	success = test_long_session() && success;
+	success = test_concurrent_lookup() && success;
+
+	if (!success)
+		return 1;
+
+	print_note("source manager tests passed");
+
+	return 0;
+}
@@ -0,0 +1,121 @@
+// local headers
+#include <warbler/util/table.hpp>
+#include <warbler/util/print.hpp>
+
+// standard headers
+#include <random>
+#include <unordered_map>
+
+using namespace warbler;
+
+static bool test_atom_table()
+{
+	const usize key_count = 20'000;
+
+	std::mt19937 rng(4321);
+	AtomTable<u32> table;
+	std::unordered_map<u32, u32> expected;
+	Array<u32> insertion_order;
+	Array<const u32 *> references;
+
+	for (usize i = 0; i < key_count; ++i)
+	{
+		// small keys collide with each other often enough to exercise duplicate insertion
+		auto key = rng() % (key_count * 2);
+		auto result = table.emplace(key, static_cast<u32>(i));
+
+		if (result.second != expected.emplace(key, static_cast<u32>(i)).second)
+		{
+			print_error("table and unordered_map disagree on whether " + std::to_string(key) + " was inserted");
+			return false;
+		}
+
+		if (result.second)
+		{
+			insertion_order.push_back(key);
+			references.push_back(&result.first->second);
+		}
+	}
+
+	if (table.size() != expected.size())
+	{
+		print_error("table holds " + std::to_string(table.size()) + " entries instead of " + std::to_string(expected.size()));
+		return false;
+	}
+
+	for (usize key = 0; key < key_count * 2; ++key)
+	{
+		auto iter = table.find(static_cast<u32>(key));
+		auto expected_iter = expected.find(static_cast<u32>(key));
+
+		if ((iter == table.end()) != (expected_iter == expected.end()) || (iter != table.end() && iter->second != expected_iter->second))
+		{
+			print_error("lookup of " + std::to_string(key) + " differs from unordered_map");
+			return false;
+		}
+	}
+
+	usize index = 0;
+
+	for (const auto& entry : table)
+	{
+		if (entry.first != insertion_order[index] || &entry.second != references[index])
+		{
+			print_error("entries moved or were not iterated in insertion order");
+			return false;
+		}
+
+		index += 1;
+	}
+
+	auto copy = table;
+	auto moved = std::move(copy);
+
+	if (moved.size() != table.size() || !copy.empty() || moved.find(insertion_order.back()) == moved.end() || &moved.at(insertion_order[0]) == references[0])
+	{
+		print_error("copied or moved table differs from the original");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_string_table()
+{
+	Table<usize> table;
+
+	for (usize i = 0; i < 1'000; ++i)
+		table.emplace(StringView("name_" + std::to_string(i)), i);
+
+	String buffer = "prefix name_512 suffix";
+	auto view = StringView(buffer).substr(7, 8);
+
+	if (!table.contains(view) || table.at(view) != 512 || table.at("name_3") != 3 || table.contains("name_1000"))
+	{
+		print_error("string table lookup by view or C string failed");
+		return false;
+	}
+
+	if (table.emplace(String("name_7"), 0).second || table.at(String("name_7")) != 7)
+	{
+		print_error("emplacing an existing string key replaced its value");
+		return false;
+	}
+
+	return true;
+}
+
+int main()
+{
+	bool success = true;
+
+	success = test_atom_table() && success;
+	success = test_string_table() && success;
+
+	if (!success)
+		return 1;
+
+	print_note("table tests passed");
+
+	return 0;
+}
@@ -0,0 +1,543 @@
+// local headers
+#include <warbler/parser.hpp>
+#include <warbler/validator.hpp>
+#include <warbler/util/print.hpp>
+
+// standard headers
+#include <stdexcept>
+
+using namespace warbler;
+
+// Every package has a package nested in it whose bodies use names declared in the outer one,
+// so a body only validates when it is resolved from the package it was declared in. Every
+// broken_step-th function uses a name that is declared nowhere.
+static Array<Directory> generate_packages(usize package_count, usize function_count, usize broken_step)
+{
+	Array<Directory> directories;
+	usize function_number = 0;
+
+	for (usize i = 0; i < package_count; ++i)
+	{
+		auto package = "package" + std::to_string(i);
+		String outer_src;
+		String inner_src;
+
+		outer_src += "function shared_" + std::to_string(i) + "(a: u32)\n{\n\ta = a;\n}\n";
+
+		for (usize j = 0; j < function_count; ++j)
+		{
+			auto name = std::to_string(i) + "_" + std::to_string(j);
+
+			function_number += 1;
+
+			auto value = broken_step > 0 && function_number % broken_step == 0
+				? "undeclared_" + name
+				: "shared_" + std::to_string(i);
+
+			inner_src += "function function_" + name + "(a: u32)\n{\n\tvar b: u32 = a;\n\tb = " + value + ";\n}\n";
+		}
+
+		directories.emplace_back(Directory::from(package.c_str(), File::from("outer.wbl", outer_src.c_str())));
+		directories.emplace_back(Directory::from((package + "::inner").c_str(), File::from("inner.wbl", inner_src.c_str())));
+	}
+
+	return directories;
+}
+
+struct ValidationOutput
+{
+	bool is_valid;
+	usize function_count;
+	String diagnostics;
+};
+
+static ValidationOutput validate_captured(const ProgramSyntax& program, usize worker_count)
+{
+	DiagnosticCapture capture;
+	auto res = validate(program, worker_count);
+
+	if (!res)
+		return { false, 0, capture.text() };
+
+	return { true, res.unwrap().functions().size(), capture.text() };
+}
+
+static bool test_parallel_validation()
+{
+	static const usize worker_counts[] = { 2, 3, 8 };
+
+	auto directories = generate_packages(4, 32, 0);
+	auto program = parse(directories, 1).unwrap();
+	auto serial = validate_captured(program, 1);
+
+	if (!serial.is_valid || serial.function_count != 4 * 33)
+	{
+		print_error("generated packages did not validate serially:\n" + serial.diagnostics);
+		return false;
+	}
+
+	auto broken_directories = generate_packages(4, 32, 19);
+	auto broken_program = parse(broken_directories, 1).unwrap();
+	auto broken_serial = validate_captured(broken_program, 1);
+
+	if (broken_serial.is_valid || broken_serial.diagnostics.find("undeclared_0_18") == String::npos || broken_serial.diagnostics.find("undeclared_1_5") != String::npos)
+	{
+		print_error("validation did not stop at the first invalid body:\n" + broken_serial.diagnostics);
+		return false;
+	}
+
+	for (auto worker_count : worker_counts)
+	{
+		auto parallel = validate_captured(program, worker_count);
+		auto broken_parallel = validate_captured(broken_program, worker_count);
+
+		if (!parallel.is_valid || parallel.function_count != serial.function_count || parallel.diagnostics != serial.diagnostics)
+		{
+			print_error("validating with " + std::to_string(worker_count) + " workers differs from validating serially");
+			return false;
+		}
+
+		if (broken_parallel.is_valid || broken_parallel.diagnostics != broken_serial.diagnostics)
+		{
+			print_error("diagnostics of validating with " + std::to_string(worker_count) + " workers differ from validating serially:\n" + broken_parallel.diagnostics);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Struct i of the outer package is made of structs declared after it, and every struct of the
+// nested package is made of one of the outer package, so no struct can be validated in the
+// order it is declared.
+static Array<Directory> generate_struct_packages(usize struct_count)
+{
+	String outer_src;
+	String inner_src;
+
+	for (usize i = 0; i < struct_count; ++i)
+	{
+		auto index = std::to_string(i);
+
+		outer_src += "struct type_" + index + "\n{\n\tvalue: u32";
+
+		for (auto member : { 2 * i + 1, 3 * i + 2 })
+		{
+			if (member < struct_count)
+				outer_src += ",\n\tmember_" + std::to_string(member) + ": type_" + std::to_string(member);
+		}
+
+		outer_src += "\n}\n";
+		inner_src += "struct inner_" + index + "\n{\n\touter: type_" + std::to_string(struct_count - 1 - i) + "\n}\n";
+	}
+
+	Array<Directory> directories;
+
+	directories.emplace_back(Directory::from("schema", File::from("outer.wbl", outer_src.c_str())));
+	directories.emplace_back(Directory::from("schema::inner", File::from("inner.wbl", inner_src.c_str())));
+
+	return directories;
+}
+
+static String get_struct_order(const ProgramContext& program)
+{
+	String order;
+
+	for (const auto& type : program.structs())
+		order += String(Interner::get(type.symbol())) + "\n";
+
+	return order;
+}
+
+static bool test_struct_dependencies()
+{
+	static const usize worker_counts[] = { 1, 2, 3, 8 };
+
+	const usize struct_count = 500;
+
+	auto directories = generate_struct_packages(struct_count);
+	auto program = parse(directories, 1).unwrap();
+	String expected_order;
+
+	for (auto worker_count : worker_counts)
+	{
+		DiagnosticCapture capture;
+		auto res = validate(program, worker_count);
+
+		if (!res)
+		{
+			print_error("structs failed to validate with " + std::to_string(worker_count) + " workers:\n" + capture.text());
+			return false;
+		}
+
+		auto context = res.unwrap();
+		const auto& structs = context.structs();
+
+		if (structs.size() != 2 * struct_count)
+		{
+			print_error(std::to_string(structs.size()) + " structs were validated instead of " + std::to_string(2 * struct_count));
+			return false;
+		}
+
+		for (usize i = 0; i < structs.size(); ++i)
+		{
+			for (const auto& member : structs[i].members())
+			{
+				const auto& type = member.type();
+
+				if (type.type() == AnnotationType::Struct && type.index() >= i)
+				{
+					print_error("struct " + String(Interner::get(structs[i].symbol())) + " was validated before one of its members");
+					return false;
+				}
+			}
+		}
+
+		auto order = get_struct_order(context);
+
+		if (expected_order.empty())
+			expected_order = order;
+
+		if (order != expected_order)
+		{
+			print_error("struct indices differ when validating with " + std::to_string(worker_count) + " workers");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test_recursive_structs()
+{
+	auto src = "struct a_type\n{\n\tb: b_type\n}\n"
+		"struct b_type\n{\n\ta: a_type\n}\n"
+		"struct self_type\n{\n\tself: self_type\n}\n"
+		"struct leaf_type\n{\n\tvalue: u32\n}\n"
+		"struct user_type\n{\n\ta: a_type,\n\tleaf: leaf_type\n}\n";
+	auto directories = Array<Directory>();
+
+	directories.emplace_back(Directory::from("cycles", File::from("cycles.wbl", src)));
+
+	auto program = parse(directories, 1).unwrap();
+	auto serial = validate_captured(program, 1);
+	const auto& diagnostics = serial.diagnostics;
+
+	if (serial.is_valid
+		|| diagnostics.find("'cycles::a_type' contains itself") == String::npos
+		|| diagnostics.find("'cycles::b_type' is part of the same cycle") == String::npos
+		|| diagnostics.find("'cycles::self_type' contains itself") == String::npos
+		|| diagnostics.find("user_type") != String::npos
+		|| diagnostics.find("leaf_type") != String::npos)
+	{
+		print_error("recursive structs were not reported as expected:\n" + diagnostics);
+		return false;
+	}
+
+	if (validate_captured(program, 4).diagnostics != diagnostics)
+	{
+		print_error("recursive structs were reported differently when validating on several workers");
+		return false;
+	}
+
+	return true;
+}
+
+static const MemberContext& get_member(const ProgramContext& program, StringView struct_name, StringView member_name)
+{
+	for (const auto& type : program.structs())
+	{
+		if (Interner::get(type.symbol()) == struct_name)
+		{
+			auto *member = type.find_member(Interner::find(member_name));
+
+			if (member != nullptr)
+				return *member;
+		}
+	}
+
+	throw std::invalid_argument("member was not validated");
+}
+
+static bool test_type_interning()
+{
+	auto src = "struct point\n{\n\tx: u32,\n\ty: u32\n}\n"
+		"struct path\n{\n\tstart: point,\n\tcursor: *mut point,\n\tpoints: **point,\n\tcount: u32\n}\n"
+		"struct route\n{\n\tfirst: *mut point,\n\tall: **point,\n\tlength: u32\n}\n";
+	auto directories = Array<Directory>();
+
+	directories.emplace_back(Directory::from("types", File::from("types.wbl", src)));
+
+	auto program = parse(directories, 1).unwrap();
+	auto context = validate(program, 1).unwrap();
+
+	const auto& start = get_member(context, "types::path", "start").type();
+	const auto& cursor = get_member(context, "types::path", "cursor").type();
+	const auto& points = get_member(context, "types::path", "points").type();
+	const auto& count = get_member(context, "types::path", "count").type();
+	const auto& first = get_member(context, "types::route", "first").type();
+	const auto& all = get_member(context, "types::route", "all").type();
+	const auto& length = get_member(context, "types::route", "length").type();
+
+	if (start.type() != AnnotationType::Struct || Interner::get(context.structs()[start.index()].symbol()) != "types::point")
+	{
+		print_error("struct member was not given the type of its struct");
+		return false;
+	}
+
+	if (count.id() != U32_INDEX || count != length)
+	{
+		print_error("primitive annotations were not given the id of their primitive");
+		return false;
+	}
+
+	auto pointee = TypeInterner::get(points.id()).pointee;
+
+	if (cursor != first || points != all || cursor == points || cursor.ptr_depth() != 1 || points.ptr_depth() != 2
+		|| cursor.index() != start.index() || points.index() != start.index()
+		|| TypeInterner::get(pointee).is_mutable || pointee == cursor.id()
+		|| TypeInterner::intern_pointer(start.id(), true) != cursor.id())
+	{
+		print_error("pointer types were not interned by their pointee and mutability");
+		return false;
+	}
+
+	auto type_count = TypeInterner::size();
+
+	validate(program, 1).unwrap();
+
+	if (TypeInterner::size() != type_count)
+	{
+		print_error("validating the same types again interned new ones");
+		return false;
+	}
+
+	return true;
+}
+
+static const StructContext *find_struct(const ProgramContext& program, StringView name)
+{
+	for (const auto& type : program.structs())
+	{
+		if (Interner::get(type.symbol()) == name)
+			return &type;
+	}
+
+	return nullptr;
+}
+
+static bool test_pointer_members()
+{
+	// pointers only need the struct they point to to exist, so they may point back to it
+	auto src = "struct node\n{\n\tvalue: u32,\n\tnext: *node\n}\n"
+		"struct list\n{\n\thead: node,\n\ttail: *mut node\n}\n";
+	auto directories = Array<Directory>();
+
+	directories.emplace_back(Directory::from("linked", File::from("linked.wbl", src)));
+
+	auto program = parse(directories, 1).unwrap();
+	auto res = validate_captured(program, 1);
+
+	if (!res.is_valid)
+	{
+		print_error("struct with a pointer to itself was not valid:\n" + res.diagnostics);
+		return false;
+	}
+
+	auto context = validate(program, 1).unwrap();
+	const auto *node = find_struct(context, "linked::node");
+	const auto& next = get_member(context, "linked::node", "next").type();
+	const auto& head = get_member(context, "linked::list", "head").type();
+
+	if (node == nullptr || next.ptr_depth() != 1 || next.index() != head.index() || &context.structs()[next.index()] != node
+		|| node->size() != 8 + sizeof(void *))
+	{
+		print_error("pointer member of a linked list was not given the type of its own struct");
+		return false;
+	}
+
+	// structs pointing at each other are never recursive either
+	src = "struct parent\n{\n\tfirst: *child,\n\tcount: u32\n}\n"
+		"struct child\n{\n\towner: *mut parent,\n\tsibling: *child\n}\n"
+		"struct family\n{\n\tparent: parent,\n\tchild: child\n}\n";
+
+	auto mutual_directories = Array<Directory>();
+
+	mutual_directories.emplace_back(Directory::from("mutual", File::from("mutual.wbl", src)));
+
+	auto mutual_program = parse(mutual_directories, 1).unwrap();
+	auto serial = validate_captured(mutual_program, 1);
+
+	if (!serial.is_valid || validate_captured(mutual_program, 4).diagnostics != serial.diagnostics)
+	{
+		print_error("structs pointing at each other were not valid:\n" + serial.diagnostics);
+		return false;
+	}
+
+	auto mutual = validate(mutual_program, 4).unwrap();
+	const auto& first = get_member(mutual, "mutual::parent", "first").type();
+	const auto& owner = get_member(mutual, "mutual::child", "owner").type();
+	const auto& child = get_member(mutual, "mutual::family", "child").type();
+	const auto& parent = get_member(mutual, "mutual::family", "parent").type();
+
+	if (first.index() != child.index() || owner.index() != parent.index() || !TypeInterner::get(owner.id()).is_mutable)
+	{
+		print_error("pointer members of structs pointing at each other were given the wrong types");
+		return false;
+	}
+
+	return true;
+}
+
+struct ExpectedMember
+{
+	const char *name;
+	u32 offset;
+	u32 size;
+};
+
+static bool test_struct_layout()
+{
+	static const ExpectedMember expected_members[] =
+	{
+		{ "a", 0, 1 },
+		{ "b", 8, 16 },
+		{ "c", 24, 2 },
+		{ "d", 32, sizeof(void *) },
+		{ "e", 32 + sizeof(void *), 4 },
+		{ "f", 36 + sizeof(void *), 1 }
+	};
+
+	String src = "struct inner\n{\n\tflag: bool,\n\tvalue: u64\n}\n"
+		"struct outer\n{\n\ta: u8,\n\tb: inner,\n\tc: u16,\n\td: *inner,\n\te: char,\n\tf: u8\n}\n"
+		"struct wide\n{\n\tfield_0: u32";
+
+	// enough members to be searched through an index instead of member by member
+	for (usize i = 1; i < 20; ++i)
+		src += ",\n\tfield_" + std::to_string(i) + ": u32";
+
+	src += "\n}\n";
+
+	auto directories = Array<Directory>();
+
+	directories.emplace_back(Directory::from("layout", File::from("layout.wbl", src.c_str())));
+
+	auto program = parse(directories, 1).unwrap();
+	auto context = validate(program, 1).unwrap();
+	const StructContext *outer = nullptr;
+	const StructContext *wide = nullptr;
+
+	for (const auto& type : context.structs())
+	{
+		if (Interner::get(type.symbol()) == "layout::outer")
+			outer = &type;
+		else if (Interner::get(type.symbol()) == "layout::wide")
+			wide = &type;
+	}
+
+	if (outer == nullptr || wide == nullptr || outer->members().size() != 6)
+	{
+		print_error("layout structs were not validated");
+		return false;
+	}
+
+	for (usize i = 0; i < outer->members().size(); ++i)
+	{
+		const auto& member = outer->members()[i];
+		const auto& expected = expected_members[i];
+
+		if (Interner::get(member.name()) != expected.name || member.offset() != expected.offset || member.size() != expected.size)
+		{
+			print_error("member " + String(Interner::get(member.name())) + " is at offset " + std::to_string(member.offset()) + " with size " + std::to_string(member.size()) + " instead of member " + expected.name + " at offset " + std::to_string(expected.offset) + " with size " + std::to_string(expected.size));
+			return false;
+		}
+	}
+
+	if (outer->size() != 40 + sizeof(void *) || outer->alignment() != 8)
+	{
+		print_error("struct has size " + std::to_string(outer->size()) + " and alignment " + std::to_string(outer->alignment()));
+		return false;
+	}
+
+	for (usize i = 0; i < 20; ++i)
+	{
+		auto *member = wide->find_member(Interner::find("field_" + std::to_string(i)));
+
+		if (member == nullptr || member != &wide->members()[i] || member->offset() != 4 * i)
+		{
+			print_error("member field_" + std::to_string(i) + " of a large struct was not found by name");
+			return false;
+		}
+	}
+
+	if (wide->find_member(Interner::intern("field_20")) != nullptr || wide->size() != 80)
+	{
+		print_error("large struct has a member it was not declared with or the wrong size");
+		return false;
+	}
+
+	src = "struct duplicate\n{\n\tfield_0: u32";
+
+	for (usize i = 1; i < 20; ++i)
+		src += ",\n\tfield_" + std::to_string(i % 12) + ": u32";
+
+	src += "\n}\n";
+
+	auto duplicate_directories = Array<Directory>();
+
+	duplicate_directories.emplace_back(Directory::from("layout", File::from("duplicate.wbl", src.c_str())));
+
+	auto duplicate_program = parse(duplicate_directories, 1).unwrap();
+	auto duplicate = validate_captured(duplicate_program, 1);
+
+	if (duplicate.is_valid || duplicate.diagnostics.find("'field_7' is already declared") == String::npos || duplicate.diagnostics.find("'field_8' is already declared") != String::npos)
+	{
+		print_error("duplicate members of a large struct were not reported:\n" + duplicate.diagnostics);
+		return false;
+	}
+
+	// every struct is twice the size of the one before it, so the struct of 2^32 bytes is
+	// reported and the ones made of it are not
+	src = "struct half_0\n{\n\ta: u64,\n\tb: u64\n}\n";
+
+	for (usize i = 1; i < 32; ++i)
+	{
+		auto previous = "half_" + std::to_string(i - 1);
+
+		src += "struct half_" + std::to_string(i) + "\n{\n\ta: " + previous + ",\n\tb: " + previous + "\n}\n";
+	}
+
+	auto large_directories = Array<Directory>();
+
+	large_directories.emplace_back(Directory::from("layout", File::from("large.wbl", src.c_str())));
+
+	auto large_program = parse(large_directories, 1).unwrap();
+	auto large = validate_captured(large_program, 1);
+
+	if (large.is_valid || large.diagnostics.find("'layout::half_28' would be larger") == String::npos || large.diagnostics.find("'layout::half_29'") != String::npos)
+	{
+		print_error("struct larger than 4 GiB was not reported:\n" + large.diagnostics);
+		return false;
+	}
+
+	return true;
+}
+
+int main()
+{
+	bool success = true;
+
+	success = test_parallel_validation() && success;
+	success = test_struct_dependencies() && success;
+	success = test_recursive_structs() && success;
+	success = test_type_interning() && success;
+	success = test_pointer_members() && success;
+	success = test_struct_layout() && success;
+
+	if (!success)
+		return 1;
+
+	print_note("validator tests passed");
+
+	return 0;
+}
@@ -1,5 +1,6 @@
 #include <warbler/c_generator.hpp>
 #include <warbler/type.hpp>
+#include <warbler/interner.hpp>
 
 #include <stdexcept>
 
@@ -7,7 +8,7 @@ namespace warbler
 {
     String generate_c_statement(const StatementContext& statement, const ProgramContext& program, const FunctionContext& function);
 
-    static String mangle_symbol(const String& symbol)
+    static String mangle_symbol(StringView symbol)
     {
         String mangled_symbol;
 
@@ -100,24 +101,24 @@ namespace warbler
         throw std::runtime_error("Primitive annotation generation is not implemented for this type");
     }
 
-    String generate_c_type_annotation(const TypeAnnotationContext& type_annotation, const ProgramContext& program)
+    String generate_c_base_type_annotation(const TypeData& type, const ProgramContext& program)
     {
-        switch (type_annotation.type())
+        switch (type.type)
         {
             case AnnotationType::Primitive:
             {
-                assert(type_annotation.index() < primitive_count);
+                assert(type.index < primitive_count);
 
-                const auto& primitive = primitives[type_annotation.index()];
+                const auto& primitive = primitives[type.index];
 
                 return generate_c_primitive_annotation(primitive);
             }
 
             case AnnotationType::Struct:
             {
-                const auto& strct = program.structs()[type_annotation.index()];
+                const auto& strct = program.structs()[type.index];
 
-                auto symbol = mangle_symbol(strct.symbol());
+                auto symbol = mangle_symbol(Interner::get(strct.symbol()));
 
                 return "struct " + symbol;
             }
@@ -129,6 +130,18 @@ namespace warbler
         throw std::invalid_argument("Invalid type given to TypeAnnotationContext");
     }
 
+    String generate_c_type_annotation(const TypeAnnotationContext& type_annotation, const ProgramContext& program)
+    {
+        auto type = TypeInterner::get(type_annotation.id());
+        auto output = generate_c_base_type_annotation(type, program);
+
+        // the generated C does not express the mutability of pointers
+        for (u32 i = 0; i < type.ptr_depth; ++i)
+            output += '*';
+
+        return output;
+    }
+
     String generate_c_struct_member(const ProgramContext& program, const MemberContext& context)
     {
         String output;
@@ -138,7 +151,7 @@ namespace warbler
         output += "\n\t";
         output += generate_c_type_annotation(context.type(), program);
         output += ' ';
-        output += context.name();
+        output += Interner::get(context.name());
         output += ';';
 
         return output;
@@ -151,7 +164,7 @@ namespace warbler
         output.reserve(32);
 
         output += "struct ";
-        output += mangle_symbol(context.symbol());
+        output += mangle_symbol(Interner::get(context.symbol()));
 
         return output;
     }
@@ -168,7 +181,7 @@ namespace warbler
 
         for (const auto& member : context.members())
         {
-            output += generate_c_struct_member(program, member.second);
+            output += generate_c_struct_member(program, member);
         }
 
         output += "\n};\n\n";
@@ -184,7 +197,7 @@ namespace warbler
 
         output += generate_c_type_annotation(parameter.type(), program);
         output += ' ';
-        output += parameter.name();
+        output += Interner::get(parameter.name());
 
         return output;
     }
@@ -201,7 +214,7 @@ namespace warbler
             : "void";
 
         output += ' ';
-        output += mangle_symbol(function.name());
+        output += mangle_symbol(Interner::get(function.name()));
         output += '(';
 
         bool is_first = true;
@@ -265,7 +278,7 @@ namespace warbler
 
         output += generate_c_type_annotation(variable.type(), program);
         output += ' ';
-        output += variable.name();
+        output += Interner::get(variable.name());
 
         return output;
     }
@@ -1,5 +1,7 @@
 #include <warbler/context.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 
 namespace warbler
@@ -49,6 +51,68 @@ namespace warbler
 
 	usize primitive_count = sizeof(primitives) / sizeof(*primitives);
 
+	static u64 align_offset(u64 offset, u32 alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	StructContext::StructContext(u32 symbol, usize member_count) :
+	_symbol(symbol),
+	_end(0),
+	_layout { 0, 1 }
+	{
+		_members.reserve(member_count);
+	}
+
+	MemberAddition StructContext::add_member(MemberContext&& member)
+	{
+		if (find_member(member.name()) != nullptr)
+			return MemberAddition::AlreadyDeclared;
+
+		auto offset = align_offset(_end, member.alignment());
+		auto end = offset + member.size();
+		auto alignment = std::max(_layout.alignment, member.alignment());
+		// the size is a multiple of the alignment so that the struct can be put in an array
+		auto size = align_offset(end, alignment);
+
+		if (size > UINT32_MAX)
+			return MemberAddition::TooLarge;
+
+		member._offset = static_cast<u32>(offset);
+		_end = static_cast<u32>(end);
+		_layout = TypeLayout { static_cast<u32>(size), alignment };
+		_members.emplace_back(std::move(member));
+
+		if (_members.size() > max_unindexed_member_count)
+		{
+			// indexing every member once the struct gets too large to search member by member
+			for (auto i = _member_indices.size(); i < _members.size(); ++i)
+				_member_indices.emplace(_members[i].name(), static_cast<u32>(i));
+		}
+
+		return MemberAddition::Added;
+	}
+
+	const MemberContext *StructContext::find_member(u32 name) const
+	{
+		if (_members.size() <= max_unindexed_member_count)
+		{
+			for (const auto& member : _members)
+			{
+				if (member.name() == name)
+					return &member;
+			}
+
+			return nullptr;
+		}
+
+		auto iter = _member_indices.find(name);
+
+		return iter != _member_indices.end()
+			? &_members[iter->second]
+			: nullptr;
+	}
+
 	ConstantContext::ConstantContext(char character) :
 	_character(character),
 	_type(ConstantType::Character)
@@ -159,7 +223,7 @@ namespace warbler
 	{}
 
 	ExpressionContext::ExpressionContext(ExpressionContext&& other) :
-	_type(ExpressionType::Constant)
+	_type(other._type)
 	{
 		switch (_type)
 		{
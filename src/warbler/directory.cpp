@@ -1,18 +1,37 @@
 #include <warbler/directory.hpp>
 
+#include <chrono>
 #include <filesystem>
 #include <cstring>
 #include <warbler/util/print.hpp>
+#include <warbler/util/optional.hpp>
+#include <warbler/util/parallel.hpp>
 
 namespace warbler
 {
+    struct SourcePath
+    {
+        String path;
+        usize directory_index;
+    };
+
     Directory::Directory(const String& path) :
     _path(path)
     {}
 
-    Result<Array<Directory>> Directory::read(const String& path)
+    static bool is_source_file(const String& path)
     {
-        Array<Directory> directories;
+        // at least length of extension + 1 letter e.g. a.wbl
+        if (path.size() < 5)
+            return false;
+
+        return !strcmp(&path[path.size() - 4], ".wbl");
+    }
+
+    // a directory is listed before its subdirectories, which are listed in the order they are found
+    static void discover_files(const String& path, Array<Directory>& directories, Array<SourcePath>& files)
+    {
+        auto directory_index = directories.size();
 
         directories.emplace_back(path);
 
@@ -22,43 +41,67 @@ namespace warbler
 
             if (entry.is_regular_file())
             {
-                if (entrypath.size() >= 5) // at least length of extension + 1 letter e.g. a.wbl
-                {
-                    const char *file_extension = &entrypath[entrypath.size() - 4];
+                if (is_source_file(entrypath))
+                    files.push_back({ entrypath, directory_index });
+            }
+            else if (entry.is_directory())
+            {
+                discover_files(entrypath, directories, files);
+            }
+        }
+    }
+
+    static f64 get_seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    }
 
-                    if (strcmp(file_extension, ".wbl"))
-                        continue;
+    Result<Array<Directory>> Directory::read(const String& path, usize worker_count, DirectoryReadTimes *times)
+    {
+        auto discovery_start = std::chrono::steady_clock::now();
 
-                    auto file = File::read(entrypath);
+        Array<Directory> directories;
+        Array<SourcePath> files;
 
-                    if (!file)
-                    {
-                        print_error("Not all directory items could be read.");
-                        return {};
-                    }
+        discover_files(path, directories, files);
 
-                    directories[0].add_file(file.unwrap());
-                }
-            }
-            else if (entry.is_directory())
-            {
-                auto res = read(entrypath);
+        auto discovery_seconds = get_seconds_since(discovery_start);
+        auto load_start = std::chrono::steady_clock::now();
 
-                if (!res)
-                {
-                    print_error("Not all directory items could be read.");
-                    return {};
-                }
+        // reading is mostly waiting on the file system, so the files are read concurrently and
+        // their diagnostics are printed in the order they were found in
+        Array<Optional<File>> loaded_files(files.size());
+        Array<String> diagnostics(files.size());
+
+        parallel_for(files.size(), [&](usize i)
+        {
+            DiagnosticCapture capture;
+            auto file = File::read(files[i].path);
 
-                auto subdirs = res.unwrap();
+            if (file)
+                loaded_files[i] = file.unwrap();
 
-                directories.reserve(directories.size() + subdirs.size());
+            diagnostics[i] = capture.text();
+        }, worker_count);
 
-                for (auto& dir : subdirs)
-                {
-                    directories.emplace_back(std::move(dir));
-                }
+        for (usize i = 0; i < files.size(); ++i)
+        {
+            print_captured(diagnostics[i]);
+
+            if (!loaded_files[i])
+            {
+                print_error("Not all directory items could be read.");
+                return {};
             }
+
+            directories[files[i].directory_index].add_file(std::move(*loaded_files[i]));
+        }
+
+        if (times != nullptr)
+        {
+            times->discovery_seconds = discovery_seconds;
+            times->load_seconds = get_seconds_since(load_start);
+            times->file_count = files.size();
         }
 
         return directories;
@@ -73,4 +116,4 @@ namespace warbler
 
         return dir;
     }
-}
\ No newline at end of file
+}
@@ -1,98 +1,115 @@
 #include <warbler/file.hpp>
 
 #include <warbler/util/file.hpp>
+#include <warbler/source_manager.hpp>
+#include <warbler/scanner.hpp>
 
+#include <algorithm>
 #include <cassert>
 
 namespace warbler
 {
-	File::File(String&& filename, String&& src, Array<usize>&& line_lengths) :
-	_filename(filename),
-	_src(src),
-	_line_lengths(line_lengths)
+	static Array<usize> get_line_starts(StringView src)
+	{
+		Array<usize> line_starts;
+		auto estimated_line_count = src.size() / 40 + 1;
+
+		line_starts.reserve(estimated_line_count);
+		line_starts.push_back(0);
+
+		find_new_lines(src.data(), src.data() + src.size(), line_starts);
+
+		// convert positions of new lines to the start of the line after them
+		for (usize i = 1; i < line_starts.size(); ++i)
+			line_starts[i] += 1;
+
+		return line_starts;
+	}
+
+	File::File(String&& filename, MappedFile&& mapping, String&& buffer) :
+	_filename(std::move(filename)),
+	_mapping(std::move(mapping)),
+	_buffer(std::move(buffer)),
+	_src(get_owned_text()),
+	_line_starts(get_line_starts(_src)),
+	_base(SourceManager::add_file(*this, _src.size())),
+	_is_registered(true)
 	{}
 
-	static Array<usize> get_line_lengths(const String& src)
+	File::File(File&& other) :
+	_filename(std::move(other._filename)),
+	_mapping(std::move(other._mapping)),
+	_buffer(std::move(other._buffer)),
+	// short strings are stored inline so the view has to be taken again after moving
+	_src(get_owned_text()),
+	_line_starts(std::move(other._line_starts)),
+	_base(other._base),
+	_is_registered(other._is_registered)
 	{
-		Array<usize> line_lengths;
-		auto estimated_line_count = src.size() / 80 + 1;
-		usize last_start_of_line = 0;
+		other._src = StringView();
+		other._is_registered = false;
 
-		line_lengths.reserve(estimated_line_count);
+		if (_is_registered)
+			SourceManager::move_file(_base, *this);
+	}
 
-		for (usize i = 0; i < src.size(); ++i)
-		{
-			if (src[i] == '\n')
-			{
-				auto line_length = i - last_start_of_line + 1;
+	File::~File()
+	{
+		if (_is_registered)
+			SourceManager::remove_file(_base);
+	}
 
-				line_lengths.push_back(line_length);
-				last_start_of_line = i + 1;
-			}
-		}
+	StringView File::get_owned_text() const
+	{
+		if (_mapping.is_mapped())
+			return StringView(_mapping.data(), _mapping.size());
 
-		return line_lengths;
+		return StringView(_buffer);
 	}
 
 	Result<File> File::read(const String& filepath)
 	{
+		auto mapping = MappedFile::map(filepath);
+
+		if (mapping)
+			return File(String(filepath), mapping.unwrap(), String());
+
+		// mapping is not possible for every kind of file so fall back to reading it into memory
 		auto res = read_file(filepath);
 
 		if (!res)
 			return {};
 
-		String src(res.unwrap());
-		auto line_lengths = get_line_lengths(src);
-
-		return File(String(filepath), std::move(src), std::move(line_lengths));
+		return File(String(filepath), MappedFile(), res.unwrap());
 	}
 
 	File File::from(const char *name, const char *text)
 	{
 		assert(name != nullptr);
 		assert(text != nullptr);
-		
-		String source(text);
-		auto line_lengths = get_line_lengths(source);
 
-		return File(String(name), std::move(source), std::move(line_lengths));
+		return File(String(name), MappedFile(), String(text));
 	}
 
 	usize File::get_line(usize pos) const
 	{
-		usize line = 0;
-
-		for (const auto& length : _line_lengths)
-		{
-			if (pos >= length)
-			{
-				line += 1;
-				pos -= length;
-			}
-		}
-
-		return line;
+		assert(pos <= _src.size());
+
+		// first line start after pos, the line before it contains pos
+		auto iter = std::upper_bound(_line_starts.begin(), _line_starts.end(), pos);
+
+		return (iter - _line_starts.begin()) - 1;
 	}
 	
-	usize File::get_col(const usize start_pos) const
+	usize File::get_col(usize pos) const
 	{
-		usize pos = start_pos;
-
-		while (true)
-		{
-			if (pos == 0 || _src[pos - 1] == '\n')
-				break;
-
-			pos -= 1;
-		}
-
-		return start_pos - pos;
+		return pos - _line_starts[get_line(pos)];
 	}
 
 	String File::get_text(usize pos, usize length) const
 	{		
-		assert(pos + length < _src.size());
+		assert(pos + length <= _src.size());
 
-		return String(&_src[pos], length);
+		return String(_src.substr(pos, length));
 	}
 }
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include <warbler/interner.hpp>
+
+#include <warbler/util/array.hpp>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+
+namespace warbler
+{
+	// identifiers are spread over shards by hash so threads lexing different files
+	// rarely wait on each other
+	struct InternShard
+	{
+		std::shared_mutex mutex;
+		Array<InternSlot> slots;
+		usize count = 0;
+		// text is copied into large blocks instead of individual strings to keep the
+		// per-identifier overhead low
+		Array<std::unique_ptr<char[]>> blocks;
+		usize block_used = 0;
+		usize block_size = 0;
+	};
+
+	static const usize shard_count = 16;
+	static const usize initial_slot_count = 1024;
+	static const usize text_block_size = 64 * 1024;
+	static const usize initial_cache_slot_count = 256;
+	// files with more distinct identifiers than fit are rare, the rest of them are found in
+	// the shards instead
+	static const usize max_cache_slot_count = 64 * 1024;
+
+	static InternShard shards[shard_count];
+	static Array<StringView> texts = { StringView() };
+	static std::shared_mutex texts_mutex;
+
+	static u64 mix_hash(u64 hash, u64 word)
+	{
+		hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+
+		return hash ^ (hash >> 32);
+	}
+
+	static u64 load_word(const char *data)
+	{
+		u64 word;
+
+		std::memcpy(&word, data, sizeof(word));
+
+		return word;
+	}
+
+	static u32 get_hash(StringView text)
+	{
+		// hashing a word at a time as most identifiers fit in one or two words
+		const auto *data = text.data();
+		auto size = text.size();
+		u64 hash = size * 0x9e3779b97f4a7c15ull;
+		u64 tail = 0;
+
+		if (size >= sizeof(u64))
+		{
+			for (usize i = 0; i + sizeof(u64) < size; i += sizeof(u64))
+				hash = mix_hash(hash, load_word(data + i));
+
+			// the last word overlaps the previous one instead of reading past the end
+			tail = load_word(data + size - sizeof(u64));
+		}
+		else
+		{
+			for (usize i = 0; i < size; ++i)
+				tail |= static_cast<u64>(static_cast<u8>(data[i])) << (i * 8);
+		}
+
+		hash = mix_hash(hash, tail);
+		hash = mix_hash(hash, hash >> 29);
+
+		return static_cast<u32>(hash);
+	}
+
+	static InternShard& get_shard(u32 hash)
+	{
+		// the low bits pick the slot within the shard
+		return shards[hash >> 28];
+	}
+
+	static const InternSlot *find_slot(const InternShard& shard, StringView text, u32 hash)
+	{
+		if (shard.slots.empty())
+			return nullptr;
+
+		auto mask = shard.slots.size() - 1;
+
+		for (auto i = hash & mask; ; i = (i + 1) & mask)
+		{
+			const auto& slot = shard.slots[i];
+
+			if (slot.data == nullptr)
+				return nullptr;
+
+			if (slot.hash == hash && slot.length == text.size() && !std::memcmp(slot.data, text.data(), text.size()))
+				return &slot;
+		}
+	}
+
+	static void insert_slot(Array<InternSlot>& slots, const InternSlot& slot)
+	{
+		auto mask = slots.size() - 1;
+		auto i = slot.hash & mask;
+
+		while (slots[i].data != nullptr)
+			i = (i + 1) & mask;
+
+		slots[i] = slot;
+	}
+
+	static void grow_slots(InternShard& shard)
+	{
+		auto slot_count = shard.slots.empty()
+			? initial_slot_count
+			: shard.slots.size() * 2;
+
+		Array<InternSlot> slots(slot_count, InternSlot { nullptr, 0, 0, 0 });
+
+		for (const auto& slot : shard.slots)
+		{
+			if (slot.data != nullptr)
+				insert_slot(slots, slot);
+		}
+
+		shard.slots = std::move(slots);
+	}
+
+	static const char *store_text(InternShard& shard, StringView text)
+	{
+		if (shard.block_used + text.size() > shard.block_size)
+		{
+			// identifiers longer than a block get a block to themselves
+			shard.block_size = text.size() > text_block_size
+				? text.size()
+				: text_block_size;
+			shard.blocks.emplace_back(new char[shard.block_size]);
+			shard.block_used = 0;
+		}
+
+		auto *data = shard.blocks.back().get() + shard.block_used;
+
+		std::memcpy(data, text.data(), text.size());
+		shard.block_used += text.size();
+
+		return data;
+	}
+
+	static u32 add_text(StringView text)
+	{
+		std::unique_lock lock(texts_mutex);
+
+		if (texts.size() > UINT32_MAX)
+			throw std::runtime_error("Number of distinct identifiers exceeds the maximum of 4294967296.");
+
+		auto atom = static_cast<u32>(texts.size());
+
+		texts.push_back(text);
+
+		return atom;
+	}
+
+	static u32 intern_hashed(StringView text, u32 hash, InternSlot& interned)
+	{
+		auto& shard = get_shard(hash);
+
+		{
+			std::shared_lock lock(shard.mutex);
+
+			auto *slot = find_slot(shard, text, hash);
+
+			if (slot != nullptr)
+			{
+				interned = *slot;
+				return slot->atom;
+			}
+		}
+
+		std::unique_lock lock(shard.mutex);
+
+		// another thread may have interned the text while the lock was released
+		auto *slot = find_slot(shard, text, hash);
+
+		if (slot != nullptr)
+		{
+			interned = *slot;
+			return slot->atom;
+		}
+
+		// keeping at most half of the slots full keeps probe sequences short
+		if ((shard.count + 1) * 2 > shard.slots.size())
+			grow_slots(shard);
+
+		auto *data = store_text(shard, text);
+		auto atom = add_text(StringView(data, text.size()));
+
+		interned = { data, static_cast<u32>(text.size()), hash, atom };
+		insert_slot(shard.slots, interned);
+		shard.count += 1;
+
+		return atom;
+	}
+
+	static void check_length(StringView text)
+	{
+		if (text.size() > UINT32_MAX)
+			throw std::runtime_error("Identifiers may not be longer than 4294967295 characters.");
+	}
+
+	u32 Interner::intern(StringView text)
+	{
+		if (text.empty())
+			return 0;
+
+		check_length(text);
+
+		InternSlot interned;
+
+		return intern_hashed(text, get_hash(text), interned);
+	}
+
+	u32 InternCache::intern(StringView text)
+	{
+		if (text.empty())
+			return 0;
+
+		check_length(text);
+
+		auto hash = get_hash(text);
+
+		if (!_slots.empty())
+		{
+			auto mask = _slots.size() - 1;
+
+			for (auto i = hash & mask; _slots[i].data != nullptr; i = (i + 1) & mask)
+			{
+				const auto& slot = _slots[i];
+
+				if (slot.hash == hash && slot.length == text.size() && !std::memcmp(slot.data, text.data(), text.size()))
+					return slot.atom;
+			}
+		}
+
+		// atoms never change once assigned, so only the first time an identifier is seen
+		// does the interner have to be locked
+		InternSlot interned;
+		auto atom = intern_hashed(text, hash, interned);
+
+		// probing is on the path of every identifier lexed, so the cache is kept at most a
+		// quarter full
+		if ((_count + 1) * 4 > _slots.size())
+		{
+			if (_slots.size() == max_cache_slot_count)
+				return atom;
+
+			auto slot_count = _slots.empty()
+				? initial_cache_slot_count
+				: _slots.size() * 2;
+
+			Array<InternSlot> slots(slot_count, InternSlot { nullptr, 0, 0, 0 });
+
+			for (const auto& slot : _slots)
+			{
+				if (slot.data != nullptr)
+					insert_slot(slots, slot);
+			}
+
+			_slots = std::move(slots);
+		}
+
+		insert_slot(_slots, interned);
+		_count += 1;
+
+		return atom;
+	}
+
+	u32 Interner::find(StringView text)
+	{
+		if (text.empty())
+			return 0;
+
+		auto hash = get_hash(text);
+		auto& shard = get_shard(hash);
+
+		std::shared_lock lock(shard.mutex);
+
+		auto *slot = find_slot(shard, text, hash);
+
+		return slot != nullptr
+			? slot->atom
+			: 0;
+	}
+
+	StringView Interner::get(u32 atom)
+	{
+		std::shared_lock lock(texts_mutex);
+
+		assert(atom < texts.size());
+
+		return texts[atom];
+	}
+
+	usize Interner::size()
+	{
+		std::shared_lock lock(texts_mutex);
+
+		return texts.size();
+	}
+}
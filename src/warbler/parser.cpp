@@ -1,187 +1,244 @@
 #include <warbler/parser.hpp>
 
 #include <warbler/util/print.hpp>
+#include <warbler/util/parallel.hpp>
 #include <warbler/directory.hpp>
+#include <warbler/syntax_cache.hpp>
+#include <warbler/source_manager.hpp>
+#include <algorithm>
+#include <array>
 #include <cassert>
 
 namespace warbler
 {
-	Result<ExpressionSyntax> parse_additive_expression(Token& token)
+	// Binary operators from loosest to tightest binding. Operators on the same level are
+	// collected into a single node with a list of right hand sides.
+	enum class BinaryLevel : u8
 	{
-		auto lhs = parse_multiplicative_expression(token);
+		None,
+		BooleanOr,
+		BooleanAnd,
+		BitwiseOr,
+		BitwiseXor,
+		BitwiseAnd,
+		Equality,
+		Relational,
+		BitShift,
+		Additive,
+		Multiplicative,
+		Prefix
+	};
+
+	struct BinaryOperator
+	{
+		BinaryLevel level;
+		u8 type;
+	};
 
-		if (!lhs)
-			return {};
+	template <typename Type>
+	static constexpr BinaryOperator make_operator(BinaryLevel level, Type type)
+	{
+		return { level, static_cast<u8>(type) };
+	}
 
-		Array<AdditiveRhsSyntax> RhsSyntax;
+	static constexpr auto get_binary_operators()
+	{
+		std::array<BinaryOperator, 256> operators = {};
 
-		while (true)
+		auto set = [&](TokenType token_type, BinaryOperator op)
 		{
-			AdditiveType type;
-			if (token.type() == TokenType::Plus)
-			{
-				type = AdditiveType::Add;
-			}
-			else if (token.type() == TokenType::Minus)
-			{
-				type = AdditiveType::Add;
-			}
-			else
-			{
-				break;
-			}
-
-			token.increment();
+			operators[static_cast<u8>(token_type)] = op;
+		};
+
+		set(TokenType::BooleanOr, make_operator(BinaryLevel::BooleanOr, 0));
+		set(TokenType::BooleanAnd, make_operator(BinaryLevel::BooleanAnd, 0));
+		set(TokenType::Pipeline, make_operator(BinaryLevel::BitwiseOr, 0));
+		set(TokenType::Carrot, make_operator(BinaryLevel::BitwiseXor, 0));
+		set(TokenType::Ampersand, make_operator(BinaryLevel::BitwiseAnd, 0));
+		set(TokenType::Equals, make_operator(BinaryLevel::Equality, EqualityType::Equals));
+		set(TokenType::NotEquals, make_operator(BinaryLevel::Equality, EqualityType::NotEquals));
+		set(TokenType::GreaterThan, make_operator(BinaryLevel::Relational, RelationalType::GreaterThan));
+		set(TokenType::LessThan, make_operator(BinaryLevel::Relational, RelationalType::LessThan));
+		set(TokenType::GreaterThanOrEqualTo, make_operator(BinaryLevel::Relational, RelationalType::GreaterThanOrEqualTo));
+		set(TokenType::LessThanOrEqualTo, make_operator(BinaryLevel::Relational, RelationalType::LessThanOrEqualTo));
+		set(TokenType::LeftBitShift, make_operator(BinaryLevel::BitShift, BitShiftType::Left));
+		set(TokenType::RightBitShift, make_operator(BinaryLevel::BitShift, BitShiftType::Right));
+		set(TokenType::Plus, make_operator(BinaryLevel::Additive, AdditiveType::Add));
+		set(TokenType::Minus, make_operator(BinaryLevel::Additive, AdditiveType::Add));
+		set(TokenType::Modulus, make_operator(BinaryLevel::Multiplicative, MultiplicativeType::Modulus));
+		set(TokenType::Asterisk, make_operator(BinaryLevel::Multiplicative, MultiplicativeType::Multiply));
+		set(TokenType::Slash, make_operator(BinaryLevel::Multiplicative, MultiplicativeType::Divide));
+
+		return operators;
+	}
 
-			auto res = parse_multiplicative_expression(token);
+	static constexpr auto binary_operators = get_binary_operators();
 
-			if (!res)
-				return {};
+	static const BinaryOperator& get_binary_operator(TokenType type)
+	{
+		return binary_operators[static_cast<u8>(type)];
+	}
 
-			RhsSyntax.emplace_back(AdditiveRhsSyntax { res.unwrap(), type });
-		}
+	static BinaryLevel get_next_level(BinaryLevel level)
+	{
+		return static_cast<BinaryLevel>(static_cast<u8>(level) + 1);
+	}
 
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
+	static Result<ExpressionSyntax> parse_binary_expression(TokenIterator& token, BinaryLevel min_level);
 
-		return ExpressionSyntax(AdditiveExpressionSyntax {lhs.unwrap(), std::move(RhsSyntax) });
+	static void push_operand(SyntaxListBuilder<ExpressionSyntax>& rhs, ExpressionSyntax&& expression, u8)
+	{
+		rhs.push_back(std::move(expression));
 	}
 
-	Result<ExpressionSyntax> parse_bitwise_and_expression(Token& token)
+	template <typename Rhs>
+	static void push_operand(SyntaxListBuilder<Rhs>& rhs, ExpressionSyntax&& expression, u8 type)
 	{
-		auto lhs = parse_equality_expression(token);
-
-		if (!lhs)
-			return {};
+		rhs.emplace_back(std::move(expression), static_cast<decltype(Rhs::type)>(type));
+	}
 
-		Array<ExpressionSyntax> RhsSyntax;
+	template <typename Node, typename Rhs>
+	static Result<ExpressionSyntax> parse_operands(TokenIterator& token, ExpressionSyntax&& lhs, BinaryLevel level)
+	{
+		SyntaxListBuilder<Rhs> rhs;
 
-		while (token.type() == TokenType::Ampersand)
+		do
 		{
+			auto type = get_binary_operator(token.type()).type;
+
 			token.increment();
 
-			auto res = parse_equality_expression(token);
+			// operands only contain operators that bind tighter than this level
+			auto res = parse_binary_expression(token, get_next_level(level));
 
 			if (!res)
 				return {};
 
-			RhsSyntax.emplace_back(res.unwrap());
+			push_operand(rhs, res.unwrap(), type);
 		}
+		while (get_binary_operator(token.type()).level == level);
 
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
-
-		return ExpressionSyntax(BitwiseAndExpressionSyntax(lhs.unwrap(), std::move(RhsSyntax)));
+		return ExpressionSyntax(Node(std::move(lhs), rhs.finish()));
 	}
 
-	Result<ExpressionSyntax> parse_bitwise_or_expression(Token& token)
+	static Result<ExpressionSyntax> parse_level_operands(TokenIterator& token, ExpressionSyntax&& lhs, BinaryLevel level)
 	{
-		auto lhs = parse_bitwise_xor_expression(token);
-
-		if (!lhs)
-			return {};
-
-		Array<ExpressionSyntax> RhsSyntax;
-
-		while (token.type() == TokenType::Pipeline)
+		switch (level)
 		{
-			token.increment();
-			auto res = parse_bitwise_xor_expression(token);
-			
-			if (!res)
-				return {};
+			case BinaryLevel::BooleanOr:
+				return parse_operands<BooleanOrExpressionSyntax, ExpressionSyntax>(token, std::move(lhs), level);
 
-			RhsSyntax.emplace_back(res.unwrap());
-		}
-
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
+			case BinaryLevel::BooleanAnd:
+				return parse_operands<BooleanAndExpressionSyntax, ExpressionSyntax>(token, std::move(lhs), level);
 
-		return ExpressionSyntax(BitwiseOrExpressionSyntax(lhs.unwrap(), std::move(RhsSyntax)));
-	}
+			case BinaryLevel::BitwiseOr:
+				return parse_operands<BitwiseOrExpressionSyntax, ExpressionSyntax>(token, std::move(lhs), level);
 
-	Result<ExpressionSyntax> parse_bitwise_xor_expression(Token& token)
-	{
-		auto lhs = parse_bitwise_and_expression(token);
+			case BinaryLevel::BitwiseXor:
+				return parse_operands<BitwiseXorExpressionSyntax, ExpressionSyntax>(token, std::move(lhs), level);
 
-		if (!lhs)
-			return {};
+			case BinaryLevel::BitwiseAnd:
+				return parse_operands<BitwiseAndExpressionSyntax, ExpressionSyntax>(token, std::move(lhs), level);
 
-		Array<ExpressionSyntax> RhsSyntax;
+			case BinaryLevel::Equality:
+				return parse_operands<EqualityExpressionSyntax, EqualityRhsSyntax>(token, std::move(lhs), level);
 
-		while (token.type() == TokenType::Carrot)
-		{
-			token.increment();
+			case BinaryLevel::Relational:
+				return parse_operands<RelationalExpressionSyntax, RelationalRhsSyntax>(token, std::move(lhs), level);
 
-			auto res = parse_bitwise_and_expression(token);
-			
-			if (!res)
-				return {};
+			case BinaryLevel::BitShift:
+				return parse_operands<BitShiftExpressionSyntax, BitShiftRhsSyntax>(token, std::move(lhs), level);
 
-			RhsSyntax.emplace_back(res.unwrap());
-		}
+			case BinaryLevel::Additive:
+				return parse_operands<AdditiveExpressionSyntax, AdditiveRhsSyntax>(token, std::move(lhs), level);
 
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
+			case BinaryLevel::Multiplicative:
+				return parse_operands<MultiplicativeExpressionSyntax, MultiplicativeRhsSyntax>(token, std::move(lhs), level);
 
-		return ExpressionSyntax(BitwiseXorExpressionSyntax(lhs.unwrap(), std::move(RhsSyntax)));
+			default:
+				throw std::runtime_error("Invalid binary operator level");
+		}
 	}
 
-	Result<ExpressionSyntax> parse_boolean_and_expression(Token& token)
+	// Precedence climbing over the operator table. Nodes are only created for levels that have
+	// an operator, so a lone operand goes straight to the prefix parser instead of descending
+	// through every level.
+	static Result<ExpressionSyntax> parse_binary_expression(TokenIterator& token, BinaryLevel min_level)
 	{
-		auto lhs = parse_bitwise_or_expression(token);
+		auto lhs = parse_prefix_expression(token);
 
 		if (!lhs)
 			return {};
 
-		Array<ExpressionSyntax> RhsSyntax;
+		auto expression = lhs.unwrap();
 
-		while (token.type() == TokenType::BooleanAnd)
+		while (true)
 		{
-			token.increment();
+			auto level = get_binary_operator(token.type()).level;
 
-			auto res = parse_bitwise_or_expression(token);
+			if (level == BinaryLevel::None || level < min_level)
+				return expression;
+
+			auto res = parse_level_operands(token, std::move(expression), level);
 
 			if (!res)
 				return {};
 
-			RhsSyntax.emplace_back(res.unwrap());
+			expression = res.unwrap();
 		}
+	}
 
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
-
-		return ExpressionSyntax(BooleanAndExpressionSyntax(lhs.unwrap(), std::move(RhsSyntax)));
+	Result<ExpressionSyntax> parse_additive_expression(TokenIterator& token)
+	{
+		return parse_binary_expression(token, BinaryLevel::Additive);
 	}
 
-	Result<ExpressionSyntax> parse_boolean_or_expression(Token& token)
+	Result<ExpressionSyntax> parse_bitwise_and_expression(TokenIterator& token)
 	{
-		auto lhs = parse_boolean_and_expression(token);
+		return parse_binary_expression(token, BinaryLevel::BitwiseAnd);
+	}
 
-		if (!lhs)
-			return {};
+	Result<ExpressionSyntax> parse_bitwise_or_expression(TokenIterator& token)
+	{
+		return parse_binary_expression(token, BinaryLevel::BitwiseOr);
+	}
 
-		Array<ExpressionSyntax> RhsSyntax;
+	Result<ExpressionSyntax> parse_bitwise_xor_expression(TokenIterator& token)
+	{
+		return parse_binary_expression(token, BinaryLevel::BitwiseXor);
+	}
 
-		while (token.type() == TokenType::BooleanOr)
-		{
-			token.increment();
+	Result<ExpressionSyntax> parse_boolean_and_expression(TokenIterator& token)
+	{
+		return parse_binary_expression(token, BinaryLevel::BooleanAnd);
+	}
 
-			auto res = parse_boolean_and_expression(token);
+	Result<ExpressionSyntax> parse_boolean_or_expression(TokenIterator& token)
+	{
+		return parse_binary_expression(token, BinaryLevel::BooleanOr);
+	}
 
-			if (!res)
-				return {};
+	Result<ExpressionSyntax> parse_equality_expression(TokenIterator& token)
+	{
+		return parse_binary_expression(token, BinaryLevel::Equality);
+	}
 
-			RhsSyntax.emplace_back(res.unwrap());
-		}
+	Result<ExpressionSyntax> parse_relational_expression(TokenIterator& token)
+	{
+		return parse_binary_expression(token, BinaryLevel::Relational);
+	}
 
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
+	Result<ExpressionSyntax> parse_bit_shift_expression(TokenIterator& token)
+	{
+		return parse_binary_expression(token, BinaryLevel::BitShift);
+	}
 
-		return ExpressionSyntax(BooleanOrExpressionSyntax(lhs.unwrap(), std::move(RhsSyntax)));
+	Result<ExpressionSyntax> parse_multiplicative_expression(TokenIterator& token)
+	{
+		return parse_binary_expression(token, BinaryLevel::Multiplicative);
 	}
 
-	Result<ExpressionSyntax> parse_conditional_expression(Token& token)
+	Result<ExpressionSyntax> parse_conditional_expression(TokenIterator& token)
 	{
 		auto lhs = parse_boolean_or_expression(token);
 
@@ -200,7 +257,7 @@ namespace warbler
 
 		if (token.type() != TokenType::KeywordElse)
 		{
-			print_parse_error(token, "'else' or false case");
+			print_parse_error(*token, "'else' or false case");
 			return {};
 		}
 
@@ -214,112 +271,11 @@ namespace warbler
 		return ExpressionSyntax(ConditionalExpressionSyntax(lhs.unwrap(), true_case.unwrap(), false_case.unwrap()));
 	}
 
-	Result<ExpressionSyntax> parse_equality_expression(Token& token)
-	{
-		auto lhs = parse_relational_expression(token);
-		 
-		if (!lhs)
-			return {};
-
-		Array<EqualityRhsSyntax> RhsSyntax;
-
-		while (true)
-		{
-			bool should_break = false;
-
-			EqualityType type;
-			switch (token.type())
-			{
-				case TokenType::Equals:
-					type = EqualityType::Equals;
-					break;
-
-				case TokenType::NotEquals:
-					type = EqualityType::NotEquals;
-					break;
-
-				default:
-					should_break = true;
-					break;
-			}
-
-			if (should_break)
-				break;
-
-			token.increment();
-
-			auto res = parse_relational_expression(token);
-
-			if (!res)
-				return {};
-
-			RhsSyntax.emplace_back(EqualityRhsSyntax { res.unwrap(), type });
-		}
-
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
-
-		return ExpressionSyntax(EqualityExpressionSyntax(lhs.unwrap(), std::move(RhsSyntax)));
-	}
-
-
-	Result<ExpressionSyntax> parse_multiplicative_expression(Token& token)
-	{
-		auto lhs = parse_prefix_expression(token);
-
-		if (!lhs)
-			return {};
-
-		Array<MultiplicativeRhsSyntax> RhsSyntax;
-
-		while (true)
-		{
-			bool should_break = false;
-
-			MultiplicativeType type;
-			switch (token.type())
-			{
-				case TokenType::Modulus:
-					type = MultiplicativeType::Modulus;
-					break;
-
-				case TokenType::Asterisk:
-					type = MultiplicativeType::Multiply;
-					break;
-
-				case TokenType::Slash:
-					type = MultiplicativeType::Divide;
-					break;
-
-				default:
-					should_break = true;
-					break;
-			}
-
-			if (should_break)
-				break;
-
-			token.increment();
-
-			auto res = parse_prefix_expression(token);
-
-			if (!res)
-				return {};
-
-			RhsSyntax.emplace_back(MultiplicativeRhsSyntax { res.unwrap(), type });
-		}
-
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
-
-		return ExpressionSyntax(MultiplicativeExpressionSyntax(lhs.unwrap(), std::move(RhsSyntax)));
-	}
-
-	Result<Array<ExpressionSyntax>> parse_arguments(Token& token)
+	Result<SyntaxList<ExpressionSyntax>> parse_arguments(TokenIterator& token)
 	{
 		token.increment();
 
-		Array<ExpressionSyntax> arguments;
+		SyntaxListBuilder<ExpressionSyntax> arguments;
 
 	parse_argument:
 
@@ -342,17 +298,17 @@ namespace warbler
 
 			if (token.type() != TokenType::RightParenthesis)
 			{
-				print_parse_error(token, "')' after function arguments");
+				print_parse_error(*token, "')' after function arguments");
 				return {};
 			}
 		}
 
 		token.increment();
 
-		return arguments;
+		return arguments.finish();
 	}
 
-	Result<ExpressionSyntax> parse_postfix_expression(Token& token)
+	Result<ExpressionSyntax> parse_postfix_expression(TokenIterator& token)
 	{
 		auto primary_expression = parse_primary_expression(token);
 
@@ -376,7 +332,7 @@ namespace warbler
 
 				if (token.type() != TokenType::RightBracket)
 				{
-					print_parse_error(token, "']' after index operation");
+					print_parse_error(*token, "']' after index operation");
 					return {};
 				}
 
@@ -405,11 +361,11 @@ namespace warbler
 			
 				if (token.type() != TokenType::Identifier)
 				{
-					print_parse_error(token, "member, method, or property name");
+					print_parse_error(*token, "member, method, or property name");
 					return {};
 				}
 
-				auto name = token;
+				auto name = *token;
 
 				token.increment();
 				
@@ -424,7 +380,7 @@ namespace warbler
 		return expression;
 	}
 
-	Result<ExpressionSyntax> parse_prefix_expression(Token& token)
+	Result<ExpressionSyntax> parse_prefix_expression(TokenIterator& token)
 	{
 		PrefixType type;
 
@@ -458,7 +414,7 @@ namespace warbler
 				return parse_postfix_expression(token);
 		}
 
-		auto prefix = token;
+		auto prefix = *token;
 
 		token.increment();
 
@@ -470,7 +426,7 @@ namespace warbler
 		return ExpressionSyntax { PrefixExpressionSyntax(prefix, res.unwrap(), type) };
 	}
 
-	Result<ExpressionSyntax> parse_primary_expression(Token& token)
+	Result<ExpressionSyntax> parse_primary_expression(TokenIterator& token)
 	{
 		if (token.type() == TokenType::Identifier)
 		{
@@ -492,7 +448,7 @@ namespace warbler
 
 			if (token.type() != TokenType::RightParenthesis)
 			{
-				print_parse_error(token, "expected ')' after primary sub-expression");
+				print_parse_error(*token, "expected ')' after primary sub-expression");
 				return {};
 			}
 
@@ -511,111 +467,7 @@ namespace warbler
 		}
 	}
 
-	Result<ExpressionSyntax> parse_relational_expression(Token& token)
-	{
-		auto lhs = parse_bit_shift_expression(token);
-
-		if (!lhs)
-			return {};
-
-		Array<RelationalRhsSyntax> RhsSyntax;
-
-		while (true)
-		{
-			bool should_break = false;
-
-			RelationalType type;
-			switch (token.type())
-			{
-				case TokenType::GreaterThan:
-					type = RelationalType::GreaterThan;
-					break;
-
-				case TokenType::LessThan:
-					type = RelationalType::LessThan;
-					break;
-
-				case TokenType::GreaterThanOrEqualTo:
-					type = RelationalType::GreaterThanOrEqualTo;
-					break;
-
-				case TokenType::LessThanOrEqualTo:
-					type = RelationalType::LessThanOrEqualTo;
-					break;
-
-				default:
-					should_break = true;
-					break;
-			}
-
-			if (should_break)
-				break;
-
-			token.increment();
-
-			auto res = parse_bit_shift_expression(token);
-
-			if (!res)
-				return {};
-
-			RhsSyntax.emplace_back(RelationalRhsSyntax { res.unwrap(), type });
-		}
-
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
-
-		return ExpressionSyntax(RelationalExpressionSyntax(lhs.unwrap(), std::move(RhsSyntax)));
-	}
-
-	Result<ExpressionSyntax> parse_bit_shift_expression(Token& token)
-	{
-		auto lhs = parse_additive_expression(token);
-
-		if (!lhs)
-			return {};
-
-		Array<BitShiftRhsSyntax> RhsSyntax;
-
-		while (true)
-		{
-			bool should_break = false;
-			BitShiftType type;
-
-			switch (token.type())
-			{
-				case TokenType::LeftBitShift:
-					type = BitShiftType::Left;
-					break;
-
-				case TokenType::RightBitShift:
-					type = BitShiftType::Right;
-					break;
-
-				default:
-					should_break = true;
-					break;
-			}
-
-			if (should_break)
-				break;
-			
-			token.increment();
-
-			auto res = parse_additive_expression(token);
-
-			if (!res)
-				return {};
-
-			RhsSyntax.emplace_back(BitShiftRhsSyntax { res.unwrap(), type });
-		}
-		
-		if (RhsSyntax.empty())
-			return lhs.unwrap();
-
-		return ExpressionSyntax(BitShiftExpressionSyntax(lhs.unwrap(), std::move(RhsSyntax)));
-	}
-
-	Result<ExpressionSyntax> parse_assignment(Token& token)
+	Result<ExpressionSyntax> parse_assignment(TokenIterator& token)
 	{
 		auto lhs = parse_conditional_expression(token);
 
@@ -683,22 +535,23 @@ namespace warbler
 		return ExpressionSyntax(AssignmentSyntax(lhs.unwrap(), rhs.unwrap(), type));
 	}
 
-	static Result<ExpressionSyntax> parse_character(Token& token)
+	static Result<ExpressionSyntax> parse_character(TokenIterator& token)
 	{
 		if (token.length() != 3)
 		{
-			print_error(token, "character literals may only contain 1 character");
+			print_error(*token, "character literals may only contain 1 character");
 			return {};
 		}
 
 		auto character = token[1];
+		const auto t = *token;
 
 		token.increment();
 
-		return ExpressionSyntax(ConstantSyntax(token, character));
+		return ExpressionSyntax(ConstantSyntax(t, character));
 	}
 
-	static Result<ExpressionSyntax> parse_float(Token& token)
+	static Result<ExpressionSyntax> parse_float(TokenIterator& token)
 	{
 #pragma message "TODO: account for multiple decimals when parsing float"
 		f64 value = 0.0;
@@ -727,25 +580,24 @@ namespace warbler
 			}
 		}
 		
-		const auto t = token;
+		const auto t = *token;
 
 		token.increment();
 
 		return ExpressionSyntax(ConstantSyntax(t, value));
 	}
 
-	static ExpressionSyntax parse_string(Token& token)
+	static ExpressionSyntax parse_string(TokenIterator& token)
 	{
-		const auto t = token;
+		// the text of the literal is read from its token when needed
+		const auto t = *token;
 
 		token.increment();
 
-		auto text = token.file().get_text(token.pos() + 1, token.length() - 2);
-
-		return ConstantSyntax(t, std::move(text));
+		return ConstantSyntax(t);
 	}
 
-	static ExpressionSyntax parse_integer(Token& token)
+	static ExpressionSyntax parse_integer(TokenIterator& token)
 	{
 		#pragma message "TODO: handle potential for too many numbers in integer literal"
 
@@ -754,14 +606,14 @@ namespace warbler
 		for (size_t i = 0; i < token.length(); ++i)
 			value = value * 10 + (token[i] - '0');
 
-		const auto t = token;
+		const auto t = *token;
 
 		token.increment();
 
 		return ConstantSyntax(t, value);
 	}
 
-	Result<ExpressionSyntax> parse_constant(Token& token)
+	Result<ExpressionSyntax> parse_constant(TokenIterator& token)
 	{
 		switch (token.type())
 		{
@@ -785,14 +637,14 @@ namespace warbler
 
 			case TokenType::KeywordTrue:
 			{
-				const auto t = token;
+				const auto t = *token;
 				token.increment();
 				return ExpressionSyntax(ConstantSyntax(t, true));
 			}
 
 			case TokenType::KeywordFalse:
 			{
-				const auto t = token;
+				const auto t = *token;
 				token.increment();
 				return ExpressionSyntax(ConstantSyntax(t, false));
 			}
@@ -801,26 +653,68 @@ namespace warbler
 				break;
 		}
 
-		print_parse_error(token, "constant");
+		print_parse_error(*token, "constant");
 		return {};
 	}
 
-	Result<ExpressionSyntax> parse_symbol(Token& token)
+	Result<ExpressionSyntax> parse_symbol(TokenIterator& token)
 	{
 		if (token.type() != TokenType::Identifier)
 		{
-			print_parse_error(token, "symbol");
+			print_parse_error(*token, "symbol");
 			return {};
 		}
 
-		auto symbol = token;
+		auto symbol = *token;
 
 		token.increment();
 
 		return ExpressionSyntax(SymbolSyntax(symbol));
 	}
 
-	Result<FunctionSyntax> parse_function(Token& token)
+	// Finds the end of a block by matching braces without parsing what is in between, so only
+	// the tokens of the block are looked at.
+	static Result<SourceRange> skip_block(TokenIterator& token)
+	{
+		assert(token.type() == TokenType::LeftBrace);
+
+		auto location = (*token).location();
+		usize depth = 0;
+
+		while (true)
+		{
+			switch (token.type())
+			{
+				case TokenType::LeftBrace:
+					depth += 1;
+					break;
+
+				case TokenType::RightBrace:
+					depth -= 1;
+					break;
+
+				case TokenType::EndOfFile:
+					print_parse_error(*token, "'}' after block");
+					return {};
+
+				default:
+					break;
+			}
+
+			if (depth == 0)
+				break;
+
+			token.increment();
+		}
+
+		auto end_location = (*token).location() + 1;
+
+		token.increment();
+
+		return SourceRange { location, end_location - location };
+	}
+
+	Result<FunctionSyntax> parse_function(TokenIterator& token, bool skip_body)
 	{
 		assert(token.type() == TokenType::KeywordFunction);
 
@@ -828,11 +722,11 @@ namespace warbler
 
 		if (token.type() != TokenType::Identifier)
 		{
-			print_parse_error(token, "function name");
+			print_parse_error(*token, "function name");
 			return {};
 		}
 
-		auto name = token;
+		auto name = *token;
 
 		token.increment();
 
@@ -843,9 +737,19 @@ namespace warbler
 
 		if (token.type() != TokenType::LeftBrace)
 		{
-			print_parse_error(token, "'{' after function signature");
+			print_parse_error(*token, "'{' after function signature");
 			return {};
 		}
+
+		if (skip_body)
+		{
+			auto body_range = skip_block(token);
+
+			if (!body_range)
+				return {};
+
+			return FunctionSyntax(name, signature.unwrap(), body_range.unwrap(), SyntaxPool::current().id());
+		}
 	
 		auto body = parse_block_statement(token);
 
@@ -855,7 +759,7 @@ namespace warbler
 		return FunctionSyntax(name, signature.unwrap(), body.unwrap());
 	}
 
-	Result<ParameterSyntax> parse_parameter(Token& token)
+	Result<ParameterSyntax> parse_parameter(TokenIterator& token)
 	{
 		bool is_mutable = false;
 
@@ -867,17 +771,17 @@ namespace warbler
 
 		if (token.type() != TokenType::Identifier)
 		{
-			print_parse_error(token, "parameter name");
+			print_parse_error(*token, "parameter name");
 			return {};
 		}
 
-		auto name = token;
+		auto name = *token;
 
 		token.increment();
 
 		if (token.type() != TokenType::Colon)
 		{
-			print_parse_error(token, ":", "parameters require a valid type");
+			print_parse_error(*token, ":", "parameters require a valid type");
 			return {};
 		}
 
@@ -891,15 +795,15 @@ namespace warbler
 		return ParameterSyntax(name, type.unwrap(), is_mutable);
 	}
 
-	Result<Array<ParameterSyntax>> parse_parameter_list(Token& token)
+	Result<SyntaxList<ParameterSyntax>> parse_parameter_list(TokenIterator& token)
 	{
 		if (token.type() != TokenType::LeftParenthesis)
 		{
-			print_parse_error(token, "'(' after function name");
+			print_parse_error(*token, "'(' after function name");
 			return {};
 		}
 
-		Array<ParameterSyntax> parameters;
+		SyntaxListBuilder<ParameterSyntax> parameters;
 
 		token.increment();
 
@@ -922,17 +826,17 @@ namespace warbler
 
 			if (token.type() != TokenType::RightParenthesis)
 			{
-				print_parse_error(token, "')'", "Invalid tokens in parameter list");
+				print_parse_error(*token, "')'", "Invalid tokens in parameter list");
 				return {};
 			}
 		}
 
 		token.increment();
 
-		return parameters;
+		return parameters.finish();
 	}
 
-	Result<FunctionSignatureSyntax> parse_function_signature(Token& token)
+	Result<FunctionSignatureSyntax> parse_function_signature(TokenIterator& token)
 	{
 		auto parameters = parse_parameter_list(token);
 
@@ -952,13 +856,13 @@ namespace warbler
 		return FunctionSignatureSyntax(parameters.unwrap(), type.unwrap());
 	}
 
-	Result<BlockStatementSyntax> parse_block_statement(Token& token)
+	Result<BlockStatementSyntax> parse_block_statement(TokenIterator& token)
 	{
 		assert(token.type() == TokenType::LeftBrace);
 
 		token.increment();
 
-		Array<StatementSyntax> statements;
+		SyntaxListBuilder<StatementSyntax> statements;
 
 		while (token.type() != TokenType::RightBrace)
 		{
@@ -972,10 +876,10 @@ namespace warbler
 
 		token.increment();
 
-		return BlockStatementSyntax(std::move(statements));
+		return BlockStatementSyntax(statements.finish());
 	}
 
-	Result<DeclarationSyntax> parse_declaration(Token& token)
+	Result<DeclarationSyntax> parse_declaration(TokenIterator& token)
 	{
 		assert(token.type() == TokenType::KeywordVar);
 		token.increment();
@@ -987,7 +891,7 @@ namespace warbler
 
 		if (token.type() != TokenType::Assign)
 		{
-			print_parse_error(token, "expected '=' after declaration");
+			print_parse_error(*token, "expected '=' after declaration");
 			return {};
 		}
 
@@ -1000,7 +904,7 @@ namespace warbler
 
 		if (token.type() != TokenType::Semicolon)
 		{
-			print_parse_error(token, "expected ';' after declaration");
+			print_parse_error(*token, "expected ';' after declaration");
 			return {};
 		}
 
@@ -1009,7 +913,7 @@ namespace warbler
 		return DeclarationSyntax(declaration.unwrap(), value.unwrap());
 	}
 
-	Result<ExpressionStatementSyntax> parse_expression_statement(Token& token)
+	Result<ExpressionStatementSyntax> parse_expression_statement(TokenIterator& token)
 	{
 		auto expression = parse_expression(token);
 
@@ -1018,7 +922,7 @@ namespace warbler
 
 		if (token.type() != TokenType::Semicolon)
 		{
-			print_parse_error(token, "';'");
+			print_parse_error(*token, "';'");
 			return {};
 		}
 
@@ -1027,7 +931,7 @@ namespace warbler
 		return ExpressionStatementSyntax(expression.unwrap());
 	}
 
-	Result<IfStatementSyntax> parse_if_statement(Token& token)
+	Result<IfStatementSyntax> parse_if_statement(TokenIterator& token)
 	{
 		token.increment();
 		
@@ -1056,7 +960,7 @@ namespace warbler
 				if (!else_if)
 					return {};
 
-				return IfStatementSyntax(condition.unwrap(), then_body.unwrap(), new IfStatementSyntax(else_if.unwrap()));
+				return IfStatementSyntax(condition.unwrap(), then_body.unwrap(), else_if.unwrap());
 			}
 			else
 			{
@@ -1074,7 +978,7 @@ namespace warbler
 		return IfStatementSyntax(condition.unwrap(), then_body.unwrap());
 	}
 
-	Result<StatementSyntax> parse_statement(Token& token)
+	Result<StatementSyntax> parse_statement(TokenIterator& token)
 	{
 		switch (token.type())
 		{
@@ -1128,7 +1032,7 @@ namespace warbler
 		return StatementSyntax(res.unwrap());
 	}
 
-	Result<TypeSyntax> parse_type(Token& token)
+	Result<TypeSyntax> parse_type(TokenIterator& token)
 	{
 		assert(token.type() == TokenType::KeywordType);
 
@@ -1136,17 +1040,17 @@ namespace warbler
 
 		if (token.type() != TokenType::Identifier)
 		{
-			print_parse_error(token, "type name");
+			print_parse_error(*token, "type name");
 			return {};
 		}
 
-		auto name_token = token;
+		auto name_token = *token;
 
 		token.increment();
 
 		if (token.type() != TokenType::Colon)
 		{
-			print_parse_error(token, "':' after type name");
+			print_parse_error(*token, "':' after type name");
 			return {};
 		}
 
@@ -1166,12 +1070,12 @@ namespace warbler
 
 			default:
 				#pragma message "Implement the ability to have other types as type definitions"
-				print_parse_error(token, "type definition or base type");
+				print_parse_error(*token, "type definition or base type");
 				return {};
 		}
 	}
 
-	Result<MemberSyntax> parse_member(Token& token)
+	Result<MemberSyntax> parse_member(TokenIterator& token)
 	{
 		auto is_public = false;
 
@@ -1187,18 +1091,18 @@ namespace warbler
 
 		if (token.type() != TokenType::Identifier)
 		{
-			print_parse_error(token, "member name");
+			print_parse_error(*token, "member name");
 			print_note("Trailing commas are not allowed.");
 			return {};
 		}
 
-		auto name_token = token;
+		auto name_token = *token;
 
 		token.increment();
 
 		if (token.type() != TokenType::Colon)
 		{
-			print_parse_error(token, "':' after member name");
+			print_parse_error(*token, "':' after member name");
 			return {};
 		}
 		
@@ -1212,7 +1116,7 @@ namespace warbler
 		return MemberSyntax(name_token, type.unwrap(), is_public);
 	}
 
-	Result<StructSyntax> parse_struct(Token& token)
+	Result<StructSyntax> parse_struct(TokenIterator& token)
 	{
 		assert(token.type() == TokenType::KeywordStruct);
 
@@ -1220,23 +1124,23 @@ namespace warbler
 
 		if (token.type() != TokenType::Identifier)
 		{
-			print_parse_error(token, "struct name");
+			print_parse_error(*token, "struct name");
 			return {};
 		}
 
-		auto name = token;
+		auto name = *token;
 
 		token.increment();
 
 		if (token.type() != TokenType::LeftBrace)
 		{
-			print_parse_error(token, "'{' before struct body");
+			print_parse_error(*token, "'{' before struct body");
 			return {};
 		}
 
 		token.increment();
 
-		Array<MemberSyntax> members;
+		SyntaxListBuilder<MemberSyntax> members;
 
 		if (token.type() != TokenType::RightBrace)
 		{
@@ -1257,31 +1161,31 @@ namespace warbler
 
 			if (token.type() != TokenType::RightBrace)
 			{
-				print_parse_error(token, "'}' after struct body");
+				print_parse_error(*token, "'}' after struct body");
 				return {};
 			}
 		}
 
 		token.increment();
 
-		return StructSyntax(name, members);
+		return StructSyntax(name, members.finish());
 	}
 
-	Result<LabelSyntax> parse_label(Token& token)
+	Result<LabelSyntax> parse_label(TokenIterator& token)
 	{
 		if (token.type() != TokenType::Identifier)
 		{
-			print_parse_error(token, "label identifer");
+			print_parse_error(*token, "label identifer");
 			return {};
 		}
 
-		auto label = token;
+		auto label = *token;
 
 		token.increment();
 
 		if (token.type() != TokenType::Colon)
 		{
-			print_parse_error(token, "':' after label");
+			print_parse_error(*token, "':' after label");
 			return {};
 		}
 
@@ -1290,9 +1194,9 @@ namespace warbler
 		return LabelSyntax(label);
 	}
 
-	Result<TypeAnnotationSyntax> parse_type_annotation(Token& token)
+	Result<TypeAnnotationSyntax> parse_type_annotation(TokenIterator& token)
 	{
-		Array<PtrSyntax> ptr_mutability;
+		SyntaxListBuilder<PtrSyntax> ptr_mutability;
 
 		while (token.type() == TokenType::Asterisk)
 		{
@@ -1300,30 +1204,30 @@ namespace warbler
 
 			if (token.type() == TokenType::KeywordMut)
 			{
-				ptr_mutability.emplace_back(PtrSyntax { token, true });
+				ptr_mutability.emplace_back(PtrSyntax { *token, true });
 				token.increment();
 			}
 			else
 			{
-				ptr_mutability.emplace_back(PtrSyntax { token, false });
+				ptr_mutability.emplace_back(PtrSyntax { *token, false });
 			}
 		}
 
 		if (token.type() != TokenType::Identifier)
 		{
-			print_parse_error(token, "type");
+			print_parse_error(*token, "type");
 			return {};
 		}
 		
-		const auto base_type = token;
+		const auto base_type = *token;
 
 		token.increment();
 
 		#pragma message "fix parsing of Syntax"
-		return TypeAnnotationSyntax(base_type, std::move(ptr_mutability));
+		return TypeAnnotationSyntax(base_type, ptr_mutability.finish());
 	}
 
-	Result<VariableSyntax> parse_variable(Token& token)
+	Result<VariableSyntax> parse_variable(TokenIterator& token)
 	{
 		auto is_mutable = false;
 
@@ -1335,11 +1239,11 @@ namespace warbler
 
 		if (token.type() != TokenType::Identifier)
 		{
-			print_parse_error(token, "variable name");
+			print_parse_error(*token, "variable name");
 			return {};
 		}
 
-		auto name = token;
+		auto name = *token;
 
 		token.increment();
 
@@ -1358,63 +1262,344 @@ namespace warbler
 		return VariableSyntax(name, type.unwrap(), is_mutable);
 	}
 
-	Result<ModuleSyntax> parse_module(const File& file)
+	// Parses top-level declarations up to the end of the tokens and adds them to the module
+	// along with where they are in the file.
+	static bool parse_declarations(const TokenBuffer& tokens, ModuleSyntax& module, bool skip_bodies)
 	{
-		Array<FunctionSyntax> functions;
-		Array<StructSyntax> structs;
-		auto token = Token::get_initial(file);
+		auto token = TokenIterator(tokens);
 
 		while (true)
 		{
+			auto start_index = token.index();
+			auto start_node_count = module.pool->node_count();
+			bool is_function;
+			usize index;
+
 			switch (token.type())
 			{
 				case TokenType::KeywordFunction:
 				{
-					auto function = parse_function(token);
+					auto function = parse_function(token, skip_bodies);
 
 					if (!function)
-						return {};
+						return false;
 
-					functions.emplace_back(function.unwrap());
-					continue;
+					is_function = true;
+					index = module.functions.size();
+					module.functions.emplace_back(function.unwrap());
+					break;
 				}
 				case TokenType::KeywordStruct:
 				{
 					auto res = parse_struct(token);
 
 					if (!res)
-						return {};
+						return false;
 
-					structs.emplace_back(res.unwrap());
-					continue;
+					is_function = false;
+					index = module.structs.size();
+					module.structs.emplace_back(res.unwrap());
+					break;
 				}
 
 				case TokenType::EndOfFile:
-					break;
+					return true;
 
 				default:
-					print_parse_error(token, "type or function definition");
-					return {};
+					print_parse_error(*token, "type or function definition");
+					return false;
 			}
-			break;
+
+			auto last_index = token.index() - 1;
+
+			module.declarations.push_back(DeclarationSpan
+			{
+				static_cast<u32>(tokens.pos(start_index)),
+				static_cast<u32>(tokens.pos(last_index) + tokens.length(last_index)),
+				static_cast<u32>(index),
+				static_cast<u32>(module.pool->node_count() - start_node_count),
+				is_function
+			});
 		}
+	}
+
+	Result<ModuleSyntax> parse_module(const File& file, bool skip_bodies)
+	{
+		// all of the syntax in the module is added to its pool and freed with it
+		auto module = ModuleSyntax { Box<SyntaxPool>(new SyntaxPool()), {}, {}, {}, file.base(), skip_bodies, 0 };
+		SyntaxPoolScope scope(*module.pool);
+		auto tokens = TokenBuffer::lex(file);
+
+		if (!parse_declarations(tokens, module, skip_bodies))
+			return {};
 
-		return ModuleSyntax { std::move(functions), std::move(structs) };
+		return module;
 	}
 
-	Result<PackageSyntax> parse_package(const Directory& directory)
+	bool parse_function_body(FunctionSyntax& function, SyntaxPool& pool)
 	{
-		Array<FunctionSyntax> functions;
-		Array<StructSyntax> structs;
+		assert(!function.is_body_parsed() && function.pool() == pool.id());
+
+		const auto& range = function.body_range();
+		const auto& file = SourceManager::get_file(range.location);
+		auto pos = file.get_pos(range.location);
+		auto tokens = TokenBuffer::lex_range(file, pos, pos + range.length);
+		auto token = TokenIterator(tokens);
+		SyntaxPoolScope scope(pool);
+		auto body = parse_block_statement(token);
 
-		for (const auto& file : directory.files())
+		if (!body)
+			return false;
+
+		function.set_body(body.unwrap());
+
+		return true;
+	}
+
+	bool parse_function_bodies(ModuleSyntax& module)
+	{
+		for (auto& function : module.functions)
 		{
-			auto res = parse_module(file);
+			if (!function.is_body_parsed() && !parse_function_body(function, *module.pool))
+				return false;
+		}
 
-			if (!res)
+		return true;
+	}
+
+	bool parse_function_bodies(PackageSyntax& package)
+	{
+		for (auto& function : package.functions())
+		{
+			if (function.is_body_parsed())
+				continue;
+
+			auto *pool = package.find_pool(function.pool());
+
+			assert(pool != nullptr);
+
+			if (!parse_function_body(function, *pool))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Moves the tokens of syntax that is kept after an edit to where they are in the edited file.
+	// Handles and lists are left alone as the syntax stays in the same pool.
+	class TokenShifter
+	{
+		u32 _old_base;
+		u32 _new_base;
+		usize _edit_pos;
+		usize _edit_end;
+		usize _inserted_length;
+
+	public:
+
+		TokenShifter(u32 old_base, u32 new_base, const TextEdit& edit) :
+		_old_base(old_base),
+		_new_base(new_base),
+		_edit_pos(edit.pos),
+		_edit_end(edit.pos + edit.length),
+		_inserted_length(edit.text.size())
+		{}
+
+		usize get_pos(usize pos) const
+		{
+			if (pos >= _edit_end)
+				return pos - (_edit_end - _edit_pos) + _inserted_length;
+
+			// only syntax that is replaced has tokens inside of the edit
+			return std::min(pos, _edit_pos);
+		}
+
+		void operator()(Token& token)
+		{
+			auto pos = get_pos(token.location() - _old_base);
+			auto atom = token.type() == TokenType::Identifier
+				? token.atom()
+				: 0;
+
+			token = Token(_new_base + static_cast<u32>(pos), token.length(), token.type(), atom);
+		}
+
+		void operator()(SourceRange& range)
+		{
+			auto pos = get_pos(range.location - _old_base);
+			auto end = get_pos(range.location - _old_base + range.length);
+
+			range = SourceRange { _new_base + static_cast<u32>(pos), static_cast<u32>(end - pos) };
+		}
+
+		void operator()(ExpressionSyntax&) {}
+		void operator()(StatementSyntax&) {}
+
+		template <typename T>
+		void operator()(SyntaxList<T>&) {}
+
+		template <typename T>
+		void operator()(T& node) { node.visit(*this); }
+	};
+
+	static void keep_declaration(ModuleSyntax& module, ModuleSyntax& previous, const DeclarationSpan& declaration, TokenShifter& shifter)
+	{
+		auto span = DeclarationSpan
+		{
+			static_cast<u32>(shifter.get_pos(declaration.pos)),
+			static_cast<u32>(shifter.get_pos(declaration.end)),
+			0,
+			declaration.node_count,
+			declaration.is_function
+		};
+
+		if (declaration.is_function)
+		{
+			span.index = static_cast<u32>(module.functions.size());
+			shifter(module.functions.emplace_back(std::move(previous.functions[declaration.index])));
+		}
+		else
+		{
+			span.index = static_cast<u32>(module.structs.size());
+			shifter(module.structs.emplace_back(std::move(previous.structs[declaration.index])));
+		}
+
+		module.declarations.push_back(span);
+	}
+
+	// Only the declarations an edit touches are lexed and parsed again. Lexing starts at the end of
+	// the last declaration before the edit and stops once it lands on the start of a declaration
+	// after it, so an edit that opens a comment also replaces the declarations the comment now
+	// covers. Kept declarations only have their tokens moved. The nodes of replaced declarations
+	// stay in the pool until the file is parsed in full again, which is done once they make up
+	// half of it. The tokens of every node in the pool are moved, so that keeps the work done for
+	// an edit proportional to the size of the module.
+	Result<ModuleSyntax> reparse_module(ModuleSyntax&& previous, const File& file, const TextEdit& edit)
+	{
+		assert(file.get_view(edit.pos, edit.text.size()) == edit.text);
+
+		if (previous.dead_node_count * 2 > previous.pool->node_count())
+			return parse_module(file, previous.skip_bodies);
+
+		const auto& declarations = previous.declarations;
+		auto edit_end = edit.pos + edit.length;
+		usize first_edited = 0;
+
+		// a declaration that touches the edit is replaced as its first or last token may now
+		// be joined with the edited text
+		while (first_edited < declarations.size() && declarations[first_edited].end < edit.pos)
+			first_edited += 1;
+
+		auto first_kept = first_edited;
+
+		while (first_kept < declarations.size() && declarations[first_kept].pos <= edit_end)
+			first_kept += 1;
+
+		auto shifter = TokenShifter(previous.base, file.base(), edit);
+		Array<usize> boundaries;
+
+		boundaries.reserve(declarations.size() - first_kept);
+
+		for (usize i = first_kept; i < declarations.size(); ++i)
+			boundaries.push_back(shifter.get_pos(declarations[i].pos));
+
+		auto region_pos = first_edited > 0
+			? declarations[first_edited - 1].end
+			: 0;
+		auto tokens = TokenBuffer::lex_until(file, region_pos, boundaries);
+		auto region_end = tokens.pos(tokens.size() - 1);
+		auto first_resumed = first_kept + static_cast<usize>(std::lower_bound(boundaries.begin(), boundaries.end(), region_end) - boundaries.begin());
+
+		auto module = ModuleSyntax { std::move(previous.pool), {}, {}, {}, file.base(), previous.skip_bodies, previous.dead_node_count };
+
+		module.functions.reserve(previous.functions.size());
+		module.structs.reserve(previous.structs.size());
+		module.declarations.reserve(declarations.size());
+
+		module.pool->for_each_array([&](auto& nodes)
+		{
+			for (auto& node : nodes)
+				shifter(node);
+		});
+
+		for (usize i = 0; i < first_edited; ++i)
+			keep_declaration(module, previous, declarations[i], shifter);
+
+		bool is_parsed;
+
+		{
+			// the region ends with an end of file token instead of the next declaration, so
+			// errors are reported by parsing the whole file instead
+			DiagnosticCapture capture;
+			SyntaxPoolScope scope(*module.pool);
+
+			is_parsed = parse_declarations(tokens, module, module.skip_bodies);
+		}
+
+		if (!is_parsed)
+			return parse_module(file, module.skip_bodies);
+
+		for (usize i = first_edited; i < first_resumed; ++i)
+			module.dead_node_count += declarations[i].node_count;
+
+		for (usize i = first_resumed; i < declarations.size(); ++i)
+			keep_declaration(module, previous, declarations[i], shifter);
+
+		return module;
+	}
+
+	// Modules do not depend on each other while they are parsed, so they are parsed on worker
+	// threads. The diagnostics of each module are captured and printed in file order afterwards,
+	// up to the first module that failed, which keeps the output the same as parsing the files
+	// one after another.
+	static Result<Array<ModuleSyntax>> parse_modules(const Array<const File*>& files, usize worker_count, SyntaxCache *cache, bool skip_bodies)
+	{
+		Array<Optional<ModuleSyntax>> results(files.size());
+		Array<String> diagnostics(files.size());
+
+		parallel_for(files.size(), [&](usize i)
+		{
+			DiagnosticCapture capture;
+			auto res = cache
+				? cache->parse_module(*files[i], skip_bodies)
+				: parse_module(*files[i], skip_bodies);
+
+			if (res)
+				results[i] = res.unwrap();
+
+			diagnostics[i] = capture.text();
+		}, worker_count);
+
+		Array<ModuleSyntax> modules;
+
+		modules.reserve(files.size());
+
+		for (usize i = 0; i < files.size(); ++i)
+		{
+			print_captured(diagnostics[i]);
+
+			if (!results[i])
 				return {};
 
-			auto mod = res.unwrap();
+			modules.emplace_back(std::move(*results[i]));
+		}
+
+		return modules;
+	}
+
+	static PackageSyntax create_package(const Directory& directory, ModuleSyntax *modules)
+	{
+		Array<Box<SyntaxPool>> pools;
+		Array<FunctionSyntax> functions;
+		Array<StructSyntax> structs;
+
+		pools.reserve(directory.files().size());
+
+		for (usize i = 0; i < directory.files().size(); ++i)
+		{
+			auto& mod = modules[i];
+
+			pools.emplace_back(std::move(mod.pool));
 
 			functions.reserve(functions.size() + mod.functions.size());
 
@@ -1431,21 +1616,53 @@ namespace warbler
 			}
 		}
 
-		return PackageSyntax(directory.path(), std::move(functions), std::move(structs));
+		return PackageSyntax(directory.path(), std::move(pools), std::move(functions), std::move(structs));
 	}
 
-	Result<ProgramSyntax> parse(const Array<Directory>& directories)
+	Result<PackageSyntax> parse_package(const Directory& directory, usize worker_count, SyntaxCache *cache, bool skip_bodies)
 	{
-		Array<PackageSyntax> packages;
+		Array<const File*> files;
+
+		for (const auto& file : directory.files())
+			files.push_back(&file);
+
+		auto res = parse_modules(files, worker_count, cache, skip_bodies);
+
+		if (!res)
+			return {};
+
+		auto modules = res.unwrap();
+
+		return create_package(directory, modules.data());
+	}
+
+	Result<ProgramSyntax> parse(const Array<Directory>& directories, usize worker_count, SyntaxCache *cache, bool skip_bodies)
+	{
+		// the files of every package are parsed together so small packages do not leave
+		// workers idle
+		Array<const File*> files;
 
 		for (const auto& directory : directories)
 		{
-			auto package = parse_package(directory);
+			for (const auto& file : directory.files())
+				files.push_back(&file);
+		}
 
-			if (!package)
-				return {};
+		auto res = parse_modules(files, worker_count, cache, skip_bodies);
+
+		if (!res)
+			return {};
+
+		auto modules = res.unwrap();
+		Array<PackageSyntax> packages;
+		usize first_module = 0;
 
-			packages.emplace_back(package.unwrap());
+		packages.reserve(directories.size());
+
+		for (const auto& directory : directories)
+		{
+			packages.emplace_back(create_package(directory, modules.data() + first_module));
+			first_module += directory.files().size();
 		}
 
 		if (packages.size() == 0)
@@ -1,25 +1,22 @@
 #include <warbler/preprocessor.hpp>
 
+#include <warbler/scanner.hpp>
+
 // standard library
 #include <cstddef>
+#include <cstring>
 
 namespace warbler
 {
-	char *read_text_literal(char *pos)
+	char *read_text_literal(char *pos, const char *end)
 	{
 		char terminal = pos[0];
-		++pos;
-
-		while (1)
-		{
-			if (!pos[0])
-				return pos;
+		auto *terminal_pos = pos + (find_quote_end(pos + 1, end, terminal) - pos);
 
-			if (pos[0] == terminal && pos[-1] != '\\')
-				return pos + 1;
+		if (!terminal_pos[0])
+			return terminal_pos;
 
-			++pos;
-		}
+		return terminal_pos + 1;
 	}
 
 	struct BlockCommentResult
@@ -28,49 +25,36 @@ namespace warbler
 		size_t new_line_count;
 	};
 
-	char *read_line_comment(char *pos)
+	char *read_line_comment(char *pos, const char *end)
 	{
 		pos += 2;
-		
-		while (*pos)
-		{
-			if (*pos == '\n')
-				return pos + 1;
-				
-			pos += 1;
-		}
+		pos += find_line_end(pos, end) - pos;
+
+		if (*pos == '\n')
+			return pos + 1;
 
 		return pos;
 	}
 
-	BlockCommentResult read_block_comment(char *pos)
+	BlockCommentResult read_block_comment(char *pos, const char *end)
 	{
-		size_t new_line_count = 0;
-		
 		pos += 2;
 
-		while (*pos)
-		{
-			if (pos[0] == '\n')
-			{
-				new_line_count += 1;
-			}
-			else if (pos[0] == '*' && pos[1] == '/')
-			{
-				// skip last two characters
-				pos += 2;
-				break;
-			}
+		auto res = find_block_comment_end(pos, end);
 
-			pos += 1;
-		}
+		pos += res.pos - pos;
+
+		// skip last two characters
+		if (*pos == '*')
+			pos += 2;
 
-		return { pos, new_line_count};
+		return { pos, res.new_line_count };
 	}
 
 	void preprocess(char *src)
 	{
 		size_t oi = 0;
+		const char *end = src + strlen(src);
 
 		for (char *pos = src; *pos; ++pos)
 		{
@@ -79,12 +63,12 @@ namespace warbler
 				case '/':
 					if (pos[1] == '/')
 					{
-						pos = read_line_comment(pos);			
+						pos = read_line_comment(pos, end);			
 						src[oi++] = '\n';
 					}
 					else if (pos[1] == '*')
 					{
-						BlockCommentResult res = read_block_comment(pos);
+						BlockCommentResult res = read_block_comment(pos, end);
 
 						pos = res.end_of_comment - 1;
 						src[oi++] = ' ';
@@ -101,7 +85,7 @@ namespace warbler
 				case '\'':
 				case '\"':
 				{
-					char *end_of_text = read_text_literal(pos);
+					char *end_of_text = read_text_literal(pos, end);
 
 					size_t text_length = end_of_text - pos;
 					for (size_t i = 0; i < text_length; ++i)
@@ -0,0 +1,736 @@
+#include <warbler/scanner.hpp>
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WARBLER_SCANNER_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define WARBLER_TARGET_AVX2
+#else
+#define WARBLER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace warbler
+{
+	static inline u32 count_trailing_zeros(u32 mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	static inline u32 count_ones(u32 mask)
+	{
+#ifdef _MSC_VER
+		u32 count = 0;
+
+		for (; mask; mask &= mask - 1)
+			count += 1;
+
+		return count;
+#else
+		return __builtin_popcount(mask);
+#endif
+	}
+
+	// mask of the bits below index
+	static inline u32 get_lower_mask(u32 index)
+	{
+		return (1u << index) - 1;
+	}
+
+	static inline bool is_whitespace_char(char c)
+	{
+		// signed comparison so that non-ascii bytes count as whitespace on every platform
+		return c != '\0' && static_cast<signed char>(c) <= ' ';
+	}
+
+	static inline bool is_identifier_char(char c)
+	{
+		return (c >= 'a' && c <= 'z')
+			|| (c >= 'A' && c <= 'Z')
+			|| (c >= '0' && c <= '9')
+			|| c == '_';
+	}
+
+	static inline bool is_digit_char(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	static const char *scalar_skip_whitespace(const char *pos, const char *end)
+	{
+		while (pos < end && is_whitespace_char(*pos))
+			pos += 1;
+
+		return pos;
+	}
+
+	static const char *scalar_skip_identifier(const char *pos, const char *end)
+	{
+		while (pos < end && is_identifier_char(*pos))
+			pos += 1;
+
+		return pos;
+	}
+
+	static const char *scalar_skip_digits(const char *pos, const char *end)
+	{
+		while (pos < end && is_digit_char(*pos))
+			pos += 1;
+
+		return pos;
+	}
+
+	static const char *scalar_find_line_end(const char *pos, const char *end)
+	{
+		while (pos < end && *pos != '\n' && *pos != '\0')
+			pos += 1;
+
+		return pos;
+	}
+
+	static BlockCommentEnd scalar_find_block_comment_end(const char *pos, const char *end)
+	{
+		usize new_line_count = 0;
+
+		while (pos < end && *pos != '\0')
+		{
+			if (*pos == '\n')
+			{
+				new_line_count += 1;
+			}
+			else if (*pos == '*' && pos + 1 < end && pos[1] == '/')
+			{
+				break;
+			}
+
+			pos += 1;
+		}
+
+		return { pos, new_line_count };
+	}
+
+	static const char *scalar_find_quote_end(const char *pos, const char *end, char terminal)
+	{
+		while (pos < end)
+		{
+			if (*pos == '\0' || (*pos == terminal && pos[-1] != '\\'))
+				break;
+
+			pos += 1;
+		}
+
+		return pos;
+	}
+
+	// offsets are relative to pos, scanning starts at iter
+	static void scalar_find_new_lines_from(const char *pos, const char *iter, const char *end, Array<usize>& offsets)
+	{
+		for (; iter < end; ++iter)
+		{
+			if (*iter == '\n')
+				offsets.push_back(iter - pos);
+		}
+	}
+
+	static void scalar_find_new_lines(const char *pos, const char *end, Array<usize>& offsets)
+	{
+		scalar_find_new_lines_from(pos, pos, end, offsets);
+	}
+
+	static inline void push_mask_offsets(u32 mask, usize offset, Array<usize>& offsets)
+	{
+		while (mask)
+		{
+			offsets.push_back(offset + count_trailing_zeros(mask));
+			mask &= mask - 1;
+		}
+	}
+
+#ifdef WARBLER_SCANNER_X86
+
+	static inline __m128i sse2_load(const char *pos)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+	}
+
+	static inline u32 sse2_get_mask(__m128i bytes)
+	{
+		return static_cast<u32>(_mm_movemask_epi8(bytes));
+	}
+
+	static inline __m128i sse2_is_equal(__m128i bytes, char c)
+	{
+		return _mm_cmpeq_epi8(bytes, _mm_set1_epi8(c));
+	}
+
+	static inline __m128i sse2_is_in_range(__m128i bytes, char low, char high)
+	{
+		auto is_above_low = _mm_cmpgt_epi8(bytes, _mm_set1_epi8(static_cast<char>(low - 1)));
+		auto is_below_high = _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(high + 1)), bytes);
+
+		return _mm_and_si128(is_above_low, is_below_high);
+	}
+
+	static inline u32 sse2_get_non_whitespace_mask(__m128i bytes)
+	{
+		auto is_null = sse2_is_equal(bytes, '\0');
+		auto is_visible = _mm_cmpgt_epi8(bytes, _mm_set1_epi8(' '));
+
+		return sse2_get_mask(_mm_or_si128(is_null, is_visible));
+	}
+
+	static inline u32 sse2_get_identifier_mask(__m128i bytes)
+	{
+		auto lowercase = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+		auto is_letter = sse2_is_in_range(lowercase, 'a', 'z');
+		auto is_digit = sse2_is_in_range(bytes, '0', '9');
+		auto is_underscore = sse2_is_equal(bytes, '_');
+
+		return sse2_get_mask(_mm_or_si128(_mm_or_si128(is_letter, is_digit), is_underscore));
+	}
+
+	static const char *sse2_skip_whitespace(const char *pos, const char *end)
+	{
+		while (end - pos >= 16)
+		{
+			auto mask = sse2_get_non_whitespace_mask(sse2_load(pos));
+
+			if (mask)
+				return pos + count_trailing_zeros(mask);
+
+			pos += 16;
+		}
+
+		return scalar_skip_whitespace(pos, end);
+	}
+
+	static const char *sse2_skip_identifier(const char *pos, const char *end)
+	{
+		while (end - pos >= 16)
+		{
+			auto mask = ~sse2_get_identifier_mask(sse2_load(pos)) & 0xFFFF;
+
+			if (mask)
+				return pos + count_trailing_zeros(mask);
+
+			pos += 16;
+		}
+
+		return scalar_skip_identifier(pos, end);
+	}
+
+	static const char *sse2_skip_digits(const char *pos, const char *end)
+	{
+		while (end - pos >= 16)
+		{
+			auto mask = ~sse2_get_mask(sse2_is_in_range(sse2_load(pos), '0', '9')) & 0xFFFF;
+
+			if (mask)
+				return pos + count_trailing_zeros(mask);
+
+			pos += 16;
+		}
+
+		return scalar_skip_digits(pos, end);
+	}
+
+	static const char *sse2_find_line_end(const char *pos, const char *end)
+	{
+		while (end - pos >= 16)
+		{
+			auto bytes = sse2_load(pos);
+			auto mask = sse2_get_mask(_mm_or_si128(sse2_is_equal(bytes, '\n'), sse2_is_equal(bytes, '\0')));
+
+			if (mask)
+				return pos + count_trailing_zeros(mask);
+
+			pos += 16;
+		}
+
+		return scalar_find_line_end(pos, end);
+	}
+
+	static BlockCommentEnd sse2_find_block_comment_end(const char *pos, const char *end)
+	{
+		usize new_line_count = 0;
+
+		while (end - pos >= 16)
+		{
+			auto bytes = sse2_load(pos);
+			auto new_line_mask = sse2_get_mask(sse2_is_equal(bytes, '\n'));
+			auto mask = sse2_get_mask(_mm_or_si128(sse2_is_equal(bytes, '*'), sse2_is_equal(bytes, '\0')));
+
+			if (!mask)
+			{
+				new_line_count += count_ones(new_line_mask);
+				pos += 16;
+				continue;
+			}
+
+			auto index = count_trailing_zeros(mask);
+
+			new_line_count += count_ones(new_line_mask & get_lower_mask(index));
+			pos += index;
+
+			if (*pos == '\0' || (pos + 1 < end && pos[1] == '/'))
+				return { pos, new_line_count };
+
+			// lone '*' inside of comment
+			pos += 1;
+		}
+
+		auto res = scalar_find_block_comment_end(pos, end);
+
+		res.new_line_count += new_line_count;
+
+		return res;
+	}
+
+	static const char *sse2_find_quote_end(const char *pos, const char *end, char terminal)
+	{
+		while (end - pos >= 16)
+		{
+			auto bytes = sse2_load(pos);
+			auto mask = sse2_get_mask(_mm_or_si128(sse2_is_equal(bytes, terminal), sse2_is_equal(bytes, '\0')));
+
+			if (!mask)
+			{
+				pos += 16;
+				continue;
+			}
+
+			pos += count_trailing_zeros(mask);
+
+			if (*pos == '\0' || pos[-1] != '\\')
+				return pos;
+
+			// escaped terminal character
+			pos += 1;
+		}
+
+		return scalar_find_quote_end(pos, end, terminal);
+	}
+
+	static void sse2_find_new_lines(const char *pos, const char *end, Array<usize>& offsets)
+	{
+		const char *iter = pos;
+
+		for (; end - iter >= 16; iter += 16)
+			push_mask_offsets(sse2_get_mask(sse2_is_equal(sse2_load(iter), '\n')), iter - pos, offsets);
+
+		scalar_find_new_lines_from(pos, iter, end, offsets);
+	}
+
+	WARBLER_TARGET_AVX2 static inline __m256i avx2_load(const char *pos)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pos));
+	}
+
+	WARBLER_TARGET_AVX2 static inline u32 avx2_get_mask(__m256i bytes)
+	{
+		return static_cast<u32>(_mm256_movemask_epi8(bytes));
+	}
+
+	WARBLER_TARGET_AVX2 static inline __m256i avx2_is_equal(__m256i bytes, char c)
+	{
+		return _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c));
+	}
+
+	WARBLER_TARGET_AVX2 static inline __m256i avx2_is_in_range(__m256i bytes, char low, char high)
+	{
+		auto is_above_low = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(static_cast<char>(low - 1)));
+		auto is_below_high = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(high + 1)), bytes);
+
+		return _mm256_and_si256(is_above_low, is_below_high);
+	}
+
+	WARBLER_TARGET_AVX2 static inline u32 avx2_get_non_whitespace_mask(__m256i bytes)
+	{
+		auto is_null = avx2_is_equal(bytes, '\0');
+		auto is_visible = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(' '));
+
+		return avx2_get_mask(_mm256_or_si256(is_null, is_visible));
+	}
+
+	WARBLER_TARGET_AVX2 static inline u32 avx2_get_identifier_mask(__m256i bytes)
+	{
+		auto lowercase = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+		auto is_letter = avx2_is_in_range(lowercase, 'a', 'z');
+		auto is_digit = avx2_is_in_range(bytes, '0', '9');
+		auto is_underscore = avx2_is_equal(bytes, '_');
+
+		return avx2_get_mask(_mm256_or_si256(_mm256_or_si256(is_letter, is_digit), is_underscore));
+	}
+
+	WARBLER_TARGET_AVX2 static const char *avx2_skip_whitespace(const char *pos, const char *end)
+	{
+		while (end - pos >= 32)
+		{
+			auto mask = avx2_get_non_whitespace_mask(avx2_load(pos));
+
+			if (mask)
+				return pos + count_trailing_zeros(mask);
+
+			pos += 32;
+		}
+
+		return sse2_skip_whitespace(pos, end);
+	}
+
+	WARBLER_TARGET_AVX2 static const char *avx2_skip_identifier(const char *pos, const char *end)
+	{
+		while (end - pos >= 32)
+		{
+			auto mask = ~avx2_get_identifier_mask(avx2_load(pos));
+
+			if (mask)
+				return pos + count_trailing_zeros(mask);
+
+			pos += 32;
+		}
+
+		return sse2_skip_identifier(pos, end);
+	}
+
+	WARBLER_TARGET_AVX2 static const char *avx2_skip_digits(const char *pos, const char *end)
+	{
+		while (end - pos >= 32)
+		{
+			auto mask = ~avx2_get_mask(avx2_is_in_range(avx2_load(pos), '0', '9'));
+
+			if (mask)
+				return pos + count_trailing_zeros(mask);
+
+			pos += 32;
+		}
+
+		return sse2_skip_digits(pos, end);
+	}
+
+	WARBLER_TARGET_AVX2 static const char *avx2_find_line_end(const char *pos, const char *end)
+	{
+		while (end - pos >= 32)
+		{
+			auto bytes = avx2_load(pos);
+			auto mask = avx2_get_mask(_mm256_or_si256(avx2_is_equal(bytes, '\n'), avx2_is_equal(bytes, '\0')));
+
+			if (mask)
+				return pos + count_trailing_zeros(mask);
+
+			pos += 32;
+		}
+
+		return sse2_find_line_end(pos, end);
+	}
+
+	WARBLER_TARGET_AVX2 static BlockCommentEnd avx2_find_block_comment_end(const char *pos, const char *end)
+	{
+		usize new_line_count = 0;
+
+		while (end - pos >= 32)
+		{
+			auto bytes = avx2_load(pos);
+			auto new_line_mask = avx2_get_mask(avx2_is_equal(bytes, '\n'));
+			auto mask = avx2_get_mask(_mm256_or_si256(avx2_is_equal(bytes, '*'), avx2_is_equal(bytes, '\0')));
+
+			if (!mask)
+			{
+				new_line_count += count_ones(new_line_mask);
+				pos += 32;
+				continue;
+			}
+
+			auto index = count_trailing_zeros(mask);
+
+			new_line_count += count_ones(new_line_mask & get_lower_mask(index));
+			pos += index;
+
+			if (*pos == '\0' || (pos + 1 < end && pos[1] == '/'))
+				return { pos, new_line_count };
+
+			// lone '*' inside of comment
+			pos += 1;
+		}
+
+		auto res = sse2_find_block_comment_end(pos, end);
+
+		res.new_line_count += new_line_count;
+
+		return res;
+	}
+
+	WARBLER_TARGET_AVX2 static const char *avx2_find_quote_end(const char *pos, const char *end, char terminal)
+	{
+		while (end - pos >= 32)
+		{
+			auto bytes = avx2_load(pos);
+			auto mask = avx2_get_mask(_mm256_or_si256(avx2_is_equal(bytes, terminal), avx2_is_equal(bytes, '\0')));
+
+			if (!mask)
+			{
+				pos += 32;
+				continue;
+			}
+
+			pos += count_trailing_zeros(mask);
+
+			if (*pos == '\0' || pos[-1] != '\\')
+				return pos;
+
+			// escaped terminal character
+			pos += 1;
+		}
+
+		return sse2_find_quote_end(pos, end, terminal);
+	}
+
+	WARBLER_TARGET_AVX2 static void avx2_find_new_lines(const char *pos, const char *end, Array<usize>& offsets)
+	{
+		const char *iter = pos;
+
+		for (; end - iter >= 32; iter += 32)
+			push_mask_offsets(avx2_get_mask(avx2_is_equal(avx2_load(iter), '\n')), iter - pos, offsets);
+
+		scalar_find_new_lines_from(pos, iter, end, offsets);
+	}
+
+#endif
+
+	struct Scanners
+	{
+		const char *(*skip_whitespace)(const char *pos, const char *end);
+		const char *(*skip_identifier)(const char *pos, const char *end);
+		const char *(*skip_digits)(const char *pos, const char *end);
+		const char *(*find_line_end)(const char *pos, const char *end);
+		BlockCommentEnd (*find_block_comment_end)(const char *pos, const char *end);
+		const char *(*find_quote_end)(const char *pos, const char *end, char terminal);
+		void (*find_new_lines)(const char *pos, const char *end, Array<usize>& offsets);
+	};
+
+	static const Scanners scalar_scanners =
+	{
+		scalar_skip_whitespace,
+		scalar_skip_identifier,
+		scalar_skip_digits,
+		scalar_find_line_end,
+		scalar_find_block_comment_end,
+		scalar_find_quote_end,
+		scalar_find_new_lines
+	};
+
+#ifdef WARBLER_SCANNER_X86
+
+	static const Scanners sse2_scanners =
+	{
+		sse2_skip_whitespace,
+		sse2_skip_identifier,
+		sse2_skip_digits,
+		sse2_find_line_end,
+		sse2_find_block_comment_end,
+		sse2_find_quote_end,
+		sse2_find_new_lines
+	};
+
+	static const Scanners avx2_scanners =
+	{
+		avx2_skip_whitespace,
+		avx2_skip_identifier,
+		avx2_skip_digits,
+		avx2_find_line_end,
+		avx2_find_block_comment_end,
+		avx2_find_quote_end,
+		avx2_find_new_lines
+	};
+
+#endif
+
+	static ScanLevel detect_max_scan_level()
+	{
+#if defined(WARBLER_SCANNER_X86) && defined(_MSC_VER)
+		int info[4];
+
+		__cpuid(info, 0);
+
+		if (info[0] < 7)
+			return ScanLevel::Sse2;
+
+		__cpuid(info, 1);
+
+		bool has_os_xsave = info[2] & (1 << 27);
+		bool has_avx = info[2] & (1 << 28);
+
+		// the os also has to save the ymm registers
+		if (!has_os_xsave || !has_avx || (_xgetbv(0) & 0x6) != 0x6)
+			return ScanLevel::Sse2;
+
+		__cpuidex(info, 7, 0);
+
+		return info[1] & (1 << 5)
+			? ScanLevel::Avx2
+			: ScanLevel::Sse2;
+#elif defined(WARBLER_SCANNER_X86)
+		return __builtin_cpu_supports("avx2")
+			? ScanLevel::Avx2
+			: ScanLevel::Sse2;
+#else
+		return ScanLevel::Scalar;
+#endif
+	}
+
+	static const Scanners& get_scanners(ScanLevel level)
+	{
+		switch (level)
+		{
+#ifdef WARBLER_SCANNER_X86
+			case ScanLevel::Avx2:
+				return avx2_scanners;
+
+			case ScanLevel::Sse2:
+				return sse2_scanners;
+#endif
+			default:
+				return scalar_scanners;
+		}
+	}
+
+	static const Scanners& select_scanners();
+
+	static const char *detect_skip_whitespace(const char *pos, const char *end)
+	{
+		return select_scanners().skip_whitespace(pos, end);
+	}
+
+	static const char *detect_skip_identifier(const char *pos, const char *end)
+	{
+		return select_scanners().skip_identifier(pos, end);
+	}
+
+	static const char *detect_skip_digits(const char *pos, const char *end)
+	{
+		return select_scanners().skip_digits(pos, end);
+	}
+
+	static const char *detect_find_line_end(const char *pos, const char *end)
+	{
+		return select_scanners().find_line_end(pos, end);
+	}
+
+	static BlockCommentEnd detect_find_block_comment_end(const char *pos, const char *end)
+	{
+		return select_scanners().find_block_comment_end(pos, end);
+	}
+
+	static const char *detect_find_quote_end(const char *pos, const char *end, char terminal)
+	{
+		return select_scanners().find_quote_end(pos, end, terminal);
+	}
+
+	static void detect_find_new_lines(const char *pos, const char *end, Array<usize>& offsets)
+	{
+		select_scanners().find_new_lines(pos, end, offsets);
+	}
+
+	// The scanners start out as ones that pick the best supported scanners the first time
+	// any of them is used. Everything here is constant initialized, so text can be scanned
+	// from the initializers of statics in other files.
+	static const Scanners detecting_scanners =
+	{
+		detect_skip_whitespace,
+		detect_skip_identifier,
+		detect_skip_digits,
+		detect_find_line_end,
+		detect_find_block_comment_end,
+		detect_find_quote_end,
+		detect_find_new_lines
+	};
+
+	static std::atomic<const Scanners *> scanners = &detecting_scanners;
+
+	static const Scanners& select_scanners()
+	{
+		const auto *detecting = &detecting_scanners;
+
+		// another thread may have picked them already, or set the level by hand
+		scanners.compare_exchange_strong(detecting, &get_scanners(get_max_scan_level()), std::memory_order_relaxed);
+
+		return *scanners.load(std::memory_order_relaxed);
+	}
+
+	const char *skip_whitespace(const char *pos, const char *end)
+	{
+		return scanners.load(std::memory_order_relaxed)->skip_whitespace(pos, end);
+	}
+
+	const char *skip_identifier(const char *pos, const char *end)
+	{
+		return scanners.load(std::memory_order_relaxed)->skip_identifier(pos, end);
+	}
+
+	const char *skip_digits(const char *pos, const char *end)
+	{
+		return scanners.load(std::memory_order_relaxed)->skip_digits(pos, end);
+	}
+
+	const char *find_line_end(const char *pos, const char *end)
+	{
+		return scanners.load(std::memory_order_relaxed)->find_line_end(pos, end);
+	}
+
+	BlockCommentEnd find_block_comment_end(const char *pos, const char *end)
+	{
+		return scanners.load(std::memory_order_relaxed)->find_block_comment_end(pos, end);
+	}
+
+	const char *find_quote_end(const char *pos, const char *end, char terminal)
+	{
+		return scanners.load(std::memory_order_relaxed)->find_quote_end(pos, end, terminal);
+	}
+
+	void find_new_lines(const char *pos, const char *end, Array<usize>& offsets)
+	{
+		scanners.load(std::memory_order_relaxed)->find_new_lines(pos, end, offsets);
+	}
+
+	ScanLevel get_max_scan_level()
+	{
+		static const auto max_scan_level = detect_max_scan_level();
+
+		return max_scan_level;
+	}
+
+	ScanLevel get_scan_level()
+	{
+		const auto *current = scanners.load(std::memory_order_relaxed);
+
+#ifdef WARBLER_SCANNER_X86
+		if (current == &avx2_scanners)
+			return ScanLevel::Avx2;
+
+		if (current == &sse2_scanners)
+			return ScanLevel::Sse2;
+#endif
+
+		if (current == &scalar_scanners)
+			return ScanLevel::Scalar;
+
+		return get_max_scan_level();
+	}
+
+	void set_scan_level(ScanLevel level)
+	{
+		if (level > get_max_scan_level())
+			level = get_max_scan_level();
+
+		scanners.store(&get_scanners(level), std::memory_order_relaxed);
+	}
+}
@@ -9,7 +9,7 @@ namespace warbler
 	_line(file.get_line(pos)),
 	_col(file.get_col(pos))
 	{
-		assert(pos + length < file.src().size());
+		assert(pos + length <= file.src().size());
 
 		usize start_of_line = pos - _col;
 		usize end = pos + length;
@@ -47,9 +47,9 @@ namespace warbler
 	{}
 
 	Snippet::Snippet(const Token& first, const Token& last) :
-	Snippet(first.file(), first.pos(), last.pos() + last.length() - first.pos())
+	Snippet(first.file(), first.pos(), last.location() + last.length() - first.location())
 	{
 		assert(&first.file() == &last.file());
-		assert(first.pos() <= last.pos());
+		assert(first.location() <= last.location());
 	}
 }
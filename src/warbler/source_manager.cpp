@@ -0,0 +1,226 @@
+#include <warbler/source_manager.hpp>
+
+#include <warbler/file.hpp>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <stdexcept>
+
+namespace warbler
+{
+	struct SourceEntry
+	{
+		std::atomic<const File *> file;
+		// next unused entry while the entry is not used by a file
+		SourceEntry *next_free;
+		u32 base;
+		// location of the end of file, the last one the file was given
+		u32 last;
+	};
+
+	// Files are given whole pages of locations, so every page belongs to at most one file and
+	// finding the file of a location is two array lookups. The page table only ever gains
+	// leaves, so readers never have to take a lock.
+	static constexpr u32 page_bits = 12;
+	static constexpr u32 leaf_bits = 10;
+	static constexpr u32 leaf_size = 1 << leaf_bits;
+	static constexpr u32 leaf_count = 1 << (32 - page_bits - leaf_bits);
+	static constexpr u32 page_count = 1 << (32 - page_bits);
+
+	struct FreeRange
+	{
+		u32 page;
+		u32 count;
+	};
+
+	static std::atomic<std::atomic<SourceEntry *> *> leaves[leaf_count];
+	static std::mutex sources_mutex;
+	// pages from here on are not used by any file
+	static u32 next_page = 0;
+	// entries are reused instead of freed so a reader can never be left with a dangling entry
+	static SourceEntry *free_entries = nullptr;
+
+	// Free pages below next_page, sorted and never adjacent, as neighbouring ranges are merged
+	// when a file is removed. It is never destroyed, as files may be added or removed by the
+	// constructors and destructors of other statics.
+	static Array<FreeRange>& get_free_ranges()
+	{
+		static auto *free_ranges = new Array<FreeRange>();
+
+		return *free_ranges;
+	}
+
+	static std::atomic<SourceEntry *>& get_page(u32 page)
+	{
+		auto& leaf = leaves[page >> leaf_bits];
+		auto *pages = leaf.load(std::memory_order_relaxed);
+
+		if (pages == nullptr)
+		{
+			pages = new std::atomic<SourceEntry *>[leaf_size]();
+			leaf.store(pages, std::memory_order_release);
+		}
+
+		return pages[page & (leaf_size - 1)];
+	}
+
+	static SourceEntry *find_entry(u32 location)
+	{
+		auto *pages = leaves[location >> (page_bits + leaf_bits)].load(std::memory_order_acquire);
+
+		if (pages == nullptr)
+			return nullptr;
+
+		auto *entry = pages[(location >> page_bits) & (leaf_size - 1)].load(std::memory_order_acquire);
+
+		if (entry == nullptr || location > entry->last)
+			return nullptr;
+
+		return entry;
+	}
+
+	static u32 get_page_count(u64 location_count)
+	{
+		return static_cast<u32>((location_count + (1 << page_bits) - 1) >> page_bits);
+	}
+
+	static void set_pages(u32 first_page, u32 count, SourceEntry *entry)
+	{
+		for (u32 i = 0; i < count; ++i)
+			get_page(first_page + i).store(entry, std::memory_order_release);
+	}
+
+	static void free_pages(u32 first_page, u32 count)
+	{
+		auto& free_ranges = get_free_ranges();
+		usize index = 0;
+
+		while (index < free_ranges.size() && free_ranges[index].page < first_page)
+			index += 1;
+
+		auto joins_previous = index > 0 && free_ranges[index - 1].page + free_ranges[index - 1].count == first_page;
+		auto joins_next = index < free_ranges.size() && first_page + count == free_ranges[index].page;
+
+		if (joins_previous && joins_next)
+		{
+			free_ranges[index - 1].count += count + free_ranges[index].count;
+			free_ranges.erase(free_ranges.begin() + index);
+		}
+		else if (joins_previous)
+		{
+			free_ranges[index - 1].count += count;
+		}
+		else if (joins_next)
+		{
+			free_ranges[index].page = first_page;
+			free_ranges[index].count += count;
+		}
+		else
+		{
+			free_ranges.insert(free_ranges.begin() + index, FreeRange { first_page, count });
+		}
+
+		if (free_ranges.back().page + free_ranges.back().count == next_page)
+		{
+			next_page = free_ranges.back().page;
+			free_ranges.pop_back();
+		}
+	}
+
+	u32 SourceManager::add_file(const File& file, usize size)
+	{
+		// the extra location is for the end of file token
+		auto location_count = static_cast<u64>(size) + 1;
+
+		if (location_count > UINT32_MAX)
+			throw std::runtime_error("Total size of source files exceeds the maximum of 4 GiB.");
+
+		auto used_pages = get_page_count(location_count);
+
+		std::unique_lock lock(sources_mutex);
+		auto& free_ranges = get_free_ranges();
+
+		// the lowest range that fits keeps the locations in use packed together
+		auto iter = free_ranges.begin();
+
+		while (iter != free_ranges.end() && iter->count < used_pages)
+			++iter;
+
+		u32 first_page;
+
+		if (iter != free_ranges.end())
+		{
+			first_page = iter->page;
+
+			if (iter->count == used_pages)
+			{
+				free_ranges.erase(iter);
+			}
+			else
+			{
+				iter->page += used_pages;
+				iter->count -= used_pages;
+			}
+		}
+		else
+		{
+			if (page_count - next_page < used_pages)
+				throw std::runtime_error("Total size of source files exceeds the maximum of 4 GiB.");
+
+			first_page = next_page;
+			next_page += used_pages;
+		}
+
+		auto *entry = free_entries;
+
+		if (entry != nullptr)
+			free_entries = entry->next_free;
+		else
+			entry = new SourceEntry();
+
+		entry->file.store(&file, std::memory_order_relaxed);
+		entry->base = first_page << page_bits;
+		entry->last = entry->base + static_cast<u32>(size);
+
+		set_pages(first_page, used_pages, entry);
+
+		return entry->base;
+	}
+
+	void SourceManager::move_file(u32 base, const File& file)
+	{
+		auto *entry = find_entry(base);
+
+		assert(entry != nullptr && entry->base == base);
+
+		entry->file.store(&file, std::memory_order_release);
+	}
+
+	void SourceManager::remove_file(u32 base)
+	{
+		std::unique_lock lock(sources_mutex);
+
+		auto *entry = find_entry(base);
+
+		assert(entry != nullptr && entry->base == base);
+
+		auto first_page = base >> page_bits;
+		auto used_pages = get_page_count(static_cast<u64>(entry->last - base) + 1);
+
+		set_pages(first_page, used_pages, nullptr);
+		free_pages(first_page, used_pages);
+		entry->file.store(nullptr, std::memory_order_relaxed);
+		entry->next_free = free_entries;
+		free_entries = entry;
+	}
+
+	const File& SourceManager::get_file(u32 location)
+	{
+		auto *entry = find_entry(location);
+
+		if (entry == nullptr)
+			throw std::runtime_error("Source location " + std::to_string(location) + " does not belong to a loaded file.");
+
+		return *entry->file.load(std::memory_order_acquire);
+	}
+}
@@ -33,13 +33,13 @@ namespace warbler
 		}
 	}
 
-	bool GlobalSymbolTable::add_symbol(SymbolData&& data)
+	bool GlobalSymbolTable::add_symbol(u32 scope, u32 identifier, SymbolData&& data)
 	{
-		auto previous_declaration = find(data.symbol());
+		auto previous_declaration = find(scope, identifier);
 
 		if (previous_declaration != nullptr)
 		{
-			auto message = get_symbol_type_name(data.type()) + " '" + data.symbol() + "' is already defined as a "
+			auto message = get_symbol_type_name(data.type()) + " '" + String(data.symbol_text()) + "' is already defined as a "
 				+ get_symbol_type_name(previous_declaration->type());
 
 			switch (data.type())
@@ -81,54 +81,111 @@ namespace warbler
 			return false;
 		}
 
-		_symbols.emplace(data.symbol(), data);
+		_scopes[scope].symbols.emplace(identifier, data);
 
 		return true;
 	}
 
+	GlobalSymbolTable::GlobalSymbolTable() :
+	_scopes({ PackageScope { {}, {}, 0, 0 } })
+	{}
+
+	u32 GlobalSymbolTable::get_child_scope(u32 scope, u32 name)
+	{
+		auto iter = _scopes[scope].children.find(name);
+
+		if (iter != _scopes[scope].children.end())
+			return iter->second;
+
+		auto child = static_cast<u32>(_scopes.size());
+
+		_scopes[scope].children.emplace(name, child);
+		_scopes.push_back(PackageScope { {}, {}, name, scope });
+
+		return child;
+	}
+
+	static String create_symbol(const String& prefix, u32 identifier)
+	{
+		auto symbol = prefix;
+
+		symbol += Interner::get(identifier);
+
+		return symbol;
+	}
+
 	Result<GlobalSymbolTable> GlobalSymbolTable::generate(const ProgramSyntax& syntax)
 	{
 		GlobalSymbolTable table;
 
-		auto& symbols = table._symbols;
-
-		symbols.emplace("u8", SymbolData("u8", U8_INDEX, SymbolType::Primitive));
-		symbols.emplace("u16", SymbolData("u16", U16_INDEX, SymbolType::Primitive));
-		symbols.emplace("u32", SymbolData("u32", U32_INDEX, SymbolType::Primitive));
-		symbols.emplace("u64", SymbolData("u64", U64_INDEX, SymbolType::Primitive));
+		auto& root = table._scopes[0].symbols;
 
-		symbols.emplace("i8", SymbolData("i8", I8_INDEX, SymbolType::Primitive));
-		symbols.emplace("i16", SymbolData("i16", I16_INDEX, SymbolType::Primitive));
-		symbols.emplace("i32", SymbolData("i32", I32_INDEX, SymbolType::Primitive));
-		symbols.emplace("i64", SymbolData("i64", I64_INDEX, SymbolType::Primitive));
+		struct PrimitiveSymbol
+		{
+			const char *name;
+			usize index;
+		};
 
-		symbols.emplace("f32", SymbolData("f32", F32_INDEX, SymbolType::Primitive));
-		symbols.emplace("f64", SymbolData("f64", F64_INDEX, SymbolType::Primitive));
+		static const PrimitiveSymbol primitive_symbols[] =
+		{
+			{ "u8", U8_INDEX },
+			{ "u16", U16_INDEX },
+			{ "u32", U32_INDEX },
+			{ "u64", U64_INDEX },
+			{ "i8", I8_INDEX },
+			{ "i16", I16_INDEX },
+			{ "i32", I32_INDEX },
+			{ "i64", I64_INDEX },
+			{ "f32", F32_INDEX },
+			{ "f64", F64_INDEX },
+			{ "bool", BOOL_INDEX },
+			{ "char", CHAR_INDEX }
+		};
+
+		// primitives are declared outside of any package
+		for (const auto& primitive : primitive_symbols)
+		{
+			auto atom = Interner::intern(primitive.name);
 
-		symbols.emplace("bool", SymbolData("bool", BOOL_INDEX, SymbolType::Primitive));
-		symbols.emplace("char", SymbolData("char", CHAR_INDEX, SymbolType::Primitive));
+			root.emplace(atom, SymbolData(atom, primitive.index, SymbolType::Primitive));
+		}
 
 		bool success = true;
 
 		for (const auto& package : syntax.packages())
 		{
-			auto scope = package.name() + "::";
+			const auto& name = package.name();
+			u32 scope = 0;
+
+			// a package named 'a::b' is nested in package 'a'
+			for (usize pos = 0; pos <= name.size();)
+			{
+				auto separator = name.find("::", pos);
+
+				if (separator == String::npos)
+					separator = name.size();
+
+				scope = table.get_child_scope(scope, Interner::intern(StringView(name).substr(pos, separator - pos)));
+				pos = separator + 2;
+			}
+
+			auto prefix = name + "::";
 
 			for (const auto& struct_def : package.structs())
 			{
-				auto struct_name = struct_def.name().text();
-				auto symbol = scope + struct_name;
+				auto identifier = struct_def.name().atom();
+				auto symbol = Interner::intern(create_symbol(prefix, identifier));
 
-				if (!table.add_symbol(SymbolData(symbol, struct_def)))
+				if (!table.add_symbol(scope, identifier, SymbolData(symbol, struct_def)))
 					success = false;
 			}
 
 			for (const auto& function : package.functions())
 			{
-				auto name = function.name().text();
-				auto symbol = scope + name;
+				auto identifier = function.name().atom();
+				auto symbol = Interner::intern(create_symbol(prefix, identifier));
 
-				if (!table.add_symbol(SymbolData(symbol, function)))
+				if (!table.add_symbol(scope, identifier, SymbolData(symbol, function)))
 					success = false;
 			}
 		}
@@ -139,69 +196,22 @@ namespace warbler
 		return table;
 	}
 
-	static String create_symbol(const Array<String>& packages, usize count, const String& identifier)
+	SymbolData *GlobalSymbolTable::resolve(u32 scope, u32 identifier)
 	{
-		String symbol;
-
-		symbol.reserve(128);
-
-		for (usize i = 0; i < count; ++i)
+		while (true)
 		{
-			symbol += packages[i];
-			symbol += "::";
-		}
-
-		symbol += identifier;
-
-		return symbol;
-	}
-
-	void GlobalSymbolTable::set_scope_from_symbol(const String& symbol)
-	{
-		assert(!symbol.empty());
+			auto *data = find(scope, identifier);
 
-		_current_package.clear();
+			if (data != nullptr)
+				return data;
 
-		String tmp;
+			if (scope == 0)
+				return nullptr;
 
-		tmp.reserve(64);
-
-		// split symbol by '::'
-		for (usize i = 0; i < symbol.size(); ++i)
-		{
-			if (symbol[i] == ':')
-			{
-				assert(symbol[i + 1] == ':');
-				_current_package.push_back(tmp);
-				tmp.clear();
-				i += 1;
-				continue;
-			}
-
-			tmp += symbol[i];
+			scope = _scopes[scope].parent;
 		}
 	}
 
-	// TODO: make this safe
-	String GlobalSymbolTable::get_symbol(const String& identifier)
-	{
-		return create_symbol(_current_package, _current_package.size(), identifier);
-	}
-
-	SymbolData *GlobalSymbolTable::resolve(const String& identifier)
-	{
-		for (i32 i = static_cast<i32>(_current_package.size()); i >= 0; --i)
-		{
-			auto symbol = create_symbol(_current_package, i, identifier);
-			auto iter = _symbols.find(symbol);
-
-			if (iter != _symbols.end())
-				return &iter->second;
-		}
-
-		return nullptr;
-	}
-
 	usize GlobalSymbolTable::add_validated_struct(StructContext&& type)
 	{
 		auto index = _structs.size();
@@ -222,14 +232,14 @@ namespace warbler
 
 	AddSymbolResult FunctionSymbolTable::add_parameter(const ParameterSyntax& syntax)
 	{
-		auto name = syntax.name().text();
+		auto name = syntax.name().atom();
 		auto result = _symbols.emplace(name, syntax);
 		auto success = result.second;
 		auto& symbol_data = result.first->second;
 
 		if (!success) // Failed to emplace
 		{
-			print_error(syntax.name(), "A parameter with the name '" + name + "' already exists in this scope.");
+			print_error(syntax.name(), "A parameter with the name '" + syntax.name().text() + "' already exists in this scope.");
 			print_note(symbol_data.parameter_syntax().name(), "Previous usage here.");
 
 			new (&symbol_data) auto(SymbolData(syntax));
@@ -238,65 +248,73 @@ namespace warbler
 		return { success, symbol_data };
 	}
 
-	AddSymbolResult BlockSymbolTable::add_variable(const VariableSyntax& syntax)
+	AddSymbolResult FunctionSymbolTable::add_variable(const VariableSyntax& syntax)
 	{
-		auto name = syntax.name().text();
-		auto result = _symbols.emplace(name, syntax);
-		auto success = result.second;
-		auto& symbol_data = result.first->second;
+		assert(!_block_starts.empty());
 
-		if (!success) // Failed to emplace
+		auto name = syntax.name().atom();
+		auto& binding = _bindings.emplace(name, 0).first->second;
+
+		// a variable that is bound to a name in the current block is redeclared rather than shadowed
+		if (binding > _block_starts.back())
 		{
-			print_error(syntax.name(), "A variable with the name '" + name + "' already exists in this parameter list.");
+			auto& symbol_data = _variable_stack[binding - 1].data;
+
+			print_error(syntax.name(), "A variable with the name '" + syntax.name().text() + "' already exists in this parameter list.");
 			print_note(symbol_data.variable_syntax().name(), "Previous usage here.");
 
 			new (&symbol_data) auto(SymbolData(syntax));
+
+			return { false, symbol_data };
 		}
 
-		return { success, symbol_data };
+		_variable_stack.push_back(ScopedVariable { SymbolData(syntax), binding });
+		binding = static_cast<u32>(_variable_stack.size());
+
+		return { true, _variable_stack.back().data };
 	}
 
-	SymbolData *FunctionSymbolTable::find_variable(const String& identifier)
+	void FunctionSymbolTable::pop_block()
 	{
-		for (i32 i = static_cast<i32>(_blocks.size()) - 1; i >= 0; --i)
+		assert(!_block_starts.empty());
+
+		auto start = _block_starts.back();
+
+		// popped innermost first so that every binding ends up as it was before the block
+		while (_variable_stack.size() > start)
 		{
-			auto& block = _blocks[i];
-			auto *res = block.at(identifier);
+			const auto& variable = _variable_stack.back();
 
-			if (res)
-				return res;
+			_bindings.at(variable.data.symbol()) = variable.shadowed;
+			_variable_stack.pop_back();
 		}
 
-		return nullptr;
+		_block_starts.pop_back();
 	}
 
-	static inline bool contains_semicolon(const String& identifier)
+	SymbolData *FunctionSymbolTable::find_variable(u32 identifier)
 	{
-		for (char c : identifier)
-		{
-			if (c == ':')
-				return true;
-		}
+		auto iter = _bindings.find(identifier);
+
+		if (iter == _bindings.end() || iter->second == 0)
+			return nullptr;
 
-		return false;
+		return &_variable_stack[iter->second - 1].data;
 	}
 
-	SymbolData *FunctionSymbolTable::resolve(const String& identifier)
+	SymbolData *FunctionSymbolTable::resolve(u32 identifier)
 	{
-		if (!contains_semicolon(identifier))
-		{
-			auto *variable = find_variable(identifier);
+		auto *variable = find_variable(identifier);
 
-			if (variable)
-				return variable;
+		if (variable)
+			return variable;
 
-			auto *parameter = find_parameter(identifier);
+		auto *parameter = find_parameter(identifier);
 
-			if (parameter)
-				return parameter;
-		}
+		if (parameter)
+			return parameter;
 
-		auto *global = _globals->resolve(identifier);
+		auto *global = _globals->resolve(_scope, identifier);
 
 		if (global)
 			return global;
@@ -0,0 +1,592 @@
+#include <warbler/syntax_cache.hpp>
+
+#include <warbler/parser.hpp>
+#include <warbler/interner.hpp>
+#include <warbler/util/file.hpp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <type_traits>
+
+namespace warbler
+{
+	// bump whenever the layout of an entry changes
+	static const u32 cache_format_version = 5;
+	static const char cache_magic[4] = { 'W', 'B', 'L', 'C' };
+
+	struct CacheHeader
+	{
+		char magic[4];
+		u32 format_version;
+		u64 key;
+		u64 source_size;
+		// base the tokens' locations were relative to when the entry was written
+		u32 source_base;
+		u32 array_count;
+		// hash of everything after the header
+		u64 checksum;
+	};
+
+	// functions are kept in the module rather than the pool and their signature holds an
+	// Optional, so they are written in this flattened form
+	struct CachedFunction
+	{
+		Token name;
+		SyntaxList<ParameterSyntax> parameters;
+		TypeAnnotationSyntax return_type;
+		BlockStatementSyntax body;
+		SourceRange body_range;
+		bool has_return_type;
+		bool is_body_parsed;
+
+		template <typename Visitor>
+		void visit(Visitor& visitor)
+		{
+			visitor(name);
+			visitor(parameters);
+			visitor(return_type);
+			visitor(body);
+
+			if (!is_body_parsed)
+				visitor(body_range);
+		}
+	};
+
+	static_assert(std::is_trivially_copyable_v<StructSyntax>);
+	static_assert(std::is_trivially_copyable_v<CachedFunction>);
+
+	// Points the syntax loaded from an entry at the file and pool it now belongs to. Token
+	// locations are moved to the file's current base and identifiers are interned again, as
+	// atoms are only stable within a run. An entry may have been damaged on disk, so every
+	// location, tag, list and handle is checked against the file and pool along the way, and
+	// the entry is rejected if any of them are out of range.
+	class SyntaxRelocator
+	{
+		const File& _file;
+		const SyntaxPool& _pool;
+		u32 _old_base;
+		bool _is_valid;
+
+		template <typename T>
+		void check_tag(T tag, T last)
+		{
+			// negative values wrap around to be out of range as well
+			if (static_cast<u64>(tag) > static_cast<u64>(last))
+				_is_valid = false;
+		}
+
+		template <typename T>
+		void check_nodes(u64 first, u64 count)
+		{
+			if (first + count > _pool.nodes<T>().size())
+				_is_valid = false;
+		}
+
+		void check_expression(ExpressionType type, u32 index)
+		{
+			switch (type)
+			{
+				case ExpressionType::Assignment: return check_nodes<AssignmentSyntax>(index, 1);
+				case ExpressionType::Conditional: return check_nodes<ConditionalExpressionSyntax>(index, 1);
+				case ExpressionType::BooleanOr: return check_nodes<BooleanOrExpressionSyntax>(index, 1);
+				case ExpressionType::BooleanAnd: return check_nodes<BooleanAndExpressionSyntax>(index, 1);
+				case ExpressionType::BitwiseOr: return check_nodes<BitwiseOrExpressionSyntax>(index, 1);
+				case ExpressionType::BitwiseXor: return check_nodes<BitwiseXorExpressionSyntax>(index, 1);
+				case ExpressionType::BitwiseAnd: return check_nodes<BitwiseAndExpressionSyntax>(index, 1);
+				case ExpressionType::Equality: return check_nodes<EqualityExpressionSyntax>(index, 1);
+				case ExpressionType::Relational: return check_nodes<RelationalExpressionSyntax>(index, 1);
+				case ExpressionType::Shift: return check_nodes<BitShiftExpressionSyntax>(index, 1);
+				case ExpressionType::Additive: return check_nodes<AdditiveExpressionSyntax>(index, 1);
+				case ExpressionType::Multiplicative: return check_nodes<MultiplicativeExpressionSyntax>(index, 1);
+				case ExpressionType::Postfix: return check_nodes<PostfixExpressionSyntax>(index, 1);
+				case ExpressionType::Prefix: return check_nodes<PrefixExpressionSyntax>(index, 1);
+				case ExpressionType::Primary: return check_nodes<PrimaryExpressionSyntax>(index, 1);
+				case ExpressionType::Constant: return check_nodes<ConstantSyntax>(index, 1);
+				case ExpressionType::Symbol: return check_nodes<SymbolSyntax>(index, 1);
+
+				default:
+					_is_valid = false;
+					break;
+			}
+		}
+
+		void check_statement(StatementType type, u32 index)
+		{
+			switch (type)
+			{
+				case StatementType::Expression: return check_nodes<ExpressionStatementSyntax>(index, 1);
+				case StatementType::Declaration: return check_nodes<DeclarationSyntax>(index, 1);
+				case StatementType::Block: return check_nodes<BlockStatementSyntax>(index, 1);
+
+				default:
+					_is_valid = false;
+					break;
+			}
+		}
+
+	public:
+
+		SyntaxRelocator(const File& file, u32 old_base, const SyntaxPool& pool) :
+		_file(file),
+		_pool(pool),
+		_old_base(old_base),
+		_is_valid(true)
+		{}
+
+		void operator()(Token& token)
+		{
+			auto location = token.location();
+
+			if (token.type() > TokenType::KeywordWhile || location < _old_base || location - _old_base + token.length() > _file.src().size())
+			{
+				_is_valid = false;
+				return;
+			}
+
+			auto pos = location - _old_base;
+			u32 atom = 0;
+
+			if (token.type() == TokenType::Identifier)
+				atom = Interner::intern(_file.get_view(pos, token.length()));
+
+			token = Token(_file.get_location(pos), token.length(), token.type(), atom);
+		}
+
+		void operator()(SourceRange& range)
+		{
+			if (range.location < _old_base || range.location - _old_base + range.length > _file.src().size())
+			{
+				_is_valid = false;
+				return;
+			}
+
+			range.location = _file.get_location(range.location - _old_base);
+		}
+
+		void operator()(ExpressionSyntax& expression)
+		{
+			check_expression(expression._type, expression._index);
+			expression._pool = _pool.id();
+		}
+
+		void operator()(StatementSyntax& statement)
+		{
+			check_statement(statement._type, statement._index);
+			statement._pool = _pool.id();
+		}
+
+		template <typename T>
+		void operator()(SyntaxList<T>& list)
+		{
+			check_nodes<T>(list._first, list._count);
+			list._pool = _pool.id();
+		}
+
+		// nodes that are told apart by a tag are only visited once the tag is known to be valid
+
+		void operator()(ConstantSyntax& constant)
+		{
+			check_tag(constant.type(), ConstantType::Boolean);
+			constant.visit(*this);
+		}
+
+		void operator()(PostfixExpressionSyntax& postfix)
+		{
+			check_tag(postfix.type(), PostfixType::Member);
+			postfix.visit(*this);
+		}
+
+		void operator()(PrefixExpressionSyntax& prefix)
+		{
+			check_tag(prefix.type(), PrefixType::BooleanNot);
+			prefix.visit(*this);
+		}
+
+		void operator()(AssignmentSyntax& assignment)
+		{
+			check_tag(assignment.type(), AssignmentType::BitwiseXor);
+			assignment.visit(*this);
+		}
+
+		void operator()(IfStatementSyntax& statement)
+		{
+			check_tag(statement._type, IfType::ThenElseIf);
+
+			if (statement._type == IfType::ThenElseIf)
+				check_nodes<IfStatementSyntax>(statement._else_if, 1);
+
+			statement.visit(*this);
+		}
+
+		void operator()(MultiplicativeRhsSyntax& rhs) { check_tag(rhs.type, MultiplicativeType::Modulus); rhs.visit(*this); }
+		void operator()(AdditiveRhsSyntax& rhs) { check_tag(rhs.type, AdditiveType::Subtract); rhs.visit(*this); }
+		void operator()(BitShiftRhsSyntax& rhs) { check_tag(rhs.type, BitShiftType::Right); rhs.visit(*this); }
+		void operator()(RelationalRhsSyntax& rhs) { check_tag(rhs.type, RelationalType::LessThanOrEqualTo); rhs.visit(*this); }
+		void operator()(EqualityRhsSyntax& rhs) { check_tag(rhs.type, EqualityType::NotEquals); rhs.visit(*this); }
+
+		template <typename T>
+		void operator()(T& node) { node.visit(*this); }
+
+		bool is_valid() const { return _is_valid; }
+	};
+
+	class CacheReader
+	{
+		const char *_data;
+		usize _size;
+		usize _pos;
+
+	public:
+
+		CacheReader(const char *data, usize size) :
+		_data(data),
+		_size(size),
+		_pos(0)
+		{}
+
+		bool read(void *out, usize size)
+		{
+			if (size > _size - _pos)
+				return false;
+
+			// an empty array has no storage to copy into
+			if (size == 0)
+				return true;
+
+			std::memcpy(out, _data + _pos, size);
+			_pos += size;
+
+			return true;
+		}
+
+		template <typename T>
+		bool read_array(Array<T>& array)
+		{
+			u64 count;
+
+			if (!read(&count, sizeof(count)) || count > (_size - _pos) / sizeof(T))
+				return false;
+
+			if constexpr (std::is_default_constructible_v<T>)
+			{
+				array.resize(count);
+
+				return read(array.data(), count * sizeof(T));
+			}
+			else
+			{
+				array.reserve(count);
+
+				for (u64 i = 0; i < count; ++i)
+				{
+					alignas(T) char buffer[sizeof(T)];
+
+					read(buffer, sizeof(T));
+					array.push_back(*reinterpret_cast<const T *>(buffer));
+				}
+
+				return true;
+			}
+		}
+
+		bool is_finished() const { return _pos == _size; }
+	};
+
+	static void write(String& data, const void *value, usize size)
+	{
+		data.append(static_cast<const char *>(value), size);
+	}
+
+	template <typename T>
+	static void write_array(String& data, const T *values, usize count)
+	{
+		u64 count_value = count;
+
+		write(data, &count_value, sizeof(count_value));
+		write(data, values, count * sizeof(T));
+	}
+
+	static u64 mix_hash(u64 hash, u64 word)
+	{
+		hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+
+		return hash ^ (hash >> 32);
+	}
+
+	static u64 get_hash(u64 hash, StringView text)
+	{
+		const auto *data = text.data();
+		auto size = text.size();
+		usize i = 0;
+
+		hash = mix_hash(hash, size);
+
+		for (; i + sizeof(u64) <= size; i += sizeof(u64))
+		{
+			u64 word;
+
+			std::memcpy(&word, data + i, sizeof(word));
+			hash = mix_hash(hash, word);
+		}
+
+		u64 tail = 0;
+
+		for (usize j = 0; i + j < size; ++j)
+			tail |= static_cast<u64>(static_cast<u8>(data[i + j])) << (j * 8);
+
+		return mix_hash(hash, tail);
+	}
+
+	static u64 get_version_hash()
+	{
+		auto hash = get_hash(mix_hash(cache_format_version, parser_version), WARBLER_VERSION);
+		SyntaxPool pool;
+
+		// entries hold nodes as they are laid out in memory, so any change to a node type
+		// has to invalidate them as well
+		pool.for_each_array([&](const auto& array)
+		{
+			using Node = typename std::decay_t<decltype(array)>::value_type;
+
+			hash = mix_hash(hash, sizeof(Node) << 16 | alignof(Node));
+		});
+
+		hash = mix_hash(hash, sizeof(StructSyntax));
+		hash = mix_hash(hash, sizeof(CachedFunction));
+		hash = mix_hash(hash, sizeof(DeclarationSpan));
+
+		return hash;
+	}
+
+	// flags are read as bytes first, as anything but 0 or 1 in a bool is not a valid value
+	static bool is_valid_flag(const bool& flag)
+	{
+		u8 value;
+
+		std::memcpy(&value, &flag, sizeof(value));
+
+		return value <= 1;
+	}
+
+	static String get_entry_path(const String& directory, u64 key)
+	{
+		char filename[32];
+
+		snprintf(filename, sizeof(filename), "%016llx.wbc", static_cast<unsigned long long>(key));
+
+		return (std::filesystem::path(directory) / filename).string();
+	}
+
+	static Result<ModuleSyntax> load_module(const String& path, const File& file, u64 key, bool skip_bodies)
+	{
+		auto mapping_res = MappedFile::map(path);
+
+		if (!mapping_res)
+			return {};
+
+		auto mapping = mapping_res.unwrap();
+		auto reader = CacheReader(mapping.data(), mapping.size());
+		CacheHeader header;
+
+		if (!reader.read(&header, sizeof(header))
+			|| std::memcmp(header.magic, cache_magic, sizeof(cache_magic))
+			|| header.format_version != cache_format_version
+			|| header.key != key
+			|| header.source_size != file.src().size())
+			return {};
+
+		// damaged entries are almost always caught here, the checks below make sure that the
+		// rest can never index out of bounds
+		if (header.checksum != get_hash(0, StringView(mapping.data() + sizeof(header), mapping.size() - sizeof(header))))
+			return {};
+
+		auto pool = Box<SyntaxPool>(new SyntaxPool());
+		Array<StructSyntax> structs;
+		Array<CachedFunction> cached_functions;
+		Array<DeclarationSpan> declarations;
+		u32 array_count = 0;
+		bool is_read = true;
+
+		pool->for_each_array([&](auto& array)
+		{
+			array_count += 1;
+			is_read = is_read && reader.read_array(array);
+		});
+
+		if (!is_read
+			|| array_count != header.array_count
+			|| !reader.read_array(structs)
+			|| !reader.read_array(cached_functions)
+			|| !reader.read_array(declarations)
+			|| !reader.is_finished())
+			return {};
+
+		for (const auto& declaration : declarations)
+		{
+			auto declaration_count = declaration.is_function
+				? cached_functions.size()
+				: structs.size();
+
+			if (!is_valid_flag(declaration.is_function) || declaration.index >= declaration_count
+				|| declaration.pos > declaration.end || declaration.end > file.src().size())
+				return {};
+		}
+
+		for (const auto& function : cached_functions)
+		{
+			if (!is_valid_flag(function.has_return_type) || !is_valid_flag(function.is_body_parsed))
+				return {};
+		}
+
+		SyntaxRelocator relocator(file, header.source_base, *pool);
+
+		pool->for_each_array([&](auto& array)
+		{
+			for (auto& node : array)
+				relocator(node);
+		});
+
+		for (auto& type : structs)
+			relocator(type);
+
+		for (auto& function : cached_functions)
+			relocator(function);
+
+		if (!relocator.is_valid())
+			return {};
+
+		Array<FunctionSyntax> functions;
+
+		functions.reserve(cached_functions.size());
+
+		for (auto& function : cached_functions)
+		{
+			auto signature = function.has_return_type
+				? FunctionSignatureSyntax(function.parameters, std::move(function.return_type))
+				: FunctionSignatureSyntax(function.parameters);
+
+			if (function.is_body_parsed)
+				functions.emplace_back(function.name, std::move(signature), std::move(function.body));
+			else
+				functions.emplace_back(function.name, std::move(signature), function.body_range, pool->id());
+		}
+
+		return ModuleSyntax { std::move(pool), std::move(functions), std::move(structs), std::move(declarations), file.base(), skip_bodies, 0 };
+	}
+
+	static void store_module(const String& path, const ModuleSyntax& module, const File& file, u64 key)
+	{
+		String data;
+		CacheHeader header;
+
+		std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+		header.format_version = cache_format_version;
+		header.key = key;
+		header.source_size = file.src().size();
+		header.source_base = file.base();
+		header.array_count = 0;
+		header.checksum = 0;
+
+		module.pool->for_each_array([&](const auto&)
+		{
+			header.array_count += 1;
+		});
+
+		write(data, &header, sizeof(header));
+
+		module.pool->for_each_array([&](const auto& array)
+		{
+			write_array(data, array.data(), array.size());
+		});
+
+		write_array(data, module.structs.data(), module.structs.size());
+
+		Array<CachedFunction> functions;
+
+		functions.reserve(module.functions.size());
+
+		for (const auto& function : module.functions)
+		{
+			const auto& signature = function.signature();
+			const auto& return_type = signature.return_type();
+			auto is_body_parsed = function.is_body_parsed();
+
+			functions.push_back(CachedFunction
+			{
+				function.name(),
+				signature.parameters(),
+				return_type.has_value() ? *return_type : TypeAnnotationSyntax(function.name(), SyntaxList<PtrSyntax>(0, 0, 0)),
+				is_body_parsed ? function.body() : BlockStatementSyntax(SyntaxList<StatementSyntax>(function.pool(), 0, 0)),
+				is_body_parsed ? SourceRange { 0, 0 } : function.body_range(),
+				return_type.has_value(),
+				is_body_parsed
+			});
+		}
+
+		write_array(data, functions.data(), functions.size());
+		write_array(data, module.declarations.data(), module.declarations.size());
+
+		header.checksum = get_hash(0, StringView(data.data() + sizeof(header), data.size() - sizeof(header)));
+		std::memcpy(data.data(), &header, sizeof(header));
+
+		// written to a file of its own first so other compilers never see a partial entry
+		thread_local std::mt19937_64 rng(std::random_device{}());
+		auto temporary_path = path + "." + std::to_string(rng()) + ".tmp";
+		auto *stream = fopen(temporary_path.c_str(), "wb");
+
+		if (!stream)
+			return;
+
+		auto bytes_written = fwrite(data.data(), 1, data.size(), stream);
+		auto is_closed = fclose(stream) == 0;
+		std::error_code error;
+
+		if (bytes_written == data.size() && is_closed)
+			std::filesystem::rename(temporary_path, path, error);
+
+		if (bytes_written != data.size() || !is_closed || error)
+			std::filesystem::remove(temporary_path, error);
+	}
+
+	SyntaxCache::SyntaxCache(const String& directory) :
+	_directory(directory),
+	_version_hash(get_version_hash()),
+	_hits(0),
+	_misses(0)
+	{
+		std::error_code error;
+
+		std::filesystem::create_directories(directory, error);
+	}
+
+	Result<ModuleSyntax> SyntaxCache::parse_module(const File& file, bool skip_bodies)
+	{
+		// modules with skipped bodies are kept apart from those parsed in full
+		auto key = get_hash(mix_hash(_version_hash, skip_bodies), file.src());
+		auto path = get_entry_path(_directory, key);
+		auto cached = load_module(path, file, key, skip_bodies);
+
+		if (cached)
+		{
+			_hits += 1;
+			return cached;
+		}
+
+		_misses += 1;
+
+		auto res = warbler::parse_module(file, skip_bodies);
+
+		// modules with errors are not stored so that their diagnostics are printed every time
+		if (res)
+		{
+			auto module = res.unwrap();
+
+			store_module(path, module, file, key);
+
+			return module;
+		}
+
+		return {};
+	}
+}
@@ -1,349 +1,266 @@
 #include <warbler/token.hpp>
 
 #include <warbler/util/print.hpp>
+#include <warbler/scanner.hpp>
+#include <algorithm>
 #include <cstring>
+#include <thread>
 
 namespace warbler
 {
-	Token::Token(const File& file, usize pos, usize length, TokenType type) :
-	_file(file),
-	_pos(pos),
-	_length(length),
-	_type(type)
-	{}
+	Token::Token(u32 location, usize length, TokenType type, u32 atom) :
+	_location(location),
+	_length(static_cast<u16>(length)),
+	_type(type),
+	_atom(atom)
+	{
+		assert(length <= UINT16_MAX);
+	}
 
-	static usize get_next_pos(const File& file, usize pos)
+	// a chunk that is lexed speculatively may have started inside a comment or string, so an
+	// invalid token there only means the chunk has to be lexed serially instead
+	struct SpeculationFailed {};
+
+	thread_local bool is_lexing_speculatively = false;
+
+	static Token create_token(const File& file, usize pos, usize length, TokenType type, u32 atom = 0)
 	{
-		while (true)
+		if (length > UINT16_MAX)
 		{
-			auto character = file[pos];
-
-			if (character == '\0' || character > ' ')
-				break;
+			if (is_lexing_speculatively)
+				throw SpeculationFailed();
 
-			pos += 1;
+			print_error(Snippet(file, pos, 1), "Tokens may not be longer than " + std::to_string(UINT16_MAX) + " characters.");
+			abort();
 		}
 
-		return pos;
+		return Token(file.get_location(pos), length, type, atom);
 	}
 
-	static inline bool is_identifier_char(char c)
+	// comments are skipped along with whitespace so the source never needs a separate pass to
+	// strip them and can be lexed straight from read-only memory
+	static usize get_next_pos(const File& file, usize pos)
 	{
-		switch (c)
+		const auto *src = file.src().data();
+		const auto *end = src + file.src().size();
+		const auto *iter = src + pos;
+
+		while (true)
 		{
-			case '_':
-			case 'a': case 'A':
-			case 'b': case 'B':
-			case 'c': case 'C':
-			case 'd': case 'D':
-			case 'e': case 'E':
-			case 'f': case 'F':
-			case 'g': case 'G':
-			case 'h': case 'H':
-			case 'i': case 'I':
-			case 'j': case 'J':
-			case 'k': case 'K':
-			case 'l': case 'L':
-			case 'm': case 'M':
-			case 'n': case 'N':
-			case 'o': case 'O':
-			case 'p': case 'P':
-			case 'q': case 'Q':
-			case 'r': case 'R':
-			case 's': case 'S':
-			case 't': case 'T':
-			case 'u': case 'U':
-			case 'v': case 'V':
-			case 'w': case 'W':
-			case 'x': case 'X':
-			case 'y': case 'Y':
-			case 'z': case 'Z':
-				return true;
+			iter = skip_whitespace(iter, end);
 
-			default:
-				return false;
+			// the text is always followed by a null character so looking one ahead is safe
+			if (iter[0] != '/')
+				break;
+
+			if (iter[1] == '/')
+			{
+				iter = find_line_end(iter + 2, end);
+			}
+			else if (iter[1] == '*')
+			{
+				iter = find_block_comment_end(iter + 2, end).pos;
+
+				// an unterminated comment runs to the end of the file
+				if (*iter == '*')
+					iter += 2;
+			}
+			else
+			{
+				break;
+			}
 		}
+
+		return iter - src;
 	}
 
-	static inline bool is_digit_char(char c)
+	struct Keyword
 	{
-		switch (c)
-		{
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-				return true;
+		const char *text;
+		usize length;
+		TokenType type;
+	};
 
-			default:
-				return false;
-		}
+	constexpr Keyword keywords[] =
+	{
+		{ "break", 5, TokenType::KeywordBreak },
+		{ "case", 4, TokenType::KeywordCase },
+		{ "continue", 8, TokenType::KeywordContinue },
+		{ "else", 4, TokenType::KeywordElse },
+		{ "enum", 4, TokenType::KeywordEnum },
+		{ "export", 6, TokenType::KeywordExport },
+		{ "false", 5, TokenType::KeywordFalse },
+		{ "for", 3, TokenType::KeywordFor },
+		{ "function", 8, TokenType::KeywordFunction },
+		{ "if", 2, TokenType::KeywordIf },
+		{ "import", 6, TokenType::KeywordImport },
+		{ "loop", 4, TokenType::KeywordLoop },
+		{ "match", 5, TokenType::KeywordMatch },
+		{ "mut", 3, TokenType::KeywordMut },
+		{ "private", 7, TokenType::KeywordPrivate },
+		{ "public", 6, TokenType::KeywordPublic },
+		{ "return", 6, TokenType::KeywordReturn },
+		{ "struct", 6, TokenType::KeywordStruct },
+		{ "then", 4, TokenType::KeywordThen },
+		{ "true", 4, TokenType::KeywordTrue },
+		{ "type", 4, TokenType::KeywordType },
+		{ "union", 5, TokenType::KeywordUnion },
+		{ "var", 3, TokenType::KeywordVar },
+		{ "while", 5, TokenType::KeywordWhile }
+	};
+
+	constexpr usize keyword_count = sizeof(keywords) / sizeof(*keywords);
+	constexpr usize min_keyword_length = 2;
+	constexpr usize max_keyword_length = 8;
+	constexpr u32 keyword_hash_bits = 6;
+	constexpr usize keyword_table_size = 1 << keyword_hash_bits;
+
+	// multiplicative hash over the length and the first, second and last character
+	constexpr u32 hash_keyword(const char *text, usize length, u32 seed)
+	{
+		u32 key = static_cast<u32>(static_cast<u8>(text[0]))
+			| static_cast<u32>(static_cast<u8>(text[1])) << 8
+			| static_cast<u32>(static_cast<u8>(text[length - 1])) << 16
+			| static_cast<u32>(length) << 24;
+
+		return (key * seed) >> (32 - keyword_hash_bits);
 	}
 
-	static inline bool _match_str(const char * const text, const char * const compare, const usize size)
+	constexpr bool is_perfect_keyword_seed(u32 seed)
 	{
-		for (usize i = 0; i < size; ++i)
+		bool is_taken[keyword_table_size] = {};
+
+		for (const auto& keyword : keywords)
 		{
-			if (text[i] != compare[i])
+			auto hash = hash_keyword(keyword.text, keyword.length, seed);
+
+			if (is_taken[hash])
 				return false;
+
+			is_taken[hash] = true;
 		}
 
 		return true;
 	}
 
-	#define match_str(text, compare) _match_str(text, compare, sizeof(compare))
-
-	TokenType get_identifier_type(const char *text)
+	constexpr u32 find_keyword_seed()
 	{
-		switch (text[0])
+		for (u32 seed = 0x9E3779B1; seed < 0x9E3779B1 + 100000; seed += 2)
 		{
-			case 'b':
-				if (match_str(text + 1, "reak"))
-					return TokenType::KeywordBreak;
-				break;
-
-			case 'c':
-				if (text[1] == 'a')
-				{
-					if (match_str(text + 2, "se"))
-						return TokenType::KeywordCase;
-				}
-				else if (text[1] == 'o')
-				{
-					if (match_str(text + 2, "ntinue"))
-						return TokenType::KeywordContinue;
-				}
-				break;
-
-			case 'e':
-				switch (text[1])
-				{
-					case 'l':
-						if (match_str(text + 2, "se"))
-							return TokenType::KeywordElse;
-						break;
-
-					case 'n':
-						if (match_str(text + 2, "um"))
-							return TokenType::KeywordEnum;
-						break;
-
-					case 'x':
-						if (match_str(text + 2, "port"))
-							return TokenType::KeywordExport;
-						break;
-
-					default:
-						return TokenType::Identifier;
-				}
-				break;
-
-			case 'f':
-				switch (text[1])
-				{
-					case 'a':
-						if (match_str(text + 2, "lse"))
-							return TokenType::KeywordFalse;
-						break;
-						
-					case 'o':
-						if (text[2] == 'r' && text[3] == '\0')
-							return TokenType::KeywordFor;
-						break;
-
-					case 'u':
-						if (match_str(text + 2, "nction"))
-							return TokenType::KeywordFunction;
-						break;
+			if (is_perfect_keyword_seed(seed))
+				return seed;
+		}
 
-					default:
-						return TokenType::Identifier;
-				}
-				break;
+		return 0;
+	}
 
-			case 'i':
-				if (text[1] == 'f')
-				{
-					if (text[2] == '\0')
-						return TokenType::KeywordIf;
-				}
-				else if (text[1] == 'm')
-				{
-					if (match_str(text + 2, "port"))
-						return TokenType::KeywordImport;
-				}
-				break;
+	constexpr u32 keyword_seed = find_keyword_seed();
 
-			case 'l':
-				if (match_str(text + 1, "oop"))
-					return TokenType::KeywordLoop;
-				break;
+	static_assert(keyword_seed != 0, "failed to find a perfect hash seed for the keywords");
 
-			case 'm':
-				if (text[1] == 'a')
-				{
-					if (match_str(text + 2, "tch"))
-						return TokenType::KeywordMatch;
-				}
-				else if (text[1] == 'u')
-				{
-					if (match_str(text + 2, "t"))
-						return TokenType::KeywordMut;
-				}
-				break;
+	struct KeywordTable
+	{
+		i8 indices[keyword_table_size];
+	};
 
-			case 'p':
-				if (text[1] == 'r')
-				{
-					if (match_str(text + 2, "ivate"))
-						return TokenType::KeywordPrivate;
-				}
-				else if (text[1] == 'u')
-				{
-					if (match_str(text + 2, "blic"))
-						return TokenType::KeywordPublic;
-				}
-				break;
+	constexpr KeywordTable create_keyword_table()
+	{
+		KeywordTable table = {};
 
-			case 'r':
-				if (match_str(text + 1, "eturn"))
-					return TokenType::KeywordReturn;
-				break;
+		for (usize i = 0; i < keyword_table_size; ++i)
+			table.indices[i] = -1;
 
-			case 's':
-				if (match_str(text + 1, "truct"))
-					return TokenType::KeywordStruct;
-				break;
+		for (usize i = 0; i < keyword_count; ++i)
+			table.indices[hash_keyword(keywords[i].text, keywords[i].length, keyword_seed)] = static_cast<i8>(i);
 
-			case 't':
-				switch (text[1])
-				{
-					case 'h':
-						if (match_str(text + 2, "en"))
-							return TokenType::KeywordThen;
-						break;
+		return table;
+	}
 
-					case 'r':
-						if (match_str(text + 2, "ue"))
-							return TokenType::KeywordTrue;
-						break;
+	constexpr KeywordTable keyword_table = create_keyword_table();
 
-					case 'y':
-						if (match_str(text + 2, "pe"))
-							return TokenType::KeywordType;
-						break;
+	static TokenType get_identifier_type(const char *text, usize length)
+	{
+		if (length < min_keyword_length || length > max_keyword_length)
+			return TokenType::Identifier;
 
-					default:
-						break;
-				}
-				break;
+		auto index = keyword_table.indices[hash_keyword(text, length, keyword_seed)];
 
-			case 'u':
-				if (match_str(text + 1, "nion"))
-					return TokenType::KeywordUnion;
-				break;
+		if (index < 0)
+			return TokenType::Identifier;
 
-			case 'v':
-				if (match_str(text + 1, "ar"))
-					return TokenType::KeywordVar;
-				break;
+		const auto& keyword = keywords[index];
 
-			case 'w':
-				if (match_str(text + 1, "hile"))
-					return TokenType::KeywordWhile;
-				break;
-				
-			default:
-				break;
-		}
+		if (keyword.length != length || memcmp(keyword.text, text, length))
+			return TokenType::Identifier;
 
-		return TokenType::Identifier;
+		return keyword.type;
 	}
 
 	static Token get_quote_token(const File& file, const usize start_pos)
 	{
-		char terminal_character = file[start_pos];
-		auto pos = start_pos + 1;
-
-		while (true)
-		{
-			auto current_character = file[pos]; 
-
-			if (current_character == '\0' || (current_character == terminal_character && file[pos - 1] != '\\'))
-				break;
-
-			pos += 1;
-		}
+		const auto *src = file.src().data();
+		char terminal_character = src[start_pos];
+		auto pos = find_quote_end(src + start_pos + 1, src + file.src().size(), terminal_character) - src;
 
 		auto type = terminal_character == '\''
 			? TokenType::CharLiteral
 			: TokenType::StringLiteral;
 			
-		return Token(file, start_pos, pos - start_pos, type);
+		return create_token(file, start_pos, pos - start_pos, type);
 	}
 
-	static Token get_identifier_token(const File& file, const usize start_pos)
+	static Token get_identifier_token(const File& file, const usize start_pos, InternCache *cache)
 	{
-		auto pos = start_pos + 1;
-
-		while (is_identifier_char(file[pos]) || is_digit_char(file[pos]))
-			pos += 1;
-
+		const auto *src = file.src().data();
+		auto pos = skip_identifier(src + start_pos + 1, src + file.src().size()) - src;
 		auto length = pos - start_pos;
-		
-		static char tmp_key[2048];
+		auto type = get_identifier_type(src + start_pos, length);
 
-		strncpy(tmp_key, &file.src()[start_pos], length);
-		tmp_key[length] = '\0';
+		if (type != TokenType::Identifier)
+			return create_token(file, start_pos, length, type);
 
-		auto type = get_identifier_type(tmp_key);
+		auto text = StringView(src + start_pos, length);
+		auto atom = cache != nullptr
+			? cache->intern(text)
+			: Interner::intern(text);
 
-		return Token(file, start_pos, length, type);
+		return create_token(file, start_pos, length, type, atom);
 	}
 
 	static Token get_digit_token(const File& file, const usize start_pos)
 	{
-		auto pos = start_pos;
+		const auto *src = file.src().data();
+		const auto *end = src + file.src().size();
+		const auto *pos = src + start_pos;
 		bool is_float = false;
 
 		while (true)
 		{
-			char c = file[pos];
+			pos = skip_digits(pos, end);
 
-			if (!is_digit_char(c))
-			{
-				if (c != '.')
-				{
-					break;
-				}
-
-				is_float = true;
-			}
+			if (*pos != '.')
+				break;
 
+			is_float = true;
 			pos += 1;
 		}
 
-		auto length = pos - start_pos;
+		auto length = (pos - src) - start_pos;
 
 		auto type = is_float
 			? TokenType::FloatLiteral
 			: TokenType::IntegerLiteral;
 
-		return Token(file, start_pos, length, type);
+		return create_token(file, start_pos, length, type);
 	}
 
-	static Token get_next_token(const File& file, usize start_pos)
+	// identifiers are interned through the cache if one is given
+	static Token get_next_token(const File& file, usize start_pos, InternCache *cache = nullptr)
 	{
 		switch (file[start_pos])
 		{
 			case '\0':
-				return Token(file, start_pos, 0, TokenType::EndOfFile);
+				return create_token(file, start_pos, 0, TokenType::EndOfFile);
 
 			case '_':
 			case 'a': case 'A':
@@ -372,7 +289,7 @@ namespace warbler
 			case 'x': case 'X':
 			case 'y': case 'Y':
 			case 'z': case 'Z':
-				return get_identifier_token(file, start_pos);
+				return get_identifier_token(file, start_pos, cache);
 
 			case '0':
 			case '1':
@@ -388,35 +305,35 @@ namespace warbler
 			
 			// Separators
 			case '(':
-				return Token(file, start_pos, 1, TokenType::LeftParenthesis);
+				return create_token(file, start_pos, 1, TokenType::LeftParenthesis);
 
 			case ')':
-				return Token(file, start_pos, 1, TokenType::RightParenthesis);
+				return create_token(file, start_pos, 1, TokenType::RightParenthesis);
 
 			case '[':
-				return Token(file, start_pos, 1, TokenType::LeftBracket);
+				return create_token(file, start_pos, 1, TokenType::LeftBracket);
 
 			case ']':
-				return Token(file, start_pos, 1, TokenType::RightBracket);
+				return create_token(file, start_pos, 1, TokenType::RightBracket);
 
 			case '{':
-				return Token(file, start_pos, 1, TokenType::LeftBrace);
+				return create_token(file, start_pos, 1, TokenType::LeftBrace);
 
 			case '}':
-				return Token(file, start_pos, 1, TokenType::RightBrace);
+				return create_token(file, start_pos, 1, TokenType::RightBrace);
 
 			case ',':
-				return Token(file, start_pos, 1, TokenType::Comma);
+				return create_token(file, start_pos, 1, TokenType::Comma);
 
 			case ';':
-				return Token(file, start_pos, 1, TokenType::Semicolon);
+				return create_token(file, start_pos, 1, TokenType::Semicolon);
 
 			case ':':
 				if (file[start_pos + 1] == ':')
 				{
-					return Token(file, start_pos, 1, TokenType::Semicolon);
+					return create_token(file, start_pos, 1, TokenType::Semicolon);
 				}
-				return Token(file, start_pos, 1, TokenType::Colon);
+				return create_token(file, start_pos, 1, TokenType::Colon);
 
 			case '.':
 				switch (file[start_pos + 1])
@@ -436,12 +353,12 @@ namespace warbler
 					case '.':
 						if (file[start_pos + 2] == '.')
 						{
-							return Token(file, start_pos, 3, TokenType::Elipsis);
+							return create_token(file, start_pos, 3, TokenType::Elipsis);
 						}
-						return Token(file, start_pos, 2, TokenType::Range);
+						return create_token(file, start_pos, 2, TokenType::Range);
 					
 					default:
-						return Token(file, start_pos, 1, TokenType::Dot);
+						return create_token(file, start_pos, 1, TokenType::Dot);
 				}
 
 			// Operators
@@ -450,121 +367,124 @@ namespace warbler
 				{
 					if (file[start_pos + 2] == '=')
 					{
-						return Token(file, start_pos, 3, TokenType::LeftBitShiftAssign);
+						return create_token(file, start_pos, 3, TokenType::LeftBitShiftAssign);
 					}
-					return Token(file, start_pos, 2, TokenType::LeftBitShift);
+					return create_token(file, start_pos, 2, TokenType::LeftBitShift);
 				}
 				else if (file[start_pos + 1] == '=')
 				{
-					return Token(file, start_pos, 2, TokenType::LessThanOrEqualTo);
+					return create_token(file, start_pos, 2, TokenType::LessThanOrEqualTo);
 				}
-				return Token(file, start_pos, 1, TokenType::LessThan);
+				return create_token(file, start_pos, 1, TokenType::LessThan);
 
 			case '>':
 				if (file[start_pos + 1] == '>')
 				{
 					if (file[start_pos + 2] == '=')
 					{
-						return Token(file, start_pos, 3, TokenType::RightBitShiftAssign);
+						return create_token(file, start_pos, 3, TokenType::RightBitShiftAssign);
 					}
-					return Token(file, start_pos, 2, TokenType::RightBitShift);
+					return create_token(file, start_pos, 2, TokenType::RightBitShift);
 				}
 				else if (file[start_pos + 1] == '=')
 				{
-					return Token(file, start_pos, 2, TokenType::GreaterThanOrEqualTo);
+					return create_token(file, start_pos, 2, TokenType::GreaterThanOrEqualTo);
 				}
-				return Token(file, start_pos, 1, TokenType::GreaterThan);
+				return create_token(file, start_pos, 1, TokenType::GreaterThan);
 
 			case '%':
 				return file[start_pos + 1] == '='
-					? Token(file, start_pos, 2, TokenType::ModulusAssign)
-					: Token(file, start_pos, 1, TokenType::Modulus);
+					? create_token(file, start_pos, 2, TokenType::ModulusAssign)
+					: create_token(file, start_pos, 1, TokenType::Modulus);
 
 			case '^':
 				return file[start_pos + 1] == '='
-					? Token(file, start_pos, 2, TokenType::BitwiseXorAssign)
-					: Token(file, start_pos, 1, TokenType::BitwiseXor);
+					? create_token(file, start_pos, 2, TokenType::BitwiseXorAssign)
+					: create_token(file, start_pos, 1, TokenType::BitwiseXor);
 				
 			case '&':
 				if (file[start_pos + 1] == '&')
 				{
 					if (file[start_pos + 2] == '=')
 					{
-						return Token(file, start_pos, 3, TokenType::BooleanAndAssign);
+						return create_token(file, start_pos, 3, TokenType::BooleanAndAssign);
 					}
-					return Token(file, start_pos, 2, TokenType::BooleanAnd);
+					return create_token(file, start_pos, 2, TokenType::BooleanAnd);
 				}
 				else if (file[start_pos + 1] == '=')
 				{
-					return Token(file, start_pos, 2, TokenType::BitwiseAndAssign);
+					return create_token(file, start_pos, 2, TokenType::BitwiseAndAssign);
 				}
-				return Token(file, start_pos, 1, TokenType::Ampersand);
+				return create_token(file, start_pos, 1, TokenType::Ampersand);
 
 			case '*':
 				return file[start_pos + 1] == '='
-					? Token(file, start_pos, 2, TokenType::MultiplyAssign)
-					: Token(file, start_pos, 1, TokenType::Asterisk);
+					? create_token(file, start_pos, 2, TokenType::MultiplyAssign)
+					: create_token(file, start_pos, 1, TokenType::Asterisk);
 
 			case '-':
 				if (file[start_pos + 1] == '=')
 				{
-					return Token(file, start_pos, 2, TokenType::SubtractAssign);
+					return create_token(file, start_pos, 2, TokenType::SubtractAssign);
 				}
 				else if (file[start_pos + 1] == '>')
 				{
-					return Token(file, start_pos, 2, TokenType::SingleArrow);
+					return create_token(file, start_pos, 2, TokenType::SingleArrow);
 				}
-				return Token(file, start_pos, 1, TokenType::Minus);
+				return create_token(file, start_pos, 1, TokenType::Minus);
 
 			case '=':
 				if (file[start_pos + 1] == '=')
 				{
-					return Token(file, start_pos, 2, TokenType::Equals);
+					return create_token(file, start_pos, 2, TokenType::Equals);
 				}
 				else if (file[start_pos + 1] == '>')
 				{
-					return Token(file, start_pos, 2, TokenType::DoubleArrow);
+					return create_token(file, start_pos, 2, TokenType::DoubleArrow);
 				}
-				return Token(file, start_pos, 1, TokenType::Assign);
+				return create_token(file, start_pos, 1, TokenType::Assign);
 
 			case '|':
 				if (file[start_pos + 1] == '|')
 				{
 					if (file[start_pos + 2] == '=')
 					{
-						return Token(file, start_pos, 3, TokenType::BooleanOrAssign);
+						return create_token(file, start_pos, 3, TokenType::BooleanOrAssign);
 					}
-					return Token(file, start_pos, 2, TokenType::BooleanOr);
+					return create_token(file, start_pos, 2, TokenType::BooleanOr);
 				}
 				else if (file[start_pos + 1] == '=')
 				{
-					return Token(file, start_pos, 2, TokenType::BitwiseOrAssign);
+					return create_token(file, start_pos, 2, TokenType::BitwiseOrAssign);
 				}
-				return Token(file, start_pos, 1, TokenType::Pipeline);
+				return create_token(file, start_pos, 1, TokenType::Pipeline);
 
 			case '+':
 				return file[start_pos + 1] == '='
-					? Token(file, start_pos, 2, TokenType::AddAssign)
-					: Token(file, start_pos, 1, TokenType::Plus);
+					? create_token(file, start_pos, 2, TokenType::AddAssign)
+					: create_token(file, start_pos, 1, TokenType::Plus);
 
 			case '?':
-				return Token(file, start_pos, 1, TokenType::Question);
+				return create_token(file, start_pos, 1, TokenType::Question);
 
 			case '!':
 				return file[start_pos + 1] == '='
-					? Token(file, start_pos, 2, TokenType::NotEquals)
-					: Token(file, start_pos, 1, TokenType::BooleanNot);
+					? create_token(file, start_pos, 2, TokenType::NotEquals)
+					: create_token(file, start_pos, 1, TokenType::BooleanNot);
 
 			case '/':
 				return file[start_pos + 1] == '='
-					? Token(file, start_pos, 2, TokenType::DivideAssign)
-					: Token(file, start_pos, 1, TokenType::Slash);
+					? create_token(file, start_pos, 2, TokenType::DivideAssign)
+					: create_token(file, start_pos, 1, TokenType::Slash);
 
 			case '\'':
 			case '\"':
 				return get_quote_token(file, start_pos);
 
 			default:
+				if (is_lexing_speculatively)
+					throw SpeculationFailed();
+
 				print_error(Snippet(file, start_pos, 1), "An invalid character was found in the text file: '" + file.get_text(start_pos, 1) + "'.");
 				abort();
 		}
@@ -572,10 +492,10 @@ namespace warbler
 
 	void Token::increment()
 	{
-		auto next_token_pos = get_next_pos(_file, _pos + _length);
-		auto next_token = get_next_token(_file, next_token_pos);
+		const auto& file = this->file();
+		auto next_token_pos = get_next_pos(file, file.get_pos(_location) + _length);
 
-		new (this) auto(next_token);
+		*this = get_next_token(file, next_token_pos);
 	}
 
 	Token Token::get_initial(const File& file)
@@ -585,6 +505,233 @@ namespace warbler
 		return get_next_token(file, pos);
 	}
 
+	TokenBuffer::TokenBuffer(const File& file) :
+	_file(&file)
+	{}
+
+	void TokenBuffer::reserve(usize count)
+	{
+		_types.reserve(count);
+		_locations.reserve(count);
+		_lengths.reserve(count);
+		_atoms.reserve(count);
+	}
+
+	void TokenBuffer::push(const Token& token)
+	{
+		_types.push_back(token.type());
+		_locations.push_back(token.location());
+		_lengths.push_back(static_cast<u16>(token.length()));
+		_atoms.push_back(token.type() == TokenType::Identifier ? token.atom() : 0);
+	}
+
+	void TokenBuffer::append(const TokenBuffer& other, usize first)
+	{
+		_types.insert(_types.end(), other._types.begin() + first, other._types.end());
+		_locations.insert(_locations.end(), other._locations.begin() + first, other._locations.end());
+		_lengths.insert(_lengths.end(), other._lengths.begin() + first, other._lengths.end());
+		_atoms.insert(_atoms.end(), other._atoms.begin() + first, other._atoms.end());
+	}
+
+	void TokenBuffer::lex_chunk(usize pos, usize end, InternCache& cache)
+	{
+		const auto& file = *_file;
+
+		pos = get_next_pos(file, pos);
+
+		while (pos < end)
+		{
+			auto token = get_next_token(file, pos, &cache);
+
+			push(token);
+
+			if (token.type() == TokenType::EndOfFile)
+				break;
+
+			pos = get_next_pos(file, pos + token.length());
+		}
+	}
+
+	TokenBuffer TokenBuffer::lex(const File& file)
+	{
+		TokenBuffer buffer(file);
+
+		// rough guess of one token per 4 bytes of source
+		auto estimated_token_count = file.src().size() / 4 + 1;
+
+		buffer.reserve(estimated_token_count);
+
+		// lexing directly against the file instead of through Token::increment avoids
+		// looking the file up in the source manager for every token
+		InternCache cache;
+
+		buffer.lex_chunk(0, file.src().size() + 1, cache);
+
+		return buffer;
+	}
+
+	TokenBuffer TokenBuffer::lex_parallel(const File& file, usize chunk_count)
+	{
+		// smaller chunks cost more to start a thread for than they save
+		static const usize min_chunk_size = 256 * 1024;
+
+		const auto *src = file.src().data();
+		auto size = file.src().size();
+
+		if (chunk_count == 0)
+			chunk_count = std::min<usize>(std::thread::hardware_concurrency(), size / min_chunk_size);
+
+		if (chunk_count < 2)
+			return lex(file);
+
+		// chunks start at the beginning of a line, where the lexer is most likely to be in
+		// between tokens. the last chunk ends after the file so it includes end of file.
+		Array<usize> bounds = { 0 };
+
+		for (usize i = 1; i < chunk_count; ++i)
+		{
+			auto pos = static_cast<usize>(find_line_end(src + size * i / chunk_count, src + size) - src);
+
+			if (pos < size)
+				pos += 1;
+
+			if (pos > bounds.back() && pos < size)
+				bounds.push_back(pos);
+		}
+
+		bounds.push_back(size + 1);
+		chunk_count = bounds.size() - 1;
+
+		Array<TokenBuffer> chunks(chunk_count, TokenBuffer(file));
+		Array<std::thread> threads;
+
+		threads.reserve(chunk_count - 1);
+
+		for (usize i = 1; i < chunk_count; ++i)
+		{
+			threads.emplace_back([&, i]()
+			{
+				InternCache cache;
+
+				is_lexing_speculatively = true;
+				chunks[i].reserve((bounds[i + 1] - bounds[i]) / 4 + 1);
+
+				try
+				{
+					chunks[i].lex_chunk(bounds[i], bounds[i + 1], cache);
+				}
+				catch (const SpeculationFailed&)
+				{
+					// the tokens lexed so far are still usable, the rest is lexed serially
+				}
+
+				is_lexing_speculatively = false;
+			});
+		}
+
+		// the first chunk starts at the beginning of the file so it is never wrong
+		InternCache cache;
+
+		chunks[0].reserve(bounds[1] / 4 + 1);
+		chunks[0].lex_chunk(0, bounds[1], cache);
+
+		for (auto& thread : threads)
+			thread.join();
+
+		TokenBuffer buffer(file);
+		usize token_count = 0;
+
+		for (const auto& chunk : chunks)
+			token_count += chunk.size();
+
+		buffer.reserve(token_count);
+
+		auto pos = get_next_pos(file, 0);
+
+		for (usize i = 0; i < chunk_count; ++i)
+		{
+			const auto& chunk = chunks[i];
+			usize index = 0;
+
+			while (pos < bounds[i + 1])
+			{
+				while (index < chunk.size() && chunk.pos(index) < pos)
+					index += 1;
+
+				// once the serial position lands on the start of a token in the chunk, the
+				// rest of the chunk was lexed from the same state and can be reused as is
+				if (index < chunk.size() && chunk.pos(index) == pos)
+				{
+					buffer.append(chunk, index);
+					index = chunk.size();
+
+					if (buffer._types.back() == TokenType::EndOfFile)
+						return buffer;
+
+					pos = get_next_pos(file, buffer.pos(buffer.size() - 1) + buffer.length(buffer.size() - 1));
+					continue;
+				}
+
+				// the chunk started inside of a comment or literal
+				auto token = get_next_token(file, pos, &cache);
+
+				buffer.push(token);
+
+				if (token.type() == TokenType::EndOfFile)
+					return buffer;
+
+				pos = get_next_pos(file, pos + token.length());
+			}
+		}
+
+		return buffer;
+	}
+
+	TokenBuffer TokenBuffer::lex_until(const File& file, usize pos, const Array<usize>& boundaries)
+	{
+		TokenBuffer buffer(file);
+		InternCache cache;
+		auto boundary = boundaries.begin();
+
+		pos = get_next_pos(file, pos);
+
+		while (true)
+		{
+			while (boundary != boundaries.end() && *boundary < pos)
+				++boundary;
+
+			if (boundary != boundaries.end() && *boundary == pos)
+			{
+				buffer.push(create_token(file, pos, 0, TokenType::EndOfFile));
+				return buffer;
+			}
+
+			auto token = get_next_token(file, pos, &cache);
+
+			buffer.push(token);
+
+			if (token.type() == TokenType::EndOfFile)
+				return buffer;
+
+			pos = get_next_pos(file, pos + token.length());
+		}
+	}
+
+	TokenBuffer TokenBuffer::lex_range(const File& file, usize pos, usize end)
+	{
+		assert(end <= file.src().size());
+
+		TokenBuffer buffer(file);
+		InternCache cache;
+
+		buffer.lex_chunk(pos, end, cache);
+
+		if (buffer.size() == 0 || buffer._types.back() != TokenType::EndOfFile)
+			buffer.push(create_token(file, end, 0, TokenType::EndOfFile));
+
+		return buffer;
+	}
+
 	const char *Token::category() const 
 	{
 		switch (_type)
@@ -706,14 +853,40 @@ namespace warbler
 		return String(category()) + " '" + text() + '\'';
 	}
 
+	String Token::text() const
+	{
+		const auto& file = this->file();
+
+		return file.get_text(file.get_pos(_location), _length);
+	}
+
+	StringView Token::view() const
+	{
+		const auto& file = this->file();
+
+		return file.get_view(file.get_pos(_location), _length);
+	}
+
+	char Token::operator[](usize i) const
+	{
+		assert(i < _length);
+
+		const auto& file = this->file();
+
+		return file[file.get_pos(_location) + i];
+	}
+
 	bool Token::operator==(const String& text) const
 	{
 		if (text.size() != _length)
 			return false;
 
+		const auto& file = this->file();
+		auto pos = file.get_pos(_location);
+
 		for (usize i = 0; i < _length; ++i)
 		{
-			if (_file[_pos + i] != text[i])
+			if (file[pos + i] != text[i])
 				return false;
 		}
 
@@ -0,0 +1,115 @@
+#include <warbler/type_interner.hpp>
+
+#include <warbler/context.hpp>
+#include <warbler/util/array.hpp>
+#include <warbler/util/flat_map.hpp>
+#include <cassert>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+
+namespace warbler
+{
+	struct TypeKeyHash
+	{
+		u64 operator()(u64 key) const { return key * 0x9e3779b97f4a7c15ull; }
+	};
+
+	struct TypeStore
+	{
+		std::shared_mutex mutex;
+		Array<TypeData> types;
+		FlatMap<u64, u32, TypeKeyHash> ids;
+
+		TypeStore();
+	};
+
+	// the low bits tell base types and pointers apart, the rest is the struct index or pointee
+	static u64 get_base_key(AnnotationType type, usize index)
+	{
+		return (static_cast<u64>(index) << 2) | (type == AnnotationType::Struct ? 1 : 0);
+	}
+
+	static u64 get_pointer_key(u32 pointee, bool is_mutable)
+	{
+		return (static_cast<u64>(pointee) << 2) | 2 | (is_mutable ? 1 : 0);
+	}
+
+	TypeStore::TypeStore()
+	{
+		for (usize i = 0; i < primitive_count; ++i)
+		{
+			types.push_back(TypeData { static_cast<u32>(i), 0, 0, AnnotationType::Primitive, false });
+			ids.emplace(get_base_key(AnnotationType::Primitive, i), static_cast<u32>(i));
+		}
+	}
+
+	static TypeStore store;
+
+	static u32 add_type(u64 key, const TypeData& data)
+	{
+		{
+			std::shared_lock lock(store.mutex);
+
+			auto iter = store.ids.find(key);
+
+			if (iter != store.ids.end())
+				return iter->second;
+		}
+
+		std::unique_lock lock(store.mutex);
+
+		if (store.types.size() > UINT32_MAX)
+			throw std::runtime_error("Number of distinct types exceeds the maximum of 4294967296.");
+
+		// another thread may have interned the type while the lock was released
+		auto result = store.ids.emplace(key, static_cast<u32>(store.types.size()));
+
+		if (result.second)
+			store.types.push_back(data);
+
+		return result.first->second;
+	}
+
+	u32 TypeInterner::intern(AnnotationType type, usize index)
+	{
+		// primitives are interned up front and every annotation of them is looked up
+		if (type == AnnotationType::Primitive)
+		{
+			assert(index < primitive_count);
+			return static_cast<u32>(index);
+		}
+
+		if (index > UINT32_MAX)
+			throw std::runtime_error("Struct index exceeds the maximum of 4294967295.");
+
+		return add_type(get_base_key(type, index), TypeData { static_cast<u32>(index), 0, 0, type, false });
+	}
+
+	u32 TypeInterner::intern_pointer(u32 pointee, bool is_mutable)
+	{
+		auto data = get(pointee);
+
+		data.pointee = pointee;
+		data.ptr_depth += 1;
+		data.is_mutable = is_mutable;
+
+		return add_type(get_pointer_key(pointee, is_mutable), data);
+	}
+
+	TypeData TypeInterner::get(u32 id)
+	{
+		std::shared_lock lock(store.mutex);
+
+		assert(id < store.types.size());
+
+		return store.types[id];
+	}
+
+	usize TypeInterner::size()
+	{
+		std::shared_lock lock(store.mutex);
+
+		return store.types.size();
+	}
+}
@@ -6,8 +6,93 @@
 // standard library
 #include <cstdio>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace warbler
 {
+	MappedFile::MappedFile(char *data, usize size, usize mapping_size) :
+	_data(data),
+	_size(size),
+	_mapping_size(mapping_size)
+	{}
+
+	MappedFile::MappedFile() :
+	_data(nullptr),
+	_size(0),
+	_mapping_size(0)
+	{}
+
+	MappedFile::MappedFile(MappedFile&& other) :
+	_data(other._data),
+	_size(other._size),
+	_mapping_size(other._mapping_size)
+	{
+		other._data = nullptr;
+		other._size = 0;
+		other._mapping_size = 0;
+	}
+
+	MappedFile::~MappedFile()
+	{
+#ifndef _WIN32
+		if (_data)
+			munmap(_data, _mapping_size);
+#endif
+	}
+
+	Result<MappedFile> MappedFile::map(const String& filepath)
+	{
+#ifdef _WIN32
+		// memory mapping is not implemented for windows, the caller will fall back to reading
+		return {};
+#else
+		int fd = open(filepath.c_str(), O_RDONLY);
+
+		if (fd == -1)
+			return {};
+
+		struct stat info;
+
+		if (fstat(fd, &info) || !S_ISREG(info.st_mode) || info.st_size <= 0)
+		{
+			close(fd);
+			return {};
+		}
+
+		auto size = static_cast<usize>(info.st_size);
+		auto page_size = static_cast<usize>(sysconf(_SC_PAGESIZE));
+		// always leave room for a zeroed page or page tail after the text
+		auto mapping_size = (size / page_size + 1) * page_size;
+
+		// reserving anonymous zeroed pages and placing the file over the start of them means
+		// the byte after the text is readable even when the file ends on a page boundary
+		auto *reservation = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (reservation == MAP_FAILED)
+		{
+			close(fd);
+			return {};
+		}
+
+		auto *mapping = mmap(reservation, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+
+		close(fd);
+
+		if (mapping == MAP_FAILED)
+		{
+			munmap(reservation, mapping_size);
+			return {};
+		}
+
+		return MappedFile(static_cast<char*>(mapping), size, mapping_size);
+#endif
+	}
+
 	Result<String> read_from_file(FILE *file)
 	{
 		if (fseek(file, 0, SEEK_END))
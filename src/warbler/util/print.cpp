@@ -26,6 +26,7 @@ namespace warbler
 {
 	std::ostream& output_stream = std::cout;
 	static bool is_color_enabled = true;
+	thread_local String *captured_text = nullptr;
 
 	enum class LogLevel
 	{
@@ -165,11 +166,11 @@ namespace warbler
 
 		String highlight;
 		
-		usize line_number_width = get_number_width(snippet.line() + snippet.lines().size() - 1);
+		usize line_number_width = get_number_width(snippet.line() + snippet.lines().size());
 
 		highlight.reserve(length * 3);
 
-		usize current_line_number = snippet.line();
+		usize current_line_number = snippet.line() + 1;
 
 		for (const auto& line : snippet.lines())
 		{
@@ -259,20 +260,53 @@ namespace warbler
 		print_error(token, "Expected " + expected + ", found " + String(token.category()) + " '" + token.text() + "'. " + msg);
 	}
 
+	DiagnosticCapture::DiagnosticCapture() :
+	_previous(captured_text)
+	{
+		captured_text = &_text;
+	}
+
+	DiagnosticCapture::~DiagnosticCapture()
+	{
+		captured_text = _previous;
+	}
+
+	static void write_output(const String& text)
+	{
+		if (captured_text != nullptr)
+		{
+			*captured_text += text;
+			return;
+		}
+
+		output_stream << text;
+	}
+
+	void print_captured(const String& text)
+	{
+		write_output(text);
+	}
+
+	static String get_message(const LogContext& context, const String& msg)
+	{
+		return String(context.color()) + context.prompt() + context.reset() + msg + '\n';
+	}
+
 	static inline void print_message(const LogContext& context, const String& msg)
 	{
-		output_stream << context.color() << context.prompt() << context.reset() << msg << '\n';
+		write_output(get_message(context, msg));
 	}
 
 	static void print_message(LogLevel level, const Snippet& snippet, const String& msg)
 	{
-		output_stream << snippet.filename() << ':' << snippet.line() + 1 << ':' << snippet.start_col() + 1 << ' ';
-
 		auto context = get_log_context(level);
+		auto text = snippet.filename() + ':' + std::to_string(snippet.line() + 1) + ':' + std::to_string(snippet.start_col() + 1) + ' ';
 
-		print_message(context, msg);
+		text += get_message(context, msg);
+		text += get_snippet_highlight(snippet, context);
 
-		output_stream << get_snippet_highlight(snippet, context);
+		// written at once so messages from different threads do not interleave
+		write_output(text);
 	}
 
 	void print_note(const Snippet& snippet, const String& msg)
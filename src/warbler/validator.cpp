@@ -1,19 +1,23 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
 #include <stdexcept>
 #include <warbler/validator.hpp>
 #include <warbler/util/print.hpp>
+#include <warbler/util/parallel.hpp>
 
 namespace warbler
 {
 	Result<ExpressionContext> validate_expression(const ExpressionSyntax& syntax, FunctionSymbolTable& symbols);
 
-	Result<TypeAnnotationContext> validate_type_annotation(const TypeAnnotationSyntax& syntax, GlobalSymbolTable& symbol_table)
+	Result<TypeAnnotationContext> validate_type_annotation(const TypeAnnotationSyntax& syntax, GlobalSymbolTable& symbol_table, u32 scope)
 	{
-		auto name = syntax.name().text();
-		auto *symbol = symbol_table.resolve(name);
+		auto *symbol = symbol_table.resolve(scope, syntax.name().atom());
 
 		if (symbol == nullptr)	// couldn't find symbol in context tree
 		{
-			print_error(syntax.name(), "The type '" + symbol->symbol() + "' does not exist this scope.");
+			print_error(syntax.name(), "The type '" + syntax.name().text() + "' does not exist this scope.");
 			return {};
 		}
 
@@ -35,90 +39,118 @@ namespace warbler
 			default:
 				print_error(syntax.name(), "Expected type name, found "
 					+ get_symbol_type_name(symbol->type())
-					+ " '" + name + "'.");
+					+ " '" + syntax.name().text() + "'.");
 				return {};
 		}
 
-		return TypeAnnotationContext(Array<bool>(), type, symbol->index());
+		auto id = TypeInterner::intern(type, symbol->index());
+		const auto& ptrs = syntax.ptrs();
+
+		// the first pointer is the outermost one
+		for (auto i = ptrs.size(); i-- > 0;)
+			id = TypeInterner::intern_pointer(id, ptrs[i].is_mutable);
+
+		return TypeAnnotationContext(id);
 	}
 
-	Result<MemberContext> validate_struct_member(const MemberSyntax& syntax, GlobalSymbolTable& globals, Array<String>& containing_types)
+	// structs are validated after the structs they are made of, so their layout is known
+	static TypeLayout get_type_layout(const TypeAnnotationContext& type_annotation, const Array<const StructContext *>& structs)
 	{
-		auto name = syntax.name().text();
-		auto type_name = syntax.type().name().text();
-		auto *symbol = globals.resolve(type_name);
+		auto type = TypeInterner::get(type_annotation.id());
+
+		if (type.ptr_depth > 0)
+			return TypeLayout { sizeof(void *), alignof(void *) };
 
-		if (symbol != nullptr)
+		switch (type.type)
 		{
-			if (symbol->type() == SymbolType::Struct && symbol->is_not_yet_validated())
+			case AnnotationType::Primitive:
 			{
-				if (!validate_struct(symbol->struct_syntax(), globals, containing_types))
-					return {};
+				const auto& primitive = primitives[type.index];
+
+				assert(!primitive.is_literal());
+
+				return TypeLayout { primitive.size(), primitive.size() };
 			}
+
+			case AnnotationType::Struct:
+				assert(structs[type.index] != nullptr);
+				return structs[type.index]->layout();
+
+			default:
+				break;
 		}
 
-		auto type_annotation = validate_type_annotation(syntax.type(), globals);
+		throw std::invalid_argument("Invalid type given to get_type_layout");
+	}
+
+	Result<MemberContext> validate_struct_member(const MemberSyntax& syntax, GlobalSymbolTable& globals, u32 scope, const Array<const StructContext *>& structs)
+	{
+		auto type_annotation = validate_type_annotation(syntax.type(), globals, scope);
 
 		if (!type_annotation)
 			return {};
 
-		return MemberContext(syntax.name().text(), type_annotation.unwrap(), syntax.is_public());
+		auto type = type_annotation.unwrap();
+		auto data = TypeInterner::get(type.id());
+
+		// a struct that failed to validate has already been reported
+		if (data.ptr_depth == 0 && data.type == AnnotationType::Struct && structs[data.index] == nullptr)
+			return {};
+
+		return MemberContext(syntax.name().atom(), type, get_type_layout(type, structs), syntax.is_public());
 	}
 
-	bool validate_struct(const StructSyntax& syntax, GlobalSymbolTable& symbols, Array<String>& containing_types)
+	Result<StructContext> validate_struct(const SymbolData& data, GlobalSymbolTable& globals, u32 scope, const Array<const StructContext *>& structs)
 	{
-		auto identifier = syntax.name().text();
-		auto symbol = symbols.get_symbol(identifier);
+		const auto& syntax = data.struct_syntax();
 		bool success = true;
 
-		containing_types.push_back(symbol);
-
-		Table<MemberContext> members;
+		StructContext context(data.symbol(), syntax.members().size());
 
 		for (const auto& member_syntax : syntax.members())
 		{
-			auto res = validate_struct_member(member_syntax, symbols, containing_types);
+			auto res = validate_struct_member(member_syntax, globals, scope, structs);
 
-			success = success && res;
-
-			auto member = res.unwrap();
-			auto result = members.emplace(member.name(), std::move(member));
-
-			success = success && result.second;
-
-			if (!result.second)
+			if (!res)
 			{
-				print_error(syntax.name(), "A member with name '" + member.name() + "' is already declared in struct '" + symbol + "'.");
-				// TODO: Show previous declaration
+				success = false;
+				continue;
 			}
-		}
 
-		containing_types.pop_back();
+			switch (context.add_member(res.unwrap()))
+			{
+				case MemberAddition::Added:
+					break;
 
-		auto& data = symbols.get(symbol);
+				case MemberAddition::AlreadyDeclared:
+					print_error(syntax.name(), "A member with name '" + member_syntax.name().text() + "' is already declared in struct '" + String(data.symbol_text()) + "'.");
+					// TODO: Show previous declaration
+					success = false;
+					break;
 
-		if (success)
-		{
-			auto index = symbols.add_validated_struct(StructContext(std::move(symbol), std::move(members)));
+				case MemberAddition::TooLarge:
+					print_error(member_syntax.name(), "Struct '" + String(data.symbol_text()) + "' would be larger than the maximum of 4294967295 bytes with this member.");
+					return {};
 
-			data.validate(index);
-		}
-		else
-		{
-			data.invalidate();
+				default:
+					throw std::runtime_error("Invalid member addition");
+			}
 		}
 
-		return success;
+		if (!success)
+			return {};
+
+		return context;
 	}
 
 	Result<ParameterContext> validate_parameter(const ParameterSyntax& syntax, FunctionSymbolTable& symbols)
 	{
-		auto type = validate_type_annotation(syntax.type(), symbols.globals());
+		auto type = validate_type_annotation(syntax.type(), symbols.globals(), symbols.scope());
 
 		if (!type)
 			return {};
 
-		return ParameterContext(syntax.name().text(), type.unwrap(), syntax.is_mutable());
+		return ParameterContext(syntax.name().atom(), type.unwrap(), syntax.is_mutable());
 	}
 
 	Result<FunctionSignatureContext> validate_function_signature(const FunctionSignatureSyntax& syntax, FunctionSymbolTable& symbols)
@@ -154,7 +186,7 @@ namespace warbler
 
 		if (syntax.return_type().has_value())
 		{
-			auto res = validate_type_annotation(syntax.return_type().value(), symbols.globals());
+			auto res = validate_type_annotation(syntax.return_type().value(), symbols.globals(), symbols.scope());
 
 			success = success && res;
 
@@ -197,18 +229,17 @@ namespace warbler
 
 	Result<ExpressionContext> validate_symbol(const SymbolSyntax& syntax, FunctionSymbolTable& symbols)
 	{
-		auto symbol = syntax.token().text();
-		auto *symbol_data = symbols.resolve(symbol);
+		auto *symbol_data = symbols.resolve(syntax.token().atom());
 
 		if (!symbol_data)
 		{
-			print_error(syntax.token(), "The symbol '" + symbol + "' could not be found in this scope.");
+			print_error(syntax.token(), "The symbol '" + syntax.token().text() + "' could not be found in this scope.");
 			return {};
 		}
 
 		if (symbol_data->type() == SymbolType::Package)
 		{
-			print_error("Expected valid symbol, got package '" + symbol_data->symbol() + "'.");
+			print_error("Expected valid symbol, got package '" + String(symbol_data->symbol_text()) + "'.");
 			return {};
 		}
 
@@ -274,7 +305,7 @@ namespace warbler
 			return symbol_data;
 		}
 			
-		auto type = validate_type_annotation(syntax.type(), symbols.globals());
+		auto type = validate_type_annotation(syntax.type(), symbols.globals(), symbols.scope());
 
 		if (!type)
 		{
@@ -380,12 +411,9 @@ namespace warbler
 		}
 	}
 
-	bool validate_function(const FunctionSyntax& syntax, GlobalSymbolTable& globals)
+	static Result<FunctionContext> validate_function(const FunctionSyntax& syntax, u32 symbol, GlobalSymbolTable& globals, u32 scope)
 	{
-		auto name = syntax.name().text();
-		auto symbol = globals.get_symbol(name);
-
-		FunctionSymbolTable symbols(globals);
+		FunctionSymbolTable symbols(globals, scope);
 
 		auto success = true;
 		auto signature = validate_function_signature(syntax.signature(), symbols);
@@ -393,6 +421,12 @@ namespace warbler
 		if (!signature)
 			success = false;
 
+		if (!syntax.is_body_parsed())
+		{
+			print_error(syntax.name(), "The body of function '" + syntax.name().text() + "' was skipped while parsing.");
+			return {};
+		}
+
 		auto body = validate_block_statement(syntax.body(), symbols);
 
 		if (!body)
@@ -401,18 +435,375 @@ namespace warbler
 		if (!success)
 			return {};
 
-		auto& data = globals.get(symbol);
-		auto index = globals.add_validated_function(FunctionContext(std::move(symbol), signature.unwrap(), body.unwrap()));
+		return FunctionContext(symbol, signature.unwrap(), body.unwrap());
+	}
+
+	struct FunctionValidation
+	{
+		const FunctionSyntax *syntax;
+		u32 symbol;
+		u32 scope;
+	};
+
+	struct StructValidation
+	{
+		SymbolData *data;
+		u32 scope;
+	};
+
+	// Each struct depends on the structs its members are, which have to be validated first.
+	// Pointers do not need the layout of the struct they point to, so they are not edges.
+	// Edges of struct i are edges[edge_starts[i]] up to edges[edge_starts[i + 1]].
+	struct StructGraph
+	{
+		Array<u32> edge_starts;
+		Array<u32> edges;
+	};
 
-		data.validate(index);
+	static StructGraph get_struct_graph(const Array<StructValidation>& structs, GlobalSymbolTable& globals)
+	{
+		AtomTable<u32> nodes;
+		StructGraph graph;
 
-		return true;
+		for (usize i = 0; i < structs.size(); ++i)
+			nodes.emplace(structs[i].data->symbol(), static_cast<u32>(i));
+
+		graph.edge_starts.reserve(structs.size() + 1);
+
+		for (const auto& type : structs)
+		{
+			graph.edge_starts.push_back(static_cast<u32>(graph.edges.size()));
+
+			for (const auto& member : type.data->struct_syntax().members())
+			{
+				auto *symbol = globals.resolve(type.scope, member.type().name().atom());
+
+				if (member.type().ptrs().size() > 0)
+					continue;
+
+				// members that are not structs are reported when the struct is validated
+				if (symbol != nullptr && symbol->type() == SymbolType::Struct)
+					graph.edges.push_back(nodes.at(symbol->symbol()));
+			}
+		}
+
+		graph.edge_starts.push_back(static_cast<u32>(graph.edges.size()));
+
+		return graph;
+	}
+
+	// Tarjan's algorithm, kept iterative so that long chains of structs cannot overflow the
+	// stack. Returns the structs grouped by strongly connected component, with every
+	// component coming after the components it depends on. Component i is
+	// order[component_starts[i]] up to order[component_starts[i + 1]].
+	static Array<u32> get_struct_components(const StructGraph& graph, Array<u32>& component_starts)
+	{
+		struct Frame
+		{
+			u32 node;
+			u32 edge;
+		};
+
+		const u32 unvisited = UINT32_MAX;
+		auto node_count = graph.edge_starts.size() - 1;
+
+		Array<u32> indices(node_count, unvisited);
+		Array<u32> lowlinks(node_count);
+		Array<bool> is_on_stack(node_count, false);
+		Array<u32> stack;
+		Array<Frame> frames;
+		Array<u32> order;
+		u32 next_index = 0;
+
+		order.reserve(node_count);
+		component_starts.assign(1, 0);
+
+		auto visit = [&](u32 node)
+		{
+			indices[node] = next_index;
+			lowlinks[node] = next_index;
+			next_index += 1;
+			stack.push_back(node);
+			is_on_stack[node] = true;
+			frames.push_back(Frame { node, graph.edge_starts[node] });
+		};
+
+		for (u32 root = 0; root < node_count; ++root)
+		{
+			if (indices[root] != unvisited)
+				continue;
+
+			visit(root);
+
+			while (!frames.empty())
+			{
+				auto node = frames.back().node;
+
+				if (frames.back().edge < graph.edge_starts[node + 1])
+				{
+					auto next = graph.edges[frames.back().edge];
+
+					frames.back().edge += 1;
+
+					if (indices[next] == unvisited)
+						visit(next);
+					else if (is_on_stack[next])
+						lowlinks[node] = std::min(lowlinks[node], indices[next]);
+
+					continue;
+				}
+
+				frames.pop_back();
+
+				if (!frames.empty())
+				{
+					auto parent = frames.back().node;
+
+					lowlinks[parent] = std::min(lowlinks[parent], lowlinks[node]);
+				}
+
+				if (lowlinks[node] != indices[node])
+					continue;
+
+				u32 member;
+
+				do
+				{
+					member = stack.back();
+					stack.pop_back();
+					is_on_stack[member] = false;
+					order.push_back(member);
+				}
+				while (member != node);
+
+				component_starts.push_back(static_cast<u32>(order.size()));
+			}
+		}
+
+		return order;
 	}
 
-	Result<ProgramContext> validate(const ProgramSyntax& syntax)
+	static bool is_recursive(const StructGraph& graph, const u32 *members, usize member_count)
 	{
-		Array<String> containing_types;
+		if (member_count > 1)
+			return true;
+
+		auto node = members[0];
+
+		for (auto i = graph.edge_starts[node]; i < graph.edge_starts[node + 1]; ++i)
+		{
+			if (graph.edges[i] == node)
+				return true;
+		}
+
+		return false;
+	}
+
+	// Structs are validated in dependency order. Components of structs that depend on each
+	// other can never be laid out and are reported as recursive. The same workers run for the
+	// whole graph and take the next component whose dependencies are all validated, so a
+	// worker that finishes a component carries on with the one that was waiting on it. Each
+	// struct's index is its position in dependency order, so it does not depend on which
+	// worker validates it, and diagnostics are printed in declaration order. Every struct is
+	// given its index up front so pointers to structs that are not validated yet can be
+	// interned, and structs that fail are only invalidated once the workers are done.
+	static bool validate_structs(const Array<StructValidation>& structs, GlobalSymbolTable& globals, usize worker_count)
+	{
+		auto graph = get_struct_graph(structs, globals);
+		Array<u32> component_starts;
+		auto order = get_struct_components(graph, component_starts);
+		auto component_count = component_starts.size() - 1;
+		Array<u32> components(structs.size());
+		Array<u32> positions(structs.size());
+		Array<String> diagnostics(structs.size());
+
+		for (u32 i = 0; i < component_count; ++i)
+		{
+			for (auto j = component_starts[i]; j < component_starts[i + 1]; ++j)
+			{
+				components[order[j]] = i;
+				positions[order[j]] = j;
+			}
+		}
+
+		for (usize i = 0; i < structs.size(); ++i)
+			structs[i].data->validate(positions[i]);
+
+		// a component can be validated once every component it depends on has been
+		Array<Array<u32>> dependents(component_count);
+		Array<u32> pending_counts(component_count, 0);
+		Array<u32> ready;
+
+		for (u32 i = 0; i < component_count; ++i)
+		{
+			for (auto j = component_starts[i]; j < component_starts[i + 1]; ++j)
+			{
+				auto node = order[j];
+
+				for (auto k = graph.edge_starts[node]; k < graph.edge_starts[node + 1]; ++k)
+				{
+					auto dependency = components[graph.edges[k]];
+
+					if (dependency != i)
+					{
+						dependents[dependency].push_back(i);
+						pending_counts[i] += 1;
+					}
+				}
+			}
+
+			if (pending_counts[i] == 0)
+				ready.push_back(i);
+		}
+
+		Array<Optional<StructContext>> results(structs.size());
+		// the structs validated so far by their index, which is their position in dependency order
+		Array<const StructContext *> validated(structs.size(), nullptr);
+
+		auto validate_component = [&](u32 component)
+		{
+			const auto *members = order.data() + component_starts[component];
+			auto member_count = component_starts[component + 1] - component_starts[component];
+
+			if (is_recursive(graph, members, member_count))
+			{
+				auto first = *std::min_element(members, members + member_count);
+				const auto& data = *structs[first].data;
+				DiagnosticCapture capture;
+
+				print_error(data.struct_syntax().name(), "Struct '" + String(data.symbol_text()) + "' contains itself.");
+
+				for (usize j = 0; j < member_count; ++j)
+				{
+					const auto& member = *structs[members[j]].data;
+
+					if (members[j] != first)
+						print_note(member.struct_syntax().name(), "Struct '" + String(member.symbol_text()) + "' is part of the same cycle.");
+				}
+
+				diagnostics[first] = capture.text();
+
+				return;
+			}
+
+			auto node = members[0];
+			const auto& data = *structs[node].data;
+			DiagnosticCapture capture;
+			auto res = validate_struct(data, globals, structs[node].scope, validated);
+
+			if (res)
+			{
+				results[node] = res.unwrap();
+				validated[positions[node]] = &*results[node];
+			}
+
+			diagnostics[node] = capture.text();
+		};
+
+		const u32 no_component = UINT32_MAX;
+		std::mutex ready_mutex;
+		std::condition_variable ready_condition;
+		usize remaining_count = component_count;
+		bool is_stopped = false;
+
+		if (worker_count == 0)
+			worker_count = get_worker_count(component_count);
+
+		parallel_for(std::min<usize>(worker_count, component_count), [&](usize)
+		{
+			auto component = no_component;
+			std::unique_lock lock(ready_mutex);
 
+			while (!is_stopped)
+			{
+				if (component == no_component)
+				{
+					ready_condition.wait(lock, [&]() { return !ready.empty() || remaining_count == 0 || is_stopped; });
+
+					if (ready.empty() || is_stopped)
+						return;
+
+					component = ready.back();
+					ready.pop_back();
+				}
+
+				lock.unlock();
+
+				try
+				{
+					validate_component(component);
+				}
+				catch (...)
+				{
+					// the other workers would otherwise wait for components that never become ready
+					lock.lock();
+					is_stopped = true;
+					ready_condition.notify_all();
+					throw;
+				}
+
+				lock.lock();
+				remaining_count -= 1;
+
+				auto next = no_component;
+
+				for (auto dependent : dependents[component])
+				{
+					pending_counts[dependent] -= 1;
+
+					if (pending_counts[dependent] != 0)
+						continue;
+
+					if (next == no_component)
+					{
+						next = dependent;
+					}
+					else
+					{
+						ready.push_back(dependent);
+						ready_condition.notify_one();
+					}
+				}
+
+				if (remaining_count == 0)
+					ready_condition.notify_all();
+
+				component = next;
+			}
+		}, worker_count);
+
+		bool success = true;
+
+		for (usize i = 0; i < structs.size(); ++i)
+		{
+			print_captured(diagnostics[i]);
+
+			if (!results[i])
+			{
+				structs[i].data->invalidate();
+				success = false;
+			}
+		}
+
+		if (!success)
+			return false;
+
+		for (auto node : order)
+		{
+			auto index = globals.add_validated_struct(std::move(*results[node]));
+
+			assert(index == positions[node]);
+		}
+
+		return true;
+	}
+
+	// Structs are validated first. After that the globals are only read, so every function is
+	// given its index up front and functions are validated on worker threads. The diagnostics
+	// of each function are captured and printed in declaration order afterwards, up to the
+	// first function that failed, as validating them one after another would.
+	Result<ProgramContext> validate(const ProgramSyntax& syntax, usize worker_count)
+	{
 		auto globals_res = GlobalSymbolTable::generate(syntax);
 		
 		if (!globals_res)
@@ -420,36 +811,61 @@ namespace warbler
 
 		auto globals = globals_res.unwrap();
 
-		bool success = true;
+		Array<StructValidation> structs;
+		Array<FunctionValidation> functions;
 
-		for (auto& pair : globals)
+		for (u32 scope = 0; scope < globals.scope_count(); ++scope)
 		{
-			const auto& symbol = pair.first;
-			auto& data = pair.second;
+			for (auto& pair : globals.symbols(scope))
+			{
+				auto& data = pair.second;
+
+				switch (data.type())
+				{
+					case SymbolType::Struct:
+						structs.push_back(StructValidation { &data, scope });
+						break;
+
+					case SymbolType::Function:
+						data.validate(functions.size());
+						functions.push_back(FunctionValidation { &data.function_syntax(), data.symbol(), scope });
+						break;
+
+					default:
+						break;
+				}
+			}
+		}
 
-			if (data.is_already_validated())
-				continue;
+		if (!validate_structs(structs, globals, worker_count))
+			return {};
 
-			globals.set_scope_from_symbol(symbol);
+		Array<Optional<FunctionContext>> results(functions.size());
+		Array<String> diagnostics(functions.size());
 
-			switch (data.type())
-			{
-				case SymbolType::Struct:
-					success = success && validate_struct(data.struct_syntax(), globals, containing_types);
-					containing_types.clear();
-					break;
+		parallel_for(functions.size(), [&](usize i)
+		{
+			DiagnosticCapture capture;
+			const auto& function = functions[i];
+			auto res = validate_function(*function.syntax, function.symbol, globals, function.scope);
 
-				case SymbolType::Function:
-					success = success && validate_function(data.function_syntax(), globals);
-					break;
+			if (res)
+				results[i] = res.unwrap();
 
-				default:
-					break;
-			}
-		}		
+			diagnostics[i] = capture.text();
+		}, worker_count);
 
-		if (!success)
-			return {};
+		for (usize i = 0; i < functions.size(); ++i)
+		{
+			print_captured(diagnostics[i]);
+
+			if (!results[i])
+				return {};
+
+			auto index = globals.add_validated_function(std::move(*results[i]));
+
+			assert(index == i);
+		}
 
 		return ProgramContext(globals.take_structs(), globals.take_functions());
 	}